@@ -0,0 +1,94 @@
+/**************************************************************************
+ *Copyright (C) 2006 Intel Corporation
+ *
+ *This program is free software; you can redistribute it and/or
+ *modify it under the terms of the GNU General Public License
+ *as published by the Free Software Foundation; either version 2
+ *of the License, or (at your option) any later version.
+ *
+ *This program is distributed in the hope that it will be useful,
+ *but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *GNU General Public License for more details.
+ *
+ *You should have received a copy of the GNU General Public License
+ *along with this program; if not, write to the Free Software
+ *Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * @file
+ * @brief Address ranges given in a parameter as start-end[,start-end...]
+ */
+
+#ifndef _ADDR_RANGES_
+#define _ADDR_RANGES_ 1
+
+// generic C
+#include <stdlib.h>
+
+// generic C++
+#include <vector>
+#include <utility>
+
+// ASIM core
+#include "asim/syntax.h"
+
+/**
+ * @brief A list of [start, end) address ranges.
+ *
+ * Numbers are read as by strtoull with base 0, so they may be decimal,
+ * octal or hex.  An empty list has no ranges.
+ */
+class ADDR_RANGES_CLASS
+{
+  private:
+    std::vector<std::pair<UINT64, UINT64> > ranges;
+
+  public:
+    /// Replace the ranges with those in list; false if it is malformed.
+    bool Parse (const char *list)
+    {
+        ranges.clear();
+
+        const char *cp = list;
+        while (*cp != '\0')
+        {
+            char *endp;
+            UINT64 start = strtoull(cp, &endp, 0);
+            if ((endp == cp) || (*endp != '-'))
+            {
+                return false;
+            }
+
+            cp = endp + 1;
+            UINT64 end = strtoull(cp, &endp, 0);
+            if ((endp == cp) || (start >= end) ||
+                ((*endp != ',') && (*endp != '\0')))
+            {
+                return false;
+            }
+
+            ranges.push_back(std::make_pair(start, end));
+            cp = (*endp == ',') ? endp + 1 : endp;
+        }
+
+        return true;
+    }
+
+    bool Empty (void) const { return ranges.empty(); }
+
+    bool Contains (UINT64 addr) const
+    {
+        for (UINT32 i = 0; i < ranges.size(); i++)
+        {
+            if ((addr >= ranges[i].first) && (addr < ranges[i].second))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+#endif // _ADDR_RANGES_
@@ -0,0 +1,129 @@
+/**************************************************************************
+ *Copyright (C) 2006 Intel Corporation
+ *
+ *This program is free software; you can redistribute it and/or
+ *modify it under the terms of the GNU General Public License
+ *as published by the Free Software Foundation; either version 2
+ *of the License, or (at your option) any later version.
+ *
+ *This program is distributed in the hope that it will be useful,
+ *but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *GNU General Public License for more details.
+ *
+ *You should have received a copy of the GNU General Public License
+ *along with this program; if not, write to the Free Software
+ *Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * @file
+ * @brief Encoding of Asim binary stats files (.bstats)
+ */
+
+#ifndef _STATSBINARY_FORMAT_
+#define _STATSBINARY_FORMAT_ 1
+
+// generic C
+#include <stdint.h>
+#include <string.h>
+
+// generic C++
+#include <string>
+
+/**
+ * @brief Constants and primitives of the binary stats file format.
+ *
+ * The layout is described in lib/libasimstats/statsbinary.h.  Both the
+ * library there and the writer in the classic controller use this
+ * header, so there is only one definition of the encoding.  It must not
+ * depend on anything else in asim.
+ */
+struct BinaryStatsFormat {
+    static const uint32_t Version = 1;
+
+    enum Tag {
+        TagString   = 1,
+        TagState    = 2,
+        TagSnapshot = 3
+    };
+
+    enum Type {
+        TypeUint      = 1,
+        TypeDouble    = 2,
+        TypeString    = 3,
+        TypeHistogram = 4
+    };
+
+    /// File magic, MagicSize bytes without a terminator.
+    enum { MagicSize = 8 };
+    static const char * Magic () { return "ASIMBST\n"; }
+
+    /// Append an unsigned LEB128 varint.
+    static void PutVarint (std::string & buf, uint64_t value)
+    {
+        while (value >= 0x80) {
+            buf += char((value & 0x7f) | 0x80);
+            value >>= 7;
+        }
+        buf += char(value);
+    }
+
+    /// Read a varint at pos; false if buf ends first.
+    static bool GetVarint (const std::string & buf, size_t & pos,
+                           uint64_t & value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (pos >= buf.size()) {
+                return false;
+            }
+            unsigned char c = buf[pos++];
+            value |= uint64_t(c & 0x7f) << shift;
+            if ((c & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// Map a signed delta (new - old, modulo 2^64) to a small unsigned.
+    static uint64_t ZigZag (uint64_t delta)
+    {
+        return (delta << 1) ^ uint64_t(int64_t(delta) >> 63);
+    }
+
+    static uint64_t UnZigZag (uint64_t value)
+    {
+        return (value >> 1) ^ (0 - (value & 1));
+    }
+
+    /// Append 8 little-endian IEEE bytes.
+    static void PutDouble (std::string & buf, double value)
+    {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        for (int i = 0; i < 8; i++) {
+            buf += char(bits & 0xff);
+            bits >>= 8;
+        }
+    }
+
+    static bool GetDouble (const std::string & buf, size_t & pos,
+                           double & value)
+    {
+        if (pos + 8 > buf.size()) {
+            return false;
+        }
+        uint64_t bits = 0;
+        for (int i = 7; i >= 0; i--) {
+            unsigned char c = buf[pos + i];
+            bits = (bits << 8) | c;
+        }
+        pos += 8;
+        memcpy(&value, &bits, sizeof(value));
+        return true;
+    }
+};
+
+#endif // _STATSBINARY_FORMAT_
@@ -0,0 +1,111 @@
+/**************************************************************************
+ *Copyright (C) 2006 Intel Corporation
+ *
+ *This program is free software; you can redistribute it and/or
+ *modify it under the terms of the GNU General Public License
+ *as published by the Free Software Foundation; either version 2
+ *of the License, or (at your option) any later version.
+ *
+ *This program is distributed in the hope that it will be useful,
+ *but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *GNU General Public License for more details.
+ *
+ *You should have received a copy of the GNU General Public License
+ *along with this program; if not, write to the Free Software
+ *Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * @file
+ * @brief Convert a binary stats file into XML stats files.
+ *
+ * Usage: bstats-to-stats [--list] [--snapshot=N] <file.bstats>
+ *
+ * Without options every snapshot is written to its own file, named
+ * like the ones CMD_EMITSTATS writes (cycle_C_nano_N_insts_I.stats),
+ * so the result can be fed to stat-to-text, summarize-stats etc.
+ * --snapshot=N writes only snapshot N to stdout, --list prints one
+ * line per snapshot.
+ */
+
+// generic C
+#include <stdlib.h>
+#include <string.h>
+
+// generic C++
+#include <fstream>
+#include <sstream>
+
+// local
+#include "statsbinary.h"
+
+static void
+Usage (const char * prog)
+{
+    cerr << "usage: " << prog << " [--list] [--snapshot=N] <file.bstats>"
+         << endl;
+    exit(1);
+}
+
+int main (int argc, char ** argv)
+{
+    bool list = false;
+    bool single = false;
+    uint64_t snapshot = 0;
+    const char * fileName = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--list") == 0) {
+            list = true;
+        } else if (strncmp(argv[i], "--snapshot=", 11) == 0) {
+            single = true;
+            snapshot = strtoull(argv[i] + 11, NULL, 0);
+        } else if (argv[i][0] == '-' || fileName) {
+            Usage(argv[0]);
+        } else {
+            fileName = argv[i];
+        }
+    }
+    if ( ! fileName) {
+        Usage(argv[0]);
+    }
+
+    BinaryStatsReader reader(fileName);
+    while (reader.NextSnapshot()) {
+        const BinaryStats::Snapshot & s = reader.Current();
+
+        if (list) {
+            cout << s.sequence << ": cycle " << s.cycle
+                 << " nano " << s.nanosecond
+                 << " insts " << s.insts << endl;
+        } else if (single) {
+            if (s.sequence == snapshot) {
+                reader.WriteXml(cout);
+                return 0;
+            }
+        } else {
+            ostringstream name;
+            name << "cycle_"  << s.cycle
+                 << "_nano_"  << s.nanosecond
+                 << "_insts_" << s.insts
+                 << ".stats";
+            ofstream out(name.str().c_str());
+            if ( ! out) {
+                cerr << name.str() << ": cannot create" << endl;
+                return 1;
+            }
+            reader.WriteXml(out);
+        }
+    }
+
+    if ( ! reader.Ok()) {
+        cerr << fileName << ": " << reader.Error() << endl;
+        return 1;
+    }
+    if (single) {
+        cerr << fileName << ": no snapshot " << snapshot << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,894 @@
+/**************************************************************************
+ *Copyright (C) 2006 Intel Corporation
+ *
+ *This program is free software; you can redistribute it and/or
+ *modify it under the terms of the GNU General Public License
+ *as published by the Free Software Foundation; either version 2
+ *of the License, or (at your option) any later version.
+ *
+ *This program is distributed in the hope that it will be useful,
+ *but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *GNU General Public License for more details.
+ *
+ *You should have received a copy of the GNU General Public License
+ *along with this program; if not, write to the Free Software
+ *Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * @file
+ * @brief Reader / writer for Asim binary stats files (.bstats).
+ */
+
+// generic C
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+
+// generic C++
+#include <sstream>
+
+// local
+#include "statsbinary.h"
+
+//----------------------------------------------------------------------------
+// helpers
+//----------------------------------------------------------------------------
+
+/// Escape XML markup characters.
+static string
+XmlEscape (const string & str)
+{
+    string result;
+    for (size_t i = 0; i < str.size(); i++) {
+        switch (str[i]) {
+          case '<':  result += "&lt;";   break;
+          case '>':  result += "&gt;";   break;
+          case '&':  result += "&amp;";  break;
+          case '"':  result += "&quot;"; break;
+          default:   result += str[i];   break;
+        }
+    }
+    return result;
+}
+
+//----------------------------------------------------------------------------
+// BinaryStatsReader
+//----------------------------------------------------------------------------
+
+BinaryStatsReader::BinaryStatsReader (
+    const string & fileName)
+{
+    memset(&current, 0, sizeof(current));
+
+    in = fopen(fileName.c_str(), "rb");
+    if ( ! in) {
+        error = fileName + ": " + strerror(errno);
+        return;
+    }
+
+    char magic[BinaryStats::MagicSize];
+    if (fread(magic, 1, sizeof(magic), in) != sizeof(magic) ||
+        memcmp(magic, BinaryStats::Magic(), sizeof(magic)) != 0)
+    {
+        error = fileName + ": not a binary stats file";
+        return;
+    }
+
+    // version is the only varint outside of a record
+    uint64_t version = 0;
+    int shift = 0;
+    int c;
+    do {
+        c = fgetc(in);
+        if (c == EOF) {
+            error = fileName + ": truncated header";
+            return;
+        }
+        version |= uint64_t(c & 0x7f) << shift;
+        shift += 7;
+    } while (c & 0x80);
+
+    if (version > BinaryStats::Version) {
+        ostringstream os;
+        os << fileName << ": unsupported version " << version;
+        error = os.str();
+    }
+}
+
+BinaryStatsReader::~BinaryStatsReader ()
+{
+    if (in) {
+        fclose(in);
+    }
+}
+
+/// Read the next record into 'payload'.  Returns false at end of file
+/// or on error.
+bool
+BinaryStatsReader::ReadRecord (
+    int & tag)
+{
+    tag = fgetc(in);
+    if (tag == EOF) {
+        return false;
+    }
+
+    uint64_t len = 0;
+    int shift = 0;
+    int c;
+    do {
+        c = fgetc(in);
+        if (c == EOF || shift >= 64) {
+            error = "truncated record header";
+            return false;
+        }
+        len |= uint64_t(c & 0x7f) << shift;
+        shift += 7;
+    } while (c & 0x80);
+
+    // Grow the payload as the bytes arrive, so a corrupt length can not
+    // allocate more than the file holds.
+    payload.clear();
+    while (payload.size() < len) {
+        size_t chunk = len - payload.size();
+        if (chunk > (1 << 20)) {
+            chunk = 1 << 20;
+        }
+        size_t old = payload.size();
+        payload.resize(old + chunk);
+        if (fread(&payload[old], 1, chunk, in) != chunk) {
+            error = "truncated record";
+            return false;
+        }
+    }
+    return true;
+}
+
+const string *
+BinaryStatsReader::String (
+    uint64_t id)
+{
+    if (id >= strings.size()) {
+        error = "reference to undefined string";
+        return NULL;
+    }
+    return &strings[id];
+}
+
+bool
+BinaryStatsReader::DefineString (
+    const string & buf)
+{
+    size_t pos = 0;
+    uint64_t id;
+    if ( ! BinaryStats::GetVarint(buf, pos, id) || id > strings.size()) {
+        error = "bad string record";
+        return false;
+    }
+    if (id == strings.size()) {
+        strings.push_back(buf.substr(pos));
+    } else {
+        strings[id] = buf.substr(pos);
+    }
+    return true;
+}
+
+bool
+BinaryStatsReader::DefineState (
+    const string & buf)
+{
+    size_t pos = 0;
+    uint64_t id, type, path, name, desc, size;
+    if ( ! BinaryStats::GetVarint(buf, pos, id)   ||
+         ! BinaryStats::GetVarint(buf, pos, type) ||
+         ! BinaryStats::GetVarint(buf, pos, path) ||
+         ! BinaryStats::GetVarint(buf, pos, name) ||
+         ! BinaryStats::GetVarint(buf, pos, desc) ||
+         ! BinaryStats::GetVarint(buf, pos, size) ||
+         type < BinaryStats::TypeUint || type > BinaryStats::TypeHistogram ||
+         id > states.size() + 0xffff ||
+         size > BinaryStats::MaxStateSize)
+    {
+        error = "bad state record";
+        return false;
+    }
+
+    if (id >= states.size()) {
+        states.resize(id + 1);
+        defined.resize(id + 1, false);
+    }
+
+    BinaryStats::State & state = states[id];
+    const string * str;
+    state.id = id;
+    state.type = BinaryStats::Type(type);
+    if ( ! (str = String(path))) return false;
+    state.path = *str;
+    if ( ! (str = String(name))) return false;
+    state.name = *str;
+    if ( ! (str = String(desc))) return false;
+    state.desc = *str;
+    state.size = size;
+    state.rows = state.cols = 0;
+    state.rowNames.clear();
+    state.colNames.clear();
+
+    if (state.type == BinaryStats::TypeHistogram) {
+        uint64_t rows, cols, sid;
+        // every label takes at least one byte of the record
+        if ( ! BinaryStats::GetVarint(buf, pos, rows) ||
+             ! BinaryStats::GetVarint(buf, pos, cols) ||
+             rows > buf.size() - pos || cols > buf.size() - pos ||
+             rows + cols > buf.size() - pos ||
+             rows * cols != size)
+        {
+            error = "bad histogram record";
+            return false;
+        }
+        state.rows = rows;
+        state.cols = cols;
+        for (uint64_t i = 0; i < rows + cols; i++) {
+            if ( ! BinaryStats::GetVarint(buf, pos, sid)) {
+                error = "bad histogram record";
+                return false;
+            }
+            if ( ! (str = String(sid))) return false;
+            (i < rows ? state.rowNames : state.colNames).push_back(*str);
+        }
+    }
+
+    state.uintValue.assign(state.type == BinaryStats::TypeUint ||
+                           state.type == BinaryStats::TypeHistogram ? size : 0,
+                           0);
+    state.doubleValue.assign(state.type == BinaryStats::TypeDouble ? size : 0,
+                             0.0);
+    state.stringValue.clear();
+    defined[id] = true;
+    return true;
+}
+
+bool
+BinaryStatsReader::ApplySnapshot (
+    const string & buf)
+{
+    size_t pos = 0;
+    uint64_t count;
+    if ( ! BinaryStats::GetVarint(buf, pos, current.sequence)   ||
+         ! BinaryStats::GetVarint(buf, pos, current.cycle)      ||
+         ! BinaryStats::GetVarint(buf, pos, current.nanosecond) ||
+         ! BinaryStats::GetVarint(buf, pos, current.insts)      ||
+         ! BinaryStats::GetVarint(buf, pos, count))
+    {
+        error = "bad snapshot record";
+        return false;
+    }
+
+    uint64_t id = 0;
+    for (uint64_t n = 0; n < count; n++) {
+        uint64_t delta;
+        if ( ! BinaryStats::GetVarint(buf, pos, delta) ||
+             (id += delta) >= states.size() || ! defined[id])
+        {
+            error = "snapshot refers to undefined state";
+            return false;
+        }
+
+        BinaryStats::State & state = states[id];
+        uint64_t v;
+        switch (state.type) {
+          case BinaryStats::TypeUint:
+          case BinaryStats::TypeHistogram:
+            for (uint32_t i = 0; i < state.size; i++) {
+                if ( ! BinaryStats::GetVarint(buf, pos, v)) {
+                    error = "truncated snapshot";
+                    return false;
+                }
+                state.uintValue[i] += BinaryStats::UnZigZag(v);
+            }
+            break;
+          case BinaryStats::TypeDouble:
+            for (uint32_t i = 0; i < state.size; i++) {
+                if ( ! BinaryStats::GetDouble(buf, pos, state.doubleValue[i])) {
+                    error = "truncated snapshot";
+                    return false;
+                }
+            }
+            break;
+          case BinaryStats::TypeString:
+            {
+                const string * str;
+                if ( ! BinaryStats::GetVarint(buf, pos, v)) {
+                    error = "truncated snapshot";
+                    return false;
+                }
+                if ( ! (str = String(v))) return false;
+                state.stringValue = *str;
+            }
+            break;
+        }
+    }
+    return true;
+}
+
+bool
+BinaryStatsReader::NextSnapshot ()
+{
+    if ( ! Ok()) {
+        return false;
+    }
+
+    int tag;
+    while (ReadRecord(tag)) {
+        switch (tag) {
+          case BinaryStats::TagString:
+            if ( ! DefineString(payload)) return false;
+            break;
+          case BinaryStats::TagState:
+            if ( ! DefineState(payload)) return false;
+            break;
+          case BinaryStats::TagSnapshot:
+            return ApplySnapshot(payload);
+          default:
+            // newer record type, skip it
+            break;
+        }
+    }
+    return false;
+}
+
+const BinaryStats::State *
+BinaryStatsReader::Find (
+    const string & fullName) const
+{
+    for (size_t i = 0; i < states.size(); i++) {
+        if (defined[i] && states[i].path + "/" + states[i].name == fullName) {
+            return &states[i];
+        }
+    }
+    return NULL;
+}
+
+/// Split a state path into its module names.
+static vector<string>
+SplitPath (const string & path)
+{
+    vector<string> result;
+    size_t start = 0;
+    while (start <= path.size()) {
+        size_t end = path.find('/', start);
+        if (end == string::npos) {
+            end = path.size();
+        }
+        if (end > start) {
+            result.push_back(path.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+    return result;
+}
+
+ostream &
+BinaryStatsReader::WriteXml (
+    ostream & out) const
+{
+    out << "<?xml version=\"1.0\"?>" << endl
+        << "<stats>" << endl
+        << "<scalar><type>uint</type><name>cycle</name>"
+        << current.cycle << "</scalar>" << endl
+        << "<scalar><type>uint</type><name>nanosecond</name>"
+        << current.nanosecond << "</scalar>" << endl
+        << "<scalar><type>uint</type><name>insts</name>"
+        << current.insts << "</scalar>" << endl;
+
+    // states of a module are defined next to each other, so we only
+    // have to reopen compounds where consecutive paths differ
+    vector<string> open;
+    for (size_t i = 0; i < states.size(); i++) {
+        if ( ! defined[i]) {
+            continue;
+        }
+        const BinaryStats::State & state = states[i];
+
+        vector<string> path = SplitPath(state.path);
+        size_t common = 0;
+        while (common < open.size() && common < path.size() &&
+               open[common] == path[common])
+        {
+            common++;
+        }
+        while (open.size() > common) {
+            out << "</compound>" << endl;
+            open.pop_back();
+        }
+        for (; common < path.size(); common++) {
+            out << "<compound><type>module</type><name>"
+                << XmlEscape(path[common]) << "</name>" << endl;
+            open.push_back(path[common]);
+        }
+
+        string header = "<name>" + XmlEscape(state.name) + "</name>";
+        if ( ! state.desc.empty()) {
+            header += "<desc>" + XmlEscape(state.desc) + "</desc>";
+        }
+
+        switch (state.type) {
+          case BinaryStats::TypeUint:
+          case BinaryStats::TypeDouble:
+            {
+                const char * type =
+                    state.type == BinaryStats::TypeUint ? "uint" : "double";
+                if (state.size == 1) {
+                    out << "<scalar><type>" << type << "</type>" << header;
+                    if (state.type == BinaryStats::TypeUint) {
+                        out << state.uintValue[0];
+                    } else {
+                        out << state.doubleValue[0];
+                    }
+                    out << "</scalar>" << endl;
+                } else {
+                    out << "<vector><type>" << type << "</type>" << header;
+                    for (uint32_t v = 0; v < state.size; v++) {
+                        out << "<value>";
+                        if (state.type == BinaryStats::TypeUint) {
+                            out << state.uintValue[v];
+                        } else {
+                            out << state.doubleValue[v];
+                        }
+                        out << "</value>";
+                    }
+                    out << "</vector>" << endl;
+                }
+            }
+            break;
+
+          case BinaryStats::TypeString:
+            out << "<scalar><type>string</type>" << header
+                << XmlEscape(state.stringValue) << "</scalar>" << endl;
+            break;
+
+          case BinaryStats::TypeHistogram:
+            {
+                uint64_t entries = 0;
+                for (uint32_t v = 0; v < state.size; v++) {
+                    entries += state.uintValue[v];
+                }
+                out << "<compound><type>histogram</type>" << header << endl
+                    << "<scalar><type>uint</type><name>rows</name>"
+                    << state.rows << "</scalar>" << endl
+                    << "<scalar><type>uint</type><name>cols</name>"
+                    << state.cols << "</scalar>" << endl
+                    << "<scalar><type>uint</type><name>entries</name>"
+                    << entries << "</scalar>" << endl
+                    << "<vector><type>info</type><name>column names</name>";
+                for (uint32_t c = 0; c < state.cols; c++) {
+                    out << "<value>" << XmlEscape(state.colNames[c])
+                        << "</value>";
+                }
+                out << "</vector>" << endl
+                    << "<compound><type>info</type><name>data</name>" << endl;
+                for (uint32_t r = 0; r < state.rows; r++) {
+                    out << "<vector><type>row</type><name>"
+                        << XmlEscape(state.rowNames[r]) << "</name>";
+                    for (uint32_t c = 0; c < state.cols; c++) {
+                        out << "<value>"
+                            << state.uintValue[r * state.cols + c]
+                            << "</value>";
+                    }
+                    out << "</vector>" << endl;
+                }
+                out << "</compound>" << endl
+                    << "</compound>" << endl;
+            }
+            break;
+        }
+    }
+
+    while ( ! open.empty()) {
+        out << "</compound>" << endl;
+        open.pop_back();
+    }
+    out << "</stats>" << endl;
+    return out;
+}
+
+//----------------------------------------------------------------------------
+// BinaryStatsWriter
+//----------------------------------------------------------------------------
+
+BinaryStatsWriter::BinaryStatsWriter (
+    const string & fileName)
+  : sequence(0)
+{
+    out = fopen(fileName.c_str(), "wb");
+    if (out) {
+        string header(BinaryStats::Magic(), BinaryStats::MagicSize);
+        BinaryStats::PutVarint(header, BinaryStats::Version);
+        fwrite(header.data(), 1, header.size(), out);
+    }
+}
+
+BinaryStatsWriter::~BinaryStatsWriter ()
+{
+    if (out) {
+        fclose(out);
+    }
+}
+
+void
+BinaryStatsWriter::WriteRecord (
+    int tag,
+    const string & buf)
+{
+    string header(1, char(tag));
+    BinaryStats::PutVarint(header, buf.size());
+    fwrite(header.data(), 1, header.size(), out);
+    fwrite(buf.data(), 1, buf.size(), out);
+}
+
+uint32_t
+BinaryStatsWriter::StringId (
+    const string & str)
+{
+    map<string, uint32_t>::iterator it = stringIds.find(str);
+    if (it != stringIds.end()) {
+        return it->second;
+    }
+
+    uint32_t id = stringIds.size();
+    stringIds[str] = id;
+
+    record.clear();
+    BinaryStats::PutVarint(record, id);
+    record += str;
+    WriteRecord(BinaryStats::TagString, record);
+    return id;
+}
+
+uint32_t
+BinaryStatsWriter::DefineState (
+    BinaryStats::Type type,
+    const string & path,
+    const string & name,
+    const string & desc,
+    uint32_t size)
+{
+    assert(type != BinaryStats::TypeHistogram);
+
+    uint32_t id = entries.size();
+    entries.resize(id + 1);
+    Entry & entry = entries[id];
+    entry.written = false;
+    entry.state.id = id;
+    entry.state.type = type;
+    entry.state.path = path;
+    entry.state.name = name;
+    entry.state.desc = desc;
+    entry.state.size = (type == BinaryStats::TypeString) ? 1 : size;
+    entry.state.rows = entry.state.cols = 0;
+    if (type == BinaryStats::TypeUint) {
+        entry.state.uintValue.assign(size, 0);
+        entry.lastUint.assign(size, 0);
+    } else if (type == BinaryStats::TypeDouble) {
+        entry.state.doubleValue.assign(size, 0.0);
+        entry.lastDouble.assign(size, 0.0);
+    }
+
+    uint32_t pathId = StringId(path);
+    uint32_t nameId = StringId(name);
+    uint32_t descId = StringId(desc);
+
+    record.clear();
+    BinaryStats::PutVarint(record, id);
+    BinaryStats::PutVarint(record, type);
+    BinaryStats::PutVarint(record, pathId);
+    BinaryStats::PutVarint(record, nameId);
+    BinaryStats::PutVarint(record, descId);
+    BinaryStats::PutVarint(record, entry.state.size);
+    WriteRecord(BinaryStats::TagState, record);
+    return id;
+}
+
+uint32_t
+BinaryStatsWriter::DefineHistogram (
+    const string & path,
+    const string & name,
+    const string & desc,
+    const vector<string> & rowNames,
+    const vector<string> & colNames)
+{
+    uint32_t id = entries.size();
+    entries.resize(id + 1);
+    Entry & entry = entries[id];
+    uint32_t size = rowNames.size() * colNames.size();
+    entry.written = false;
+    entry.state.id = id;
+    entry.state.type = BinaryStats::TypeHistogram;
+    entry.state.path = path;
+    entry.state.name = name;
+    entry.state.desc = desc;
+    entry.state.size = size;
+    entry.state.rows = rowNames.size();
+    entry.state.cols = colNames.size();
+    entry.state.rowNames = rowNames;
+    entry.state.colNames = colNames;
+    entry.state.uintValue.assign(size, 0);
+    entry.lastUint.assign(size, 0);
+
+    vector<uint32_t> labels;
+    for (size_t i = 0; i < rowNames.size(); i++) {
+        labels.push_back(StringId(rowNames[i]));
+    }
+    for (size_t i = 0; i < colNames.size(); i++) {
+        labels.push_back(StringId(colNames[i]));
+    }
+    uint32_t pathId = StringId(path);
+    uint32_t nameId = StringId(name);
+    uint32_t descId = StringId(desc);
+
+    record.clear();
+    BinaryStats::PutVarint(record, id);
+    BinaryStats::PutVarint(record, BinaryStats::TypeHistogram);
+    BinaryStats::PutVarint(record, pathId);
+    BinaryStats::PutVarint(record, nameId);
+    BinaryStats::PutVarint(record, descId);
+    BinaryStats::PutVarint(record, size);
+    BinaryStats::PutVarint(record, rowNames.size());
+    BinaryStats::PutVarint(record, colNames.size());
+    for (size_t i = 0; i < labels.size(); i++) {
+        BinaryStats::PutVarint(record, labels[i]);
+    }
+    WriteRecord(BinaryStats::TagState, record);
+    return id;
+}
+
+void
+BinaryStatsWriter::WriteSnapshot (
+    uint64_t cycle,
+    uint64_t nanosecond,
+    uint64_t insts)
+{
+    // new string values go to the string table before the snapshot
+    // that uses them
+    for (size_t i = 0; i < entries.size(); i++) {
+        Entry & entry = entries[i];
+        if (entry.state.type == BinaryStats::TypeString &&
+            ( ! entry.written || entry.state.stringValue != entry.lastString))
+        {
+            StringId(entry.state.stringValue);
+        }
+    }
+
+    string body;
+    uint32_t count = 0;
+    uint32_t lastId = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        Entry & entry = entries[i];
+        BinaryStats::State & state = entry.state;
+
+        bool changed = ! entry.written;
+        switch (state.type) {
+          case BinaryStats::TypeUint:
+          case BinaryStats::TypeHistogram:
+            changed = changed || state.uintValue != entry.lastUint;
+            break;
+          case BinaryStats::TypeDouble:
+            changed = changed || state.doubleValue != entry.lastDouble;
+            break;
+          case BinaryStats::TypeString:
+            changed = changed || state.stringValue != entry.lastString;
+            break;
+        }
+        if ( ! changed) {
+            continue;
+        }
+
+        BinaryStats::PutVarint(body, i - lastId);
+        lastId = i;
+        count++;
+        entry.written = true;
+
+        switch (state.type) {
+          case BinaryStats::TypeUint:
+          case BinaryStats::TypeHistogram:
+            for (uint32_t v = 0; v < state.size; v++) {
+                BinaryStats::PutVarint(body,
+                    BinaryStats::ZigZag(state.uintValue[v] - entry.lastUint[v]));
+            }
+            entry.lastUint = state.uintValue;
+            break;
+          case BinaryStats::TypeDouble:
+            for (uint32_t v = 0; v < state.size; v++) {
+                BinaryStats::PutDouble(body, state.doubleValue[v]);
+            }
+            entry.lastDouble = state.doubleValue;
+            break;
+          case BinaryStats::TypeString:
+            BinaryStats::PutVarint(body, StringId(state.stringValue));
+            entry.lastString = state.stringValue;
+            break;
+        }
+    }
+
+    record.clear();
+    BinaryStats::PutVarint(record, sequence++);
+    BinaryStats::PutVarint(record, cycle);
+    BinaryStats::PutVarint(record, nanosecond);
+    BinaryStats::PutVarint(record, insts);
+    BinaryStats::PutVarint(record, count);
+    record += body;
+    WriteRecord(BinaryStats::TagSnapshot, record);
+}
+
+//----------------------------------------------------------------------------
+// component test
+//----------------------------------------------------------------------------
+
+#ifdef TESTS
+#include <stdlib.h>
+#include <unistd.h>
+
+#define CHECK(cond) \
+    if ( ! (cond)) { \
+        cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #cond << endl; \
+        exit(1); \
+    }
+
+//
+// Values of every state in each snapshot the test writes.
+//
+static const int NumSnapshots = 5;
+
+static const struct {
+    uint64_t cycle, nanosecond, insts;
+    uint64_t cycles;           // system/cpu0/cycles
+    uint64_t ports[3];         // system/cpu0/port_use
+    double ipc;                // system/cpu0/ipc
+    const char * phase;        // system/phase
+    uint64_t access[4];        // system/cache/access, 2x2
+    uint64_t late;             // system/late, defined after snapshot 1
+} expected[NumSnapshots] = {
+    { 1000,  500,  500, 1000,        { 0, 7, 0 },     0.5,   "warmup",
+      { 0, 0, 0, 42 },   0 },
+    { 2000, 1000, 1100, 2000,        { 0, 7, 0 },     0.5,   "warmup",
+      { 0, 0, 0, 42 },   9 },
+    // counters may go backwards, and jump by more than 32 bits
+    { 3000, 1500, 2250, 0x123456789aULL, { 0, 3, 0 }, 0.75,  "measure",
+      { 1, 0, 0, 40 },   9 },
+    // nothing changes
+    { 4000, 2000, 3000, 0x123456789aULL, { 0, 3, 0 }, 0.75,  "measure",
+      { 1, 0, 0, 40 },   9 },
+    { 5000, 2500, 3900, 5,           { ~0ULL, 3, 1 }, -1e-300, "done",
+      { 1, 2, 3, 0 },    0 }
+};
+
+int main (void)
+{
+    string fileName = "test-statsbinary.bstats";
+
+    // write the snapshots
+    {
+        BinaryStatsWriter writer(fileName);
+        CHECK(writer.Ok());
+
+        uint32_t cycles = writer.DefineState(BinaryStats::TypeUint,
+            "system/cpu0", "cycles", "cycles simulated");
+        uint32_t ports = writer.DefineState(BinaryStats::TypeUint,
+            "system/cpu0", "port_use", "per port use", 3);
+        uint32_t ipc = writer.DefineState(BinaryStats::TypeDouble,
+            "system/cpu0", "ipc", "");
+        uint32_t phase = writer.DefineState(BinaryStats::TypeString,
+            "system", "phase", "run phase");
+        vector<string> rows, cols;
+        rows.push_back("0");
+        rows.push_back("1");
+        cols.push_back("hit");
+        cols.push_back("miss");
+        uint32_t hist = writer.DefineHistogram("system/cache", "access",
+            "accesses by bank", rows, cols);
+        uint32_t late = 0;
+
+        for (int n = 0; n < NumSnapshots; n++) {
+            if (n == 1) {
+                late = writer.DefineState(BinaryStats::TypeUint,
+                    "system", "late", "defined between snapshots");
+            }
+            if (n >= 1) {
+                writer.SetUint(late, 0, expected[n].late);
+            }
+            writer.SetUint(cycles, 0, expected[n].cycles);
+            for (int i = 0; i < 3; i++) {
+                writer.SetUint(ports, i, expected[n].ports[i]);
+            }
+            writer.SetDouble(ipc, 0, expected[n].ipc);
+            writer.SetString(phase, expected[n].phase);
+            for (int i = 0; i < 4; i++) {
+                writer.SetUint(hist, i, expected[n].access[i]);
+            }
+            writer.WriteSnapshot(expected[n].cycle, expected[n].nanosecond,
+                                 expected[n].insts);
+        }
+    }
+
+    // read them back and compare every value
+    BinaryStatsReader reader(fileName);
+    CHECK(reader.Ok());
+
+    for (int n = 0; n < NumSnapshots; n++) {
+        CHECK(reader.NextSnapshot());
+        CHECK(reader.Current().sequence == uint64_t(n));
+        CHECK(reader.Current().cycle == expected[n].cycle);
+        CHECK(reader.Current().nanosecond == expected[n].nanosecond);
+        CHECK(reader.Current().insts == expected[n].insts);
+
+        const BinaryStats::State * state;
+        CHECK((state = reader.Find("system/cpu0/cycles")) != NULL);
+        CHECK(state->uintValue[0] == expected[n].cycles);
+        CHECK((state = reader.Find("system/cpu0/port_use")) != NULL);
+        for (int i = 0; i < 3; i++) {
+            CHECK(state->uintValue[i] == expected[n].ports[i]);
+        }
+        CHECK((state = reader.Find("system/cpu0/ipc")) != NULL);
+        CHECK(state->doubleValue[0] == expected[n].ipc);
+        CHECK((state = reader.Find("system/phase")) != NULL);
+        CHECK(state->stringValue == expected[n].phase);
+        CHECK((state = reader.Find("system/cache/access")) != NULL);
+        CHECK(state->rows == 2 && state->cols == 2);
+        for (int i = 0; i < 4; i++) {
+            CHECK(state->uintValue[i] == expected[n].access[i]);
+        }
+
+        state = reader.Find("system/late");
+        if (n == 0) {
+            CHECK(state == NULL);
+        }
+        else {
+            CHECK(state != NULL && state->uintValue[0] == expected[n].late);
+        }
+    }
+
+    ostringstream xml;
+    reader.WriteXml(xml);
+    CHECK(xml.str().find("done") != string::npos);
+
+    CHECK( ! reader.NextSnapshot());
+    CHECK(reader.Ok());
+
+    // corrupt files fail the read instead of allocating what they claim
+    for (int bad = 0; bad < 3; bad++) {
+        string state;
+        BinaryStats::PutVarint(state, 0);                // id
+        BinaryStats::PutVarint(state, bad == 0 ? BinaryStats::TypeUint
+                                               : BinaryStats::TypeHistogram);
+        BinaryStats::PutVarint(state, 0);                // path
+        BinaryStats::PutVarint(state, 0);                // name
+        BinaryStats::PutVarint(state, 0);                // desc
+        BinaryStats::PutVarint(state, bad == 0 ? 1ULL << 40 : 0);
+        BinaryStats::PutVarint(state, 1ULL << 32);       // rows
+        BinaryStats::PutVarint(state, 1ULL << 32);       // cols, product 0
+
+        string file(BinaryStats::Magic(), BinaryStats::MagicSize);
+        BinaryStats::PutVarint(file, BinaryStats::Version);
+        file += char(BinaryStats::TagString);
+        BinaryStats::PutVarint(file, 1);
+        BinaryStats::PutVarint(file, 0);                 // "" is string 0
+        file += char(BinaryStats::TagState);
+        BinaryStats::PutVarint(file, bad == 2 ? 1ULL << 40 : state.size());
+        file += state;
+
+        FILE * out = fopen(fileName.c_str(), "wb");
+        CHECK(out != NULL);
+        fwrite(file.data(), 1, file.size(), out);
+        fclose(out);
+
+        BinaryStatsReader corrupt(fileName);
+        CHECK(corrupt.Ok());
+        CHECK( ! corrupt.NextSnapshot());
+        CHECK( ! corrupt.Ok());
+    }
+
+    unlink(fileName.c_str());
+    return 0;
+}
+#endif // TESTS
@@ -0,0 +1,235 @@
+/**************************************************************************
+ *Copyright (C) 2006 Intel Corporation
+ *
+ *This program is free software; you can redistribute it and/or
+ *modify it under the terms of the GNU General Public License
+ *as published by the Free Software Foundation; either version 2
+ *of the License, or (at your option) any later version.
+ *
+ *This program is distributed in the hope that it will be useful,
+ *but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *GNU General Public License for more details.
+ *
+ *You should have received a copy of the GNU General Public License
+ *along with this program; if not, write to the Free Software
+ *Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * @file
+ * @brief Reader / writer for Asim binary stats files (.bstats).
+ */
+
+#ifndef _STATSBINARY_
+#define _STATSBINARY_ 1
+
+// generic C
+#include <stdio.h>
+#include <stdint.h>
+
+// generic (C++)
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+
+// shared with the model's writer, in base/
+#include "statsbinary_format.h"
+
+using namespace std;
+
+/**
+ * @brief Layout of a binary stats file.
+ *
+ * A binary stats file holds a sequence of stats snapshots of one run.
+ * Each snapshot only carries the states that changed since the previous
+ * snapshot in the same file, and integer values are stored as the
+ * difference to their previous value.
+ *
+ * <pre>
+ * file     := magic version record*
+ * magic    := "ASIMBST\n"
+ * version  := varint
+ * record   := tag(1 byte) varint(payload length) payload
+ *
+ * STRING   := id                                   string table entry,
+ *             bytes                                rest of the payload
+ * STATE    := id type path name desc size          path, name and desc
+ *             [rows cols rowname* colname*]        are string ids; the
+ *                                                  bracket is only there
+ *                                                  for histograms
+ * SNAPSHOT := sequence cycle nanosecond insts
+ *             count (iddelta value*)*              changed states only
+ * </pre>
+ *
+ * All integers are unsigned LEB128 varints.  State ids in a snapshot
+ * are increasing and stored as the distance to the previous one.
+ * Uint and histogram cells are zigzag-encoded deltas against the
+ * previous snapshot (0 before the first), doubles are 8 raw
+ * little-endian IEEE bytes, strings are string ids.  Strings and
+ * states are defined before the first snapshot that refers to them.
+ * Readers skip records with unknown tags.
+ *
+ * The constants and encoding primitives are in BinaryStatsFormat
+ * (base/statsbinary_format.h), which modules/controller/classic/statsbin.cpp
+ * uses to write this format from inside a model.
+ */
+struct BinaryStats : public BinaryStatsFormat {
+    /// Most values in one state a reader accepts, so a corrupt file
+    /// can not make it allocate without bound.
+    static const uint32_t MaxStateSize = 1 << 24;
+
+
+    /// Description and current value of one state.
+    struct State {
+        uint32_t id;
+        Type type;
+        string path;               ///< enclosing modules, '/' separated
+        string name;
+        string desc;
+        uint32_t size;             ///< number of values
+        uint32_t rows;             ///< histograms only
+        uint32_t cols;             ///< histograms only
+        vector<string> rowNames;   ///< histograms only
+        vector<string> colNames;   ///< histograms only
+        vector<uint64_t> uintValue;
+        vector<double> doubleValue;
+        string stringValue;
+    };
+
+    /// Snapshot header.
+    struct Snapshot {
+        uint64_t sequence;
+        uint64_t cycle;
+        uint64_t nanosecond;
+        uint64_t insts;
+    };
+};
+
+
+/**
+ * @brief Sequential reader for binary stats files.
+ *
+ * Each call to NextSnapshot() applies the deltas of the next snapshot,
+ * after which States() holds the full value of every state as of that
+ * snapshot.
+ */
+class BinaryStatsReader {
+  private:
+    // members
+    FILE * in;                         ///< input file
+    string error;                      ///< last error, empty if none
+    vector<string> strings;            ///< string table, by id
+    vector<BinaryStats::State> states; ///< states, by id
+    vector<bool> defined;              ///< states[id] has been defined
+    BinaryStats::Snapshot current;     ///< header of current snapshot
+    string payload;                    ///< payload of current record
+
+    // methods
+    bool ReadRecord (int & tag);
+    bool DefineString (const string & buf);
+    bool DefineState (const string & buf);
+    bool ApplySnapshot (const string & buf);
+    const string * String (uint64_t id);
+
+  public:
+    // constructors/destructors
+    /// Open and check the header of a binary stats file.
+    BinaryStatsReader (const string & fileName);
+    /// Destructor
+    ~BinaryStatsReader ();
+
+    // accessors
+    /// False after an open, format or I/O error.
+    bool Ok () const { return error.empty(); }
+    /// Description of the last error.
+    const string & Error () const { return error; }
+    /// Header of the current snapshot.
+    const BinaryStats::Snapshot & Current () const { return current; }
+    /// All states known so far, indexed by id.  Entries of ids that
+    /// have not been defined have an empty name.
+    const vector<BinaryStats::State> & States () const { return states; }
+    /// Look up a state by "path/name".
+    const BinaryStats::State * Find (const string & fullName) const;
+
+    // modifiers
+    /// Advance to the next snapshot.  Returns false at end of file or
+    /// on error; check Ok() to tell them apart.
+    bool NextSnapshot ();
+
+    // output
+    /// Write the current snapshot in the XML stats format.
+    ostream & WriteXml (ostream & out) const;
+};
+
+
+/**
+ * @brief Writer for binary stats files.
+ *
+ * Define the states once, set their values, and call WriteSnapshot()
+ * for every snapshot.  Only values that changed since the previous
+ * snapshot are written.
+ */
+class BinaryStatsWriter {
+  private:
+    // types
+    struct Entry {
+        BinaryStats::State state;
+        vector<uint64_t> lastUint;
+        vector<double> lastDouble;
+        string lastString;
+        bool written;              ///< included in at least one snapshot
+    };
+
+    // members
+    FILE * out;                        ///< output file
+    uint64_t sequence;                 ///< next snapshot number
+    map<string, uint32_t> stringIds;   ///< string table
+    vector<Entry> entries;             ///< states, by id
+    string record;                     ///< record being assembled
+
+    // methods
+    uint32_t StringId (const string & str);
+    void WriteRecord (int tag, const string & buf);
+
+  public:
+    // constructors/destructors
+    /// Create (truncate) a binary stats file.
+    BinaryStatsWriter (const string & fileName);
+    /// Flush and close the file.
+    ~BinaryStatsWriter ();
+
+    /// False if the file could not be created.
+    bool Ok () const { return out != NULL; }
+
+    // modifiers
+    /// Define a scalar or vector state; returns its id.
+    uint32_t DefineState (BinaryStats::Type type, const string & path,
+        const string & name, const string & desc, uint32_t size = 1);
+    /// Define a histogram state; returns its id.
+    uint32_t DefineHistogram (const string & path, const string & name,
+        const string & desc, const vector<string> & rowNames,
+        const vector<string> & colNames);
+
+    /// Set the value of element idx of a uint or histogram state.
+    void SetUint (uint32_t id, uint32_t idx, uint64_t value)
+    {
+        entries[id].state.uintValue[idx] = value;
+    }
+    /// Set the value of element idx of a double state.
+    void SetDouble (uint32_t id, uint32_t idx, double value)
+    {
+        entries[id].state.doubleValue[idx] = value;
+    }
+    /// Set the value of a string state.
+    void SetString (uint32_t id, const string & value)
+    {
+        entries[id].state.stringValue = value;
+    }
+
+    /// Append a snapshot of the current values.
+    void WriteSnapshot (uint64_t cycle, uint64_t nanosecond, uint64_t insts);
+};
+
+#endif // _STATSBINARY_
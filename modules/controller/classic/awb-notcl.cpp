@@ -178,31 +178,6 @@ myexit(int r)
     ::exit(r);
 }
 
-static bool
-match_nocase(const string& s1,
-             const string& s2)
-{
-    string::const_iterator p1 = s1.begin();
-    string::const_iterator p2 = s2.begin();
-    while(p1 != s1.end() && p2 != s2.end())
-    {
-        if (toupper(*p1) != toupper(*p2))
-        {
-            return false;
-        }
-        p1++;
-        p2++;
-    }
-
-    if (s1.size() == s2.size())
-    {
-        return true;
-    }
-    return false;
-}
-
-
-
 ///////////////////////////////////////////////////////////////////////////
 
 
@@ -617,19 +592,12 @@ PmStateFind (string sname)
  * or "" if can't find.
  */
 {
-    ASIM_STATELINK scan = PmStateList();
-    while (scan != NULL) {
-        ASIM_STATE state = scan->state;
-
-        const string sn(state->Name());
-        if (match_nocase(sname, sn))
-        {
-            ostringstream os;
-            os << "STATE__" << fmt_p((void *)state) ;
-            return os.str();
-        }
-
-        scan = scan->next;
+    ASIM_STATE state = asimSystem->StateRegistry()->FindName(sname.c_str());
+    if (state != NULL)
+    {
+        ostringstream os;
+        os << "STATE__" << fmt_p((void *)state) ;
+        return os.str();
     }
     string retval = "";
     return retval;
@@ -108,10 +108,30 @@ char *awbCmdFile = "";
 char *overrideWorkbench = NULL;
 
 /*
- * Pending progress events
+ * Pending progress events, oldest first, as typed records.
+ * Periodic reports (cycle, inst, ...) are coalesced: the workbench
+ * reads the current model state when it shows one, so a new report
+ * replaces a pending one of the same kind and goes to the tail.  They
+ * are passed on at most every AWB_PROGRESS_INTERVAL ms.  All other
+ * events are passed on at the next AWB_InformProgress(), since the
+ * workbench may act on them.
  */
-static UINT32 pendingProgressSz = 0;
-static char *pendingProgress = NULL;
+#define AWB_PROGRESS_MAX 256
+
+struct AWB_PROGRESS_RECORD
+{
+    AWB_PROGRESSTYPE type;
+    string args;
+};
+
+static AWB_PROGRESS_RECORD pendingProgress[AWB_PROGRESS_MAX];
+static UINT32 pendingCount = 0;
+static bool pendingUrgent = false;      // a non-periodic record is pending
+static INT32 pendingPeriodic[AWBPROG_EVENTOVERFLOW + 1];  // slot or -1
+static UINT64 lastInformNs = 0;         // last BatchProgress call
+static string batchProgress;            // argument of BatchProgress
+
+static void AwbFlushProgress (void);
 
 /*
  * Dump file for events
@@ -136,9 +156,11 @@ AWB_TRACER awbTracer;
 void
 AWB_Initialize (void)
 {
-    pendingProgressSz = 1024;
-    pendingProgress = Tcl_Alloc(pendingProgressSz);
-    pendingProgress[0] = '\0';
+    pendingCount = 0;
+    pendingUrgent = false;
+    for (UINT32 i = 0; i <= AWBPROG_EVENTOVERFLOW; i++) {
+        pendingPeriodic[i] = -1;
+    }
     // Initialize events structure. Must be done before creatiung any bow or buffer.
     EVENT(ASIM_DRAL_EVENT_CLASS::InitEvent());
 }
@@ -156,62 +178,112 @@ AWB_Activate (void)
 
 
 
+static inline bool
+AwbPeriodicProgress (AWB_PROGRESSTYPE type)
+{
+    return type == AWBPROG_CYCLE || type == AWBPROG_INST ||
+           type == AWBPROG_MACROINST || type == AWBPROG_PACKET ||
+           type == AWBPROG_NANOSECOND;
+}
+
+
 void
 AWB_Progress (AWB_PROGRESSTYPE type, const char *args)
 /*
- * Exit awb...
+ * Record a progress event for the workbench.
  */
 {
-    static char *pStrs[] = AWB_PROGRESSSTRS;
-    
-    //
-    // Add progress to the list of pending progress events.
+    if (AwbPeriodicProgress(type) && pendingPeriodic[type] >= 0) {
+        // drop the older report so the new one keeps its place in order
+        for (UINT32 i = pendingPeriodic[type] + 1; i < pendingCount; i++) {
+            pendingProgress[i - 1] = pendingProgress[i];
+            if (AwbPeriodicProgress(pendingProgress[i - 1].type)) {
+                pendingPeriodic[pendingProgress[i - 1].type] = i - 1;
+            }
+        }
+        pendingCount--;
+    }
 
-    const UINT32 newSz = strlen(pendingProgress) + strlen(pStrs[type]) + strlen(args) + 10;
-    if (newSz >= pendingProgressSz) {
-        pendingProgressSz = MAX(pendingProgressSz * 2, newSz);
-        pendingProgress = Tcl_Realloc(pendingProgress, pendingProgressSz);
+    if (pendingCount == AWB_PROGRESS_MAX) {
+        AwbFlushProgress();
     }
 
-    if (pendingProgress[0] != '\0')
-        strcat(pendingProgress, " ");
-    strcat(pendingProgress, pStrs[type]);
+    UINT32 slot = pendingCount;
+    pendingProgress[slot].type = type;
+    pendingProgress[slot].args = args;
+    pendingCount++;
 
-    if (strlen(args) == 0) {
-        strcat(pendingProgress, " {}");
+    if (AwbPeriodicProgress(type)) {
+        pendingPeriodic[type] = slot;
     }
     else {
-        strcat(pendingProgress, " ");
-        strcat(pendingProgress, args);
+        pendingUrgent = true;
     }
 }    
 
 
+static void
+AwbFlushProgress (void)
+/*
+ * Hand all pending progress events to the workbench in one
+ * BatchProgress call.
+ */
+{
+    static const char *pStrs[] = AWB_PROGRESSSTRS;
+
+    batchProgress.clear();
+    for (UINT32 i = 0; i < pendingCount; i++) {
+        const AWB_PROGRESS_RECORD &rec = pendingProgress[i];
+        if (i != 0) {
+            batchProgress += ' ';
+        }
+        batchProgress += pStrs[rec.type];
+        batchProgress += ' ';
+        batchProgress += rec.args.empty() ? "{}" : rec.args;
+    }
+
+    pendingCount = 0;
+    pendingUrgent = false;
+    for (UINT32 i = 0; i <= AWBPROG_EVENTOVERFLOW; i++) {
+        pendingPeriodic[i] = -1;
+    }
+    lastInformNs = CMD_LoopClock();
+
+    T1_AS(&awbTracer, "TCL_CMD: "
+          << "BatchProgress { "
+          << batchProgress
+          << " }");
+
+    INT32 eval = Tcl_VarEval(awbInterp, "BatchProgress { ",
+                             batchProgress.c_str(), " }", NULL);
+
+    if ( eval != TCL_OK) {
+        ASIMERROR("AWB_InformProgress: "
+            << Tcl_GetStringResult(awbInterp) << endl); 
+    }
+}
+
+
 void
 AWB_InformProgress (void)
 /*
- * Notify the workbench of the progress events that are pending,
- * and wait for it to acknowledge that it has processed all the
- * events.
+ * Notify the workbench of the progress events that are pending, and
+ * wait for it to acknowledge that it has processed all the events.
+ * Periodic reports alone are held back until AWB_PROGRESS_INTERVAL
+ * has passed since the last notification.
  */
 {
-    if (pendingProgress[0] != '\0') {
-        T1_AS(&awbTracer, "TCL_CMD: "
-              << "BatchProgress { "
-              << pendingProgress
-              << " }");
-    
-        INT32 eval = Tcl_VarEval(awbInterp, "BatchProgress { ", pendingProgress, " }", NULL);
+    if (pendingCount == 0) {
+        return;
+    }
 
-        if ( eval != TCL_OK) {
-            ASIMERROR("AWB_InformProgress: "
-                << Tcl_GetStringResult(awbInterp) << endl); 
-        }
-        
-        pendingProgress[0] = '\0';
+    if (! pendingUrgent &&
+        CMD_LoopClock() - lastInformNs < (UINT64) AWB_PROGRESS_INTERVAL * 1000000)
+    {
+        return;
     }
 
-    VERIFYX(pendingProgress[0] == '\0');
+    AwbFlushProgress();
 }
 
 void
@@ -228,10 +300,6 @@ AWB_Exit (void)
     AWB_InformProgress();
 
     // gracefully shut down TCL - let it free its memory
-    if (pendingProgress) {
-        Tcl_Free(pendingProgress);
-        pendingProgress = NULL;
-    }
     Tcl_DeleteInterp(awbInterp);
     awbInterp = NULL;
     Tcl_Finalize();
@@ -714,19 +782,13 @@ PmStateFind (Tcl_Interp *interp, char *name)
  * or "" if can't find.
  */
 {
-    ASIM_STATELINK scan = PmStateList();
-    while (scan != NULL) {
-        ASIM_STATE state = scan->state;
-
-        if (strcasecmp(state->Name(), name) == 0) {
-            ostringstream os;
-            os << "STATE__" << fmt_p((void *)state);
-            Tcl_SetResult(interp,
-                const_cast<char*>(os.str().c_str()), TCL_VOLATILE);
-            return(TCL_OK);
-        }
-
-        scan = scan->next;
+    ASIM_STATE state = asimSystem->StateRegistry()->FindName(name);
+    if (state != NULL) {
+        ostringstream os;
+        os << "STATE__" << fmt_p((void *)state);
+        Tcl_SetResult(interp,
+            const_cast<char*>(os.str().c_str()), TCL_VOLATILE);
+        return(TCL_OK);
     }
 
     Tcl_SetResult(interp, "", TCL_STATIC);
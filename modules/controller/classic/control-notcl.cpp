@@ -35,6 +35,7 @@
 // ASIM public modules
 #include "asim/provides/instfeeder_interface.h"
 #include "asim/provides/controller.h"
+#include "emitstats.h"
 
 #define DMSG(x) \
 ({ \
@@ -55,6 +56,11 @@ CMD_ACK PmProcessEvent (CMD_WORKITEM workItem);
  */
 ASIM_SYSTEM asimSystem;
 
+/*
+ * Time spent in the parts of the scheduler loop.
+ */
+CMD_LOOP_PROFILE cmdLoopProfile;
+
 /*
  * 'ctrlWorkList' contains new work items that the controller needs to
  * schedule.  The performance model and awb puts things on the list.
@@ -496,6 +502,23 @@ CMD_UnscheduleThread (ASIM_THREAD thread, CMD_ACTIONTRIGGER trigger, UINT64 n)
 }
 
 
+void
+CMD_ScheduleItem (CMD_WORKITEM item)
+/*
+ * Schedule a work item created outside the controller.
+ */
+{
+    XMSG( "CMD_ScheduleItem " << item->Name() << "...");
+
+    //
+    // Hand the item to the controller and break the performance model
+    // so that it will return control to the controller if it is executing.
+
+    ctrlWorkList->Add(item);
+    asimSystem->SYS_Break();
+}
+
+
 
 void
 CMD_Exit (CMD_ACTIONTRIGGER trigger, UINT64 n)
@@ -529,6 +552,9 @@ CMD_SchedulerLoop (void)
     XMSG("CMD_SchedulerLoop");
     while ( ! pmExiting )
     {
+        const UINT64 loopStart = CMD_LoopClock();
+        const UINT64 emitStatsBefore = cmdLoopProfile.emitStatsNs;
+        cmdLoopProfile.loops++;
         
         const UINT64 currentCycle = asimSystem->SYS_Cycle();
         
@@ -627,6 +653,23 @@ CMD_SchedulerLoop (void)
         XMSG("CMD_SchedulerLoop -> AWB_InformProgress");
         AWB_InformProgress();
         XMSG("CMD_SchedulerLoop -> past AWB_InformProgress");
+
+        //
+        // Account for the time up to here; while the model is stopped
+        // the controller mostly waits for new work.
+
+        const UINT64 scheduleEnd = CMD_LoopClock();
+        const UINT64 scheduleNs = scheduleEnd - loopStart -
+            (cmdLoopProfile.emitStatsNs - emitStatsBefore);
+        if (pmStopped)
+        {
+            cmdLoopProfile.idleNs += scheduleNs;
+        }
+        else
+        {
+            cmdLoopProfile.scheduleNs += scheduleNs;
+        }
+
         //
         // If the performance model is stopped, then don't allow it
         // to execute.
@@ -654,6 +697,7 @@ CMD_SchedulerLoop (void)
             XMSG("CMD_SchedulerLoop -> PmProcessEvent CMD_EXECUTE_CLASS");
             CMD_ACK ack = PmProcessEvent(
                 new CMD_EXECUTE_CLASS(nNanosecond, nCycle, nInst,nMacroInst, nPacket));
+            cmdLoopProfile.executeNs += CMD_LoopClock() - scheduleEnd;
 
             delete ack->WorkItem();
             delete ack;
@@ -673,6 +717,9 @@ CMD_SchedulerLoop (void)
     // Stop the awb workbench
     AWB_Exit();
 
+    // intermediate stats still being written in the background
+    CMD_EmitStatsDrain();
+
     // print "AtExit" stats
     if (StatsFileName)
     {
@@ -763,6 +810,12 @@ CMD_PROGRESS_CLASS::CmdAction (void)
 void
 CMD_EMITSTATS_CLASS::CmdAction (void)
 {
+    if (EMITSTATS_BINARY)
+    {
+        CMD_EmitStatsSnapshot();
+        return;
+    }
+
     ostringstream statsFileName;
 
     statsFileName.str("");      // Clear
@@ -770,17 +823,7 @@ CMD_EMITSTATS_CLASS::CmdAction (void)
 
     XMSG("CMD_EMITSTATS emitting intermediate stats: " << statsFileName.str());
 
-    STATE_OUT stateOut = new STATE_OUT_CLASS(statsFileName.str().c_str());
-    if (! stateOut) 
-    {
-        ASIMERROR("Unable to create stats output file \"" <<
-                  statsFileName.str() << "\", " << strerror(errno));
-    }
-
-    asimSystem->PrintModuleStats(stateOut); 
-    IFEEDER_BASE_CLASS::DumpAllFeederStats(stateOut);
-
-    delete stateOut;
+    CMD_EmitStats(statsFileName.str().c_str());
 }
 
 
@@ -26,6 +26,9 @@
 #define _AWBCMD_
 
 
+// generic
+#include <time.h>
+
 // ASIM core
 #include "asim/syntax.h"
 #include "asim/stateout.h"
@@ -174,6 +177,14 @@ extern void CMD_SkipThread (ASIM_THREAD thread, UINT64 insts, INT32 markerID,
 extern void CMD_ScheduleThread (ASIM_THREAD thread, CMD_ACTIONTRIGGER trigger =ACTION_NOW, UINT64 n =0);
 extern void CMD_UnscheduleThread (ASIM_THREAD thread, CMD_ACTIONTRIGGER trigger =ACTION_NOW, UINT64 n =0);
 
+/*
+ * Schedule a work item built by another module, e.g. a remote interface.
+ * The controller runs its CmdAction() at the time given by its trigger and
+ * deletes it afterwards, unless it is periodic.
+ */
+class CMD_WORKITEM_CLASS;
+extern void CMD_ScheduleItem (CMD_WORKITEM_CLASS *item);
+
 
 
 /********************************************************************
@@ -184,6 +195,40 @@ extern void CMD_UnscheduleThread (ASIM_THREAD thread, CMD_ACTIONTRIGGER trigger
 
 extern ASIM_SYSTEM asimSystem;
 
+/*
+ * Strip chart dumping, toggled by the STRIPCHART action.
+ */
+extern bool stripsOn;
+
+
+/********************************************************************
+ *
+ * Where the controller spends its time, for monitoring live runs.
+ * Times are wall clock nanoseconds.  Only the controller thread
+ * updates it, so read it from that thread too.
+ *
+ ********************************************************************/
+
+struct CMD_LOOP_PROFILE
+{
+    UINT64 loops;           // scheduler loop iterations
+    UINT64 scheduleNs;      // in the scheduler loop, outside of the others
+    UINT64 executeNs;       // in SYS_Execute
+    UINT64 emitStatsNs;     // writing intermediate stats
+    UINT64 emitStats;       // intermediate stats written
+    UINT64 idleNs;          // waiting while the model is stopped
+};
+
+extern CMD_LOOP_PROFILE cmdLoopProfile;
+
+inline UINT64
+CMD_LoopClock (void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return UINT64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
 
 
 
@@ -36,6 +36,7 @@
 // ASIM public modules
 #include "asim/provides/instfeeder_interface.h"
 #include "asim/provides/controller.h"
+#include "emitstats.h"
 // we need this so we can statically know the type of "theController"
 // in the API functions declared using CONTROLLER_BASE_EXTERNAL_FUNCTION
 #include "asim/provides/controller_alg.h"
@@ -47,6 +48,11 @@ CONTROL_TRACEABLE_CLASS controlTraceable;
  */
 ASIM_SYSTEM asimSystem;
 
+/*
+ * Time spent in the parts of the scheduler loop.
+ */
+CMD_LOOP_PROFILE cmdLoopProfile;
+
 extern bool stripsOn;
 
 /*
@@ -544,6 +550,26 @@ CONTROLLER_BASE_EXTERNAL_FUNCTION(
 }
 
 
+CONTROLLER_BASE_EXTERNAL_FUNCTION( 
+  void, CMD_ScheduleItem,
+  (CMD_WORKITEM item),
+  (             item)
+)
+/*
+ * Schedule a work item created outside the controller.
+ */
+{
+    ASIM_XMSG("CMD_ScheduleItem " << item->Name() << "...");
+
+    //
+    // Hand the item to the controller and break the performance model
+    // so that it will return control to the controller if it is executing.
+
+    ctrlWorkList->Add(item);
+    asimSystem->SYS_Break();
+}
+
+
 
 CONTROLLER_BASE_EXTERNAL_FUNCTION( 
   void, CMD_Exit,
@@ -581,6 +607,9 @@ CONTROLLER_BASE_EXTERNAL_FUNCTION(
     ASIM_XMSG("CMD_SchedulerLoop");
     while ( ! pmExiting )
     {
+        const UINT64 loopStart = CMD_LoopClock();
+        const UINT64 emitStatsBefore = cmdLoopProfile.emitStatsNs;
+        cmdLoopProfile.loops++;
         
         const UINT64 currentCycle = asimSystem->SYS_Cycle();
         
@@ -677,6 +706,23 @@ CONTROLLER_BASE_EXTERNAL_FUNCTION(
         ASIM_XMSG("CMD_SchedulerLoop -> AWB_InformProgress");
         AWB_InformProgress();
         ASIM_XMSG("CMD_SchedulerLoop -> past AWB_InformProgress");
+
+        //
+        // Account for the time up to here; while the model is stopped
+        // the controller mostly waits for new work.
+
+        const UINT64 scheduleEnd = CMD_LoopClock();
+        const UINT64 scheduleNs = scheduleEnd - loopStart -
+            (cmdLoopProfile.emitStatsNs - emitStatsBefore);
+        if (pmStopped)
+        {
+            cmdLoopProfile.idleNs += scheduleNs;
+        }
+        else
+        {
+            cmdLoopProfile.scheduleNs += scheduleNs;
+        }
+
         //
         // If the performance model is stopped, then don't allow it
         // to execute.
@@ -706,6 +752,7 @@ CONTROLLER_BASE_EXTERNAL_FUNCTION(
             ASIM_XMSG("CMD_SchedulerLoop -> PmProcessEvent CMD_EXECUTE_CLASS");
             CMD_ACK ack = PmProcessEvent(
                 new CMD_EXECUTE_CLASS(nNanosecond, nCycle, nInst, nMacroInst, nPacket));
+            cmdLoopProfile.executeNs += CMD_LoopClock() - scheduleEnd;
 
             delete ack->WorkItem();
             delete ack;
@@ -725,6 +772,9 @@ CONTROLLER_BASE_EXTERNAL_FUNCTION(
     // Stop the awb workbench
     AWB_Exit();
 
+    // intermediate stats still being written in the background
+    CMD_EmitStatsDrain();
+
     // print "AtExit" stats
     if (StatsFileName)
     {
@@ -814,6 +864,12 @@ CMD_PROGRESS_CLASS::CmdAction (void)
 void
 CMD_EMITSTATS_CLASS::CmdAction (void)
 {
+    if (EMITSTATS_BINARY)
+    {
+        CMD_EmitStatsSnapshot();
+        return;
+    }
+
     ostringstream statsFileName;
 
     UINT64 currentInst = 0;
@@ -830,17 +886,7 @@ CMD_EMITSTATS_CLASS::CmdAction (void)
 
     ASIM_XMSG("CMD_EMITSTATS emitting intermediate stats: " << statsFileName.str());
 
-    STATE_OUT stateOut = new STATE_OUT_CLASS(statsFileName.str().c_str());
-    if (! stateOut) 
-    {
-        ASIMERROR("Unable to create stats output file \"" <<
-                  statsFileName.str() << "\", " << strerror(errno));
-    }
-
-    asimSystem->PrintModuleStats(stateOut); 
-    IFEEDER_BASE_CLASS::DumpAllFeederStats(stateOut);
-
-    delete stateOut;
+    CMD_EmitStats(statsFileName.str().c_str());
 }
 
 
@@ -0,0 +1,272 @@
+/*
+ *Copyright (C) 2006 Intel Corporation
+ *
+ *This program is free software; you can redistribute it and/or
+ *modify it under the terms of the GNU General Public License
+ *as published by the Free Software Foundation; either version 2
+ *of the License, or (at your option) any later version.
+ *
+ *This program is distributed in the hope that it will be useful,
+ *but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *GNU General Public License for more details.
+ *
+ *You should have received a copy of the GNU General Public License
+ *along with this program; if not, write to the Free Software
+ *Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * @file
+ * @brief Intermediate stats emission for the classic controllers
+ */
+
+// generic
+#include <deque>
+#include <dirent.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+// ASIM core
+#include "asim/syntax.h"
+#include "asim/mesg.h"
+#include "asim/trace.h"
+#include "asim/stateout.h"
+
+// ASIM public modules
+#include "asim/provides/instfeeder_interface.h"
+#include "asim/provides/controller.h"
+
+#include "emitstats.h"
+#include "statsbin.h"
+
+using namespace std;
+
+extern ASIM_SYSTEM asimSystem;
+
+/*
+ * Process ids of the background stats writers still running, oldest
+ * first.
+ */
+static deque<pid_t> pendingWriters;
+
+/*
+ * Binary stats file, opened by the first snapshot.
+ */
+static STATS_BINARY_WRITER binaryWriter = NULL;
+
+
+static void
+WriteStats (const char *fileName)
+{
+    STATE_OUT stateOut = new STATE_OUT_CLASS(fileName);
+    if (! stateOut)
+    {
+        ASIMERROR("Unable to create stats output file \"" <<
+                  fileName << "\", " << strerror(errno));
+    }
+
+    asimSystem->PrintModuleStats(stateOut);
+    IFEEDER_BASE_CLASS::DumpAllFeederStats(stateOut);
+
+    delete stateOut;
+}
+
+
+/*
+ * Wait for the oldest background writer.
+ */
+static void
+ReapOldestWriter (void)
+{
+    pid_t pid = pendingWriters.front();
+    pendingWriters.pop_front();
+
+    int status;
+    while (waitpid(pid, &status, 0) < 0)
+    {
+        if (errno != EINTR)
+        {
+            // ECHILD: somebody else reaped it already
+            return;
+        }
+    }
+
+    if (! WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        cerr << "Warning: background stats writer " << pid
+             << " failed" << endl;
+    }
+}
+
+
+/*
+ * Forget about writers that have already finished without blocking.
+ */
+static void
+ReapFinishedWriters (void)
+{
+    while (! pendingWriters.empty())
+    {
+        int status;
+        pid_t pid = pendingWriters.front();
+        pid_t r = waitpid(pid, &status, WNOHANG);
+        if (r == 0)
+        {
+            // oldest one still running, later ones are checked next time
+            return;
+        }
+
+        pendingWriters.pop_front();
+        if (r == pid && (! WIFEXITED(status) || WEXITSTATUS(status) != 0))
+        {
+            cerr << "Warning: background stats writer " << pid
+                 << " failed" << endl;
+        }
+    }
+}
+
+
+/*
+ * True if the simulator runs more than one thread, e.g. the Tarati I/O
+ * thread (TARATI_IO_THREAD) or the warm-up feeders (WARMUP_PARALLEL).
+ * A forked child has only the calling thread, and any lock another
+ * thread held at the fork stays locked forever, so writing stats from
+ * it could hang.  If the threads can't be counted assume there are
+ * others.
+ */
+static bool
+OtherThreadsLive (void)
+{
+    DIR *dir = opendir("/proc/self/task");
+    if (! dir)
+    {
+        return true;
+    }
+
+    UINT32 nThreads = 0;
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL)
+    {
+        if (ent->d_name[0] != '.')
+        {
+            nThreads++;
+        }
+    }
+    closedir(dir);
+
+    return nThreads != 1;
+}
+
+
+static void
+EmitStats (const char *fileName)
+{
+    if (! EMITSTATS_ASYNC)
+    {
+        WriteStats(fileName);
+        return;
+    }
+
+    if (OtherThreadsLive())
+    {
+        static bool warned = false;
+        if (! warned)
+        {
+            cerr << "Warning: simulator is multi-threaded, "
+                 << "EMITSTATS_ASYNC ignored while other threads run" << endl;
+            warned = true;
+        }
+        WriteStats(fileName);
+        return;
+    }
+
+    ReapFinishedWriters();
+
+    UINT32 maxPending = EMITSTATS_MAX_PENDING ? EMITSTATS_MAX_PENDING : 1;
+    while (pendingWriters.size() >= maxPending)
+    {
+        ReapOldestWriter();
+    }
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        // Child: write the stats and leave without running any exit
+        // handlers or destructors of the simulator state we share.
+        WriteStats(fileName);
+        _exit(0);
+    }
+    else if (pid < 0)
+    {
+        cerr << "Warning: unable to fork stats writer, " << strerror(errno)
+             << ", writing \"" << fileName << "\" synchronously" << endl;
+        WriteStats(fileName);
+        return;
+    }
+
+    pendingWriters.push_back(pid);
+}
+
+
+/*
+ * Charge the time since 'start' to stats emission.
+ */
+static void
+AccountEmitStats (UINT64 start)
+{
+    cmdLoopProfile.emitStatsNs += CMD_LoopClock() - start;
+    cmdLoopProfile.emitStats++;
+}
+
+
+void
+CMD_EmitStats (const char *fileName)
+{
+    const UINT64 start = CMD_LoopClock();
+    EmitStats(fileName);
+    AccountEmitStats(start);
+}
+
+
+void
+CMD_EmitStatsSnapshot (void)
+{
+    const UINT64 start = CMD_LoopClock();
+
+    if (! binaryWriter)
+    {
+        binaryWriter = new STATS_BINARY_WRITER_CLASS(EMITSTATS_BINARY_FILE.c_str());
+    }
+
+    UINT64 currentInst = 0;
+    for (UINT32 i = 0; i < asimSystem->NumCpus(); i++)
+    {
+        currentInst += asimSystem->SYS_CommittedInsts(i);
+    }
+
+    binaryWriter->Snapshot(asimSystem->SYS_Cycle(),
+                           asimSystem->SYS_Nanosecond(),
+                           currentInst);
+
+    AccountEmitStats(start);
+}
+
+
+void
+CMD_EmitStatsDrain (void)
+{
+    while (! pendingWriters.empty())
+    {
+        ReapOldestWriter();
+    }
+
+    if (binaryWriter)
+    {
+        delete binaryWriter;
+        binaryWriter = NULL;
+    }
+}
@@ -0,0 +1,58 @@
+/*
+ *Copyright (C) 2006 Intel Corporation
+ *
+ *This program is free software; you can redistribute it and/or
+ *modify it under the terms of the GNU General Public License
+ *as published by the Free Software Foundation; either version 2
+ *of the License, or (at your option) any later version.
+ *
+ *This program is distributed in the hope that it will be useful,
+ *but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *GNU General Public License for more details.
+ *
+ *You should have received a copy of the GNU General Public License
+ *along with this program; if not, write to the Free Software
+ *Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * @file
+ * @brief Intermediate stats emission for the classic controllers
+ */
+
+#ifndef _EMITSTATS_
+#define _EMITSTATS_
+
+// ASIM core
+#include "asim/syntax.h"
+
+/*
+ * Write the module and feeder stats of the running system to
+ * 'fileName'.
+ *
+ * With EMITSTATS_ASYNC the simulator forks and the child process
+ * formats and writes the file while the parent keeps simulating.  The
+ * copy-on-write address space of the child is the snapshot, so the
+ * file contents are exactly what a synchronous dump at this point
+ * would have produced.  At most EMITSTATS_MAX_PENDING writers are
+ * outstanding; further requests wait for the oldest one to finish.
+ * If the fork fails, or other threads are running (TARATI_IO_THREAD,
+ * WARMUP_PARALLEL) and might hold locks the child would need, the
+ * stats are written synchronously.
+ */
+extern void CMD_EmitStats (const char *fileName);
+
+/*
+ * Append a snapshot of the model state to the binary stats file
+ * EMITSTATS_BINARY_FILE instead of writing a stats file per call.
+ */
+extern void CMD_EmitStatsSnapshot (void);
+
+/*
+ * Wait for all outstanding background stats writers and close the
+ * binary stats file.  Called before the system is torn down.
+ */
+extern void CMD_EmitStatsDrain (void);
+
+#endif /* _EMITSTATS_ */
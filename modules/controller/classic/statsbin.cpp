@@ -0,0 +1,245 @@
+/*
+ *Copyright (C) 2006 Intel Corporation
+ *
+ *This program is free software; you can redistribute it and/or
+ *modify it under the terms of the GNU General Public License
+ *as published by the Free Software Foundation; either version 2
+ *of the License, or (at your option) any later version.
+ *
+ *This program is distributed in the hope that it will be useful,
+ *but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *GNU General Public License for more details.
+ *
+ *You should have received a copy of the GNU General Public License
+ *along with this program; if not, write to the Free Software
+ *Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * @file
+ * @brief Binary stats snapshot writer
+ */
+
+// generic
+#include <errno.h>
+#include <string.h>
+
+// ASIM core
+#include "asim/syntax.h"
+#include "asim/mesg.h"
+#include "asim/state.h"
+
+// ASIM public modules
+#include "asim/provides/controller.h"
+
+#include "statsbin.h"
+
+extern ASIM_SYSTEM asimSystem;
+
+STATS_BINARY_WRITER_CLASS::STATS_BINARY_WRITER_CLASS (
+    const char *fileName)
+    : sequence(0),
+      registered(false)
+{
+    out = fopen(fileName, "wb");
+    if (! out)
+    {
+        ASIMERROR("Unable to create stats output file \"" <<
+                  fileName << "\", " << strerror(errno));
+    }
+
+    string header(FORMAT::Magic(), FORMAT::MagicSize);
+    FORMAT::PutVarint(header, FORMAT::Version);
+    fwrite(header.data(), 1, header.size(), out);
+}
+
+
+STATS_BINARY_WRITER_CLASS::~STATS_BINARY_WRITER_CLASS ()
+{
+    fclose(out);
+}
+
+
+void
+STATS_BINARY_WRITER_CLASS::WriteRecord (
+    int tag,
+    const string& buf)
+{
+    string header(1, char(tag));
+    FORMAT::PutVarint(header, buf.size());
+    fwrite(header.data(), 1, header.size(), out);
+    fwrite(buf.data(), 1, buf.size(), out);
+}
+
+
+UINT32
+STATS_BINARY_WRITER_CLASS::StringId (
+    const string& str)
+{
+    map<string, UINT32>::iterator it = stringIds.find(str);
+    if (it != stringIds.end())
+    {
+        return it->second;
+    }
+
+    UINT32 id = stringIds.size();
+    stringIds[str] = id;
+
+    record.clear();
+    FORMAT::PutVarint(record, id);
+    record += str;
+    WriteRecord(FORMAT::TagString, record);
+    return id;
+}
+
+
+void
+STATS_BINARY_WRITER_CLASS::RegisterStates (void)
+{
+    STATE_ITERATOR_CLASS iter(asimSystem, true);
+    ASIM_STATE state;
+
+    while ((state = iter.Next()) != NULL)
+    {
+        UINT32 type;
+        switch (state->Type())
+        {
+          case STATE_UINT:   type = FORMAT::TypeUint;   break;
+          case STATE_FP:     type = FORMAT::TypeDouble; break;
+          case STATE_STRING: type = FORMAT::TypeString; break;
+          default:
+            // histograms and resources have no per-cell accessors
+            continue;
+        }
+
+        ENTRY entry;
+        entry.state = state;
+        entry.id = entries.size();
+        entry.type = type;
+        entry.written = false;
+        UINT32 size = (type == FORMAT::TypeString) ? 1 : state->Size();
+        if (type == FORMAT::TypeUint)
+        {
+            entry.lastUint.assign(size, 0);
+        }
+        else if (type == FORMAT::TypeDouble)
+        {
+            entry.lastFp.assign(size, 0.0);
+        }
+        entries.push_back(entry);
+
+        UINT32 pathId = StringId(state->Path() ? state->Path() : "");
+        UINT32 nameId = StringId(state->Name());
+        UINT32 descId = StringId(state->Description() ?
+                                 state->Description() : "");
+
+        record.clear();
+        FORMAT::PutVarint(record, entry.id);
+        FORMAT::PutVarint(record, type);
+        FORMAT::PutVarint(record, pathId);
+        FORMAT::PutVarint(record, nameId);
+        FORMAT::PutVarint(record, descId);
+        FORMAT::PutVarint(record, size);
+        WriteRecord(FORMAT::TagState, record);
+    }
+
+    registered = true;
+}
+
+
+void
+STATS_BINARY_WRITER_CLASS::Snapshot (
+    UINT64 cycle,
+    UINT64 nanosecond,
+    UINT64 insts)
+{
+    if (! registered)
+    {
+        RegisterStates();
+    }
+
+    body.clear();
+    UINT32 count = 0;
+    UINT32 lastId = 0;
+
+    for (UINT32 i = 0; i < entries.size(); i++)
+    {
+        ENTRY& entry = entries[i];
+        ASIM_STATE state = entry.state;
+
+        // Find out whether anything changed before emitting the entry,
+        // so that unchanged counters cost nothing in the file.
+        bool changed = ! entry.written;
+        switch (entry.type)
+        {
+          case FORMAT::TypeUint:
+            for (UINT32 v = 0; ! changed && v < entry.lastUint.size(); v++)
+            {
+                changed = (state->IntValue(v) != entry.lastUint[v]);
+            }
+            break;
+          case FORMAT::TypeDouble:
+            for (UINT32 v = 0; ! changed && v < entry.lastFp.size(); v++)
+            {
+                changed = (state->FpValue(v) != entry.lastFp[v]);
+            }
+            break;
+          case FORMAT::TypeString:
+            changed = changed || (entry.lastStr != state->StrValue());
+            break;
+        }
+        if (! changed)
+        {
+            continue;
+        }
+
+        // strings must be defined ahead of the snapshot record
+        UINT32 strId = 0;
+        if (entry.type == FORMAT::TypeString)
+        {
+            entry.lastStr = state->StrValue();
+            strId = StringId(entry.lastStr);
+        }
+
+        FORMAT::PutVarint(body, i - lastId);
+        lastId = i;
+        count++;
+        entry.written = true;
+
+        switch (entry.type)
+        {
+          case FORMAT::TypeUint:
+            for (UINT32 v = 0; v < entry.lastUint.size(); v++)
+            {
+                UINT64 value = state->IntValue(v);
+                FORMAT::PutVarint(body, FORMAT::ZigZag(value - entry.lastUint[v]));
+                entry.lastUint[v] = value;
+            }
+            break;
+          case FORMAT::TypeDouble:
+            for (UINT32 v = 0; v < entry.lastFp.size(); v++)
+            {
+                double value = state->FpValue(v);
+                FORMAT::PutDouble(body, value);
+                entry.lastFp[v] = value;
+            }
+            break;
+          case FORMAT::TypeString:
+            FORMAT::PutVarint(body, strId);
+            break;
+        }
+    }
+
+    record.clear();
+    FORMAT::PutVarint(record, sequence++);
+    FORMAT::PutVarint(record, cycle);
+    FORMAT::PutVarint(record, nanosecond);
+    FORMAT::PutVarint(record, insts);
+    FORMAT::PutVarint(record, count);
+    record += body;
+    WriteRecord(FORMAT::TagSnapshot, record);
+
+    // keep the file usable if the run dies later on
+    fflush(out);
+}
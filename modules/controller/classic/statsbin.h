@@ -0,0 +1,94 @@
+/*
+ *Copyright (C) 2006 Intel Corporation
+ *
+ *This program is free software; you can redistribute it and/or
+ *modify it under the terms of the GNU General Public License
+ *as published by the Free Software Foundation; either version 2
+ *of the License, or (at your option) any later version.
+ *
+ *This program is distributed in the hope that it will be useful,
+ *but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *GNU General Public License for more details.
+ *
+ *You should have received a copy of the GNU General Public License
+ *along with this program; if not, write to the Free Software
+ *Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * @file
+ * @brief Binary stats snapshot writer
+ */
+
+#ifndef _STATSBIN_
+#define _STATSBIN_
+
+// generic
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <map>
+
+// ASIM core
+#include "asim/syntax.h"
+#include "asim/state.h"
+#include "asim/statsbinary_format.h"
+
+using namespace std;
+
+/*
+ * Appends snapshots of all exposed model state to one binary stats
+ * file.  Each snapshot only holds the states that changed since the
+ * previous one, with integer counters stored as deltas.  The format is
+ * described in lib/libasimstats/statsbinary.h, which also has the
+ * reader; bstats-to-stats converts a file back to XML stats files.
+ * The encoding itself comes from asim/statsbinary_format.h, shared with
+ * that library.
+ *
+ * STATE_UINT, STATE_FP and STATE_STRING states are recorded.
+ * Histogram and resource states do not expose their cells through
+ * ASIM_STATE and are only in the XML stats.  Neither are the values
+ * that modules compute in their DumpStats() hooks.
+ */
+typedef class STATS_BINARY_WRITER_CLASS *STATS_BINARY_WRITER;
+class STATS_BINARY_WRITER_CLASS
+{
+  private:
+    typedef BinaryStatsFormat FORMAT;
+
+    struct ENTRY
+    {
+        ASIM_STATE state;
+        UINT32 id;
+        UINT32 type;
+        vector<UINT64> lastUint;
+        vector<double> lastFp;
+        string lastStr;
+        bool written;
+    };
+
+    FILE *out;
+    UINT64 sequence;
+    map<string, UINT32> stringIds;
+    vector<ENTRY> entries;
+    bool registered;
+
+    // scratch buffers, kept to avoid reallocation per snapshot
+    string record;
+    string body;
+
+    void RegisterStates (void);
+    UINT32 StringId (const string& str);
+    void WriteRecord (int tag, const string& buf);
+
+  public:
+    STATS_BINARY_WRITER_CLASS (const char *fileName);
+    ~STATS_BINARY_WRITER_CLASS ();
+
+    // Append a snapshot of the current state values.  The set of
+    // states is taken at the first snapshot.
+    void Snapshot (UINT64 cycle, UINT64 nanosecond, UINT64 insts);
+};
+
+#endif /* _STATSBIN_ */
@@ -22,6 +22,9 @@
  * @brief Basic Block Reporter
  */
 
+// generic (C++/STL)
+#include <algorithm>
+
 // ASIM core
 #include "asim/mesg.h"
 #include "asim/trace.h"
@@ -30,116 +33,363 @@
 #include "asim/provides/util_bbreport.h"
 
 BBREPORT_CLASS::BBREPORT_CLASS(void)
+    : nInstrs(0),
+      log2Buckets(12),
+      lastInstr(NULL),
+      nDumps(0),
+      dumpCommits(0)
 {
+    BUCKET empty = { 0, 0, NULL };
+    buckets.assign(1 << log2Buckets, empty);
 }
 
 BBREPORT_CLASS::~BBREPORT_CLASS(void)
 {
-    map<IADDR_CLASS, BB_INSTR_CLASS *>::iterator i_iter;
-    for (i_iter = instrTable.begin(); i_iter != instrTable.end(); i_iter++)
+    for (UINT32 i = 0; i < slabs.size(); i++)
+    {
+        delete [] slabs[i];
+    }
+    slabs.clear();
+    buckets.clear();
+}
+
+inline UINT64
+BBREPORT_CLASS::Hash(UINT64 bundle, UINT32 syllable) const
+{
+    // multiplicative hash, the top bits pick the bucket
+    UINT64 key = (bundle ^ (UINT64(syllable) << 60)) * 0x9e3779b97f4a7c15ULL;
+    return key >> (64 - log2Buckets);
+}
+
+BBREPORT_CLASS::BB_INSTR_CLASS *
+BBREPORT_CLASS::Find(const IADDR_CLASS & addr)
+{
+    UINT64 bundle = addr.GetBundleAddr();
+    UINT32 syllable = addr.GetSyllableIndex();
+    UINT64 mask = buckets.size() - 1;
+
+    for (UINT64 b = Hash(bundle, syllable); ; b = (b + 1) & mask)
+    {
+        BUCKET & bucket = buckets[b];
+        if (bucket.instr == NULL)
+        {
+            return NULL;
+        }
+        if (bucket.bundle == bundle && bucket.syllable == syllable)
+        {
+            return bucket.instr;
+        }
+    }
+}
+
+BBREPORT_CLASS::BB_INSTR_CLASS *
+BBREPORT_CLASS::Insert(const IADDR_CLASS & addr, const string & name)
+{
+    // keep the table at most half full
+    if (2 * (nInstrs + 1) > buckets.size())
+    {
+        Grow();
+    }
+
+    if (nInstrs % SLAB_SIZE == 0)
+    {
+        slabs.push_back(new BB_INSTR_CLASS[SLAB_SIZE]);
+    }
+
+    BB_INSTR_CLASS * cur_instr = Instr(nInstrs++);
+    cur_instr->addr = addr;
+    cur_instr->name = name;
+    cur_instr->count = 0;
+    cur_instr->delay = 0;
+    cur_instr->breakin = false;
+    cur_instr->breakout = false;
+    cur_instr->next = NULL;
+    cur_instr->dumpCount = 0;
+    cur_instr->dumpDelay = 0;
+
+    UINT64 bundle = addr.GetBundleAddr();
+    UINT32 syllable = addr.GetSyllableIndex();
+    UINT64 mask = buckets.size() - 1;
+
+    UINT64 b = Hash(bundle, syllable);
+    while (buckets[b].instr != NULL)
     {
-        delete i_iter->second;
+        b = (b + 1) & mask;
     }
-    instrTable.clear();
+    buckets[b].bundle = bundle;
+    buckets[b].syllable = syllable;
+    buckets[b].instr = cur_instr;
+
+    return cur_instr;
 }
 
 void
-BBREPORT_CLASS::Print(ostream & os)
+BBREPORT_CLASS::Grow(void)
+{
+    log2Buckets++;
+
+    BUCKET empty = { 0, 0, NULL };
+    buckets.assign(1 << log2Buckets, empty);
+    UINT64 mask = buckets.size() - 1;
+
+    for (UINT64 i = 0; i < nInstrs; i++)
+    {
+        BB_INSTR_CLASS * instr = Instr(i);
+        UINT64 bundle = instr->addr.GetBundleAddr();
+        UINT32 syllable = instr->addr.GetSyllableIndex();
+
+        UINT64 b = Hash(bundle, syllable);
+        while (buckets[b].instr != NULL)
+        {
+            b = (b + 1) & mask;
+        }
+        buckets[b].bundle = bundle;
+        buckets[b].syllable = syllable;
+        buckets[b].instr = instr;
+    }
+}
+
+bool
+BBREPORT_CLASS::InstrBefore(const BB_INSTR_CLASS * a, const BB_INSTR_CLASS * b)
+{
+    UINT64 a_bundle = a->addr.GetBundleAddr();
+    UINT64 b_bundle = b->addr.GetBundleAddr();
+    if (a_bundle != b_bundle)
+    {
+        return a_bundle < b_bundle;
+    }
+    return a->addr.GetSyllableIndex() < b->addr.GetSyllableIndex();
+}
+
+void
+BBREPORT_CLASS::TopBlocks(
+    const vector<BB_BLOCK_CLASS> & blocks,
+    UINT64 n,
+    vector<UINT64> & order)
+{
+    // bounded heap, the smallest of the blocks kept so far on top
+    BLOCK_AFTER after(blocks);
+    order.clear();
+    for (UINT64 b = 0; b < blocks.size(); b++)
+    {
+        if (order.size() < n)
+        {
+            order.push_back(b);
+            push_heap(order.begin(), order.end(), after);
+        }
+        else if (after(b, order.front()))
+        {
+            pop_heap(order.begin(), order.end(), after);
+            order.back() = b;
+            push_heap(order.begin(), order.end(), after);
+        }
+    }
+    sort_heap(order.begin(), order.end(), after);
+}
+
+void
+BBREPORT_CLASS::SortBlocks(
+    const vector<BB_BLOCK_CLASS> & blocks,
+    vector<UINT64> & order)
+{
+    // LSD radix sort on delay, a byte per pass; it is stable, so
+    // reading it backwards puts the higher index first on ties
+    UINT64 n = blocks.size();
+    vector<UINT64> in(n);
+    vector<UINT64> out(n);
+    for (UINT64 b = 0; b < n; b++)
+    {
+        in[b] = b;
+    }
+
+    for (UINT32 shift = 0; shift < 64; shift += 8)
+    {
+        UINT64 bucket[257] = { 0 };
+        for (UINT64 i = 0; i < n; i++)
+        {
+            bucket[((blocks[i].delay >> shift) & 0xff) + 1]++;
+        }
+
+        // all keys have the same byte, nothing to do
+        if (bucket[((blocks[0].delay >> shift) & 0xff) + 1] == n)
+        {
+            continue;
+        }
+
+        for (UINT32 d = 1; d <= 256; d++)
+        {
+            bucket[d] += bucket[d - 1];
+        }
+        for (UINT64 i = 0; i < n; i++)
+        {
+            UINT64 b = in[i];
+            out[bucket[(blocks[b].delay >> shift) & 0xff]++] = b;
+        }
+        in.swap(out);
+    }
+
+    order.assign(in.rbegin(), in.rend());
+}
+
+void
+BBREPORT_CLASS::Report(ostream & os, bool interval)
 {
     UINT64 total_blocks = 0;
     UINT64 total_size = 0;
     UINT64 total_count = 0;
     UINT64 total_delay = 0;
 
-    // basic blocks sorted by retire delay
-    multimap<UINT64, BB_BLOCK_CLASS *> blockTable;
+    // instructions sorted by IP
+    vector<BB_INSTR_CLASS *> instrs(nInstrs);
+    for (UINT64 i = 0; i < nInstrs; i++)
+    {
+        instrs[i] = Instr(i);
+    }
+    sort(instrs.begin(), instrs.end(), InstrBefore);
 
-    BB_BLOCK_CLASS * cur_block = new BB_BLOCK_CLASS;
-    cur_block->size = 0;
-    cur_block->count = 0;
-    cur_block->delay = 0;
+    // walk through instructions and create blocks
+    vector<BB_BLOCK_CLASS> blocks;
+    BB_BLOCK_CLASS cur_block;
+    cur_block.size = 0;
+    cur_block.count = 0;
+    cur_block.delay = 0;
 
-    // walk through map (already sorted) and create blocks
-    map<IADDR_CLASS, BB_INSTR_CLASS *>::iterator i_iter;
-    for (i_iter = instrTable.begin(); i_iter != instrTable.end(); i_iter++)
+    for (UINT64 i = 0; i < nInstrs; i++)
     {
-        if (cur_block->size == 0)
+        BB_INSTR_CLASS * instr = instrs[i];
+        UINT64 count = instr->count;
+        UINT64 delay = instr->delay;
+        if (interval)
+        {
+            count -= instr->dumpCount;
+            delay -= instr->dumpDelay;
+        }
+
+        if (cur_block.size == 0)
         {
             total_blocks++;
-            cur_block->addr = i_iter->second->addr;
+            cur_block.first = i;
         }
 
-        cur_block->size++;
-        cur_block->count += i_iter->second->count;
-        cur_block->delay += i_iter->second->delay;
+        cur_block.size++;
+        cur_block.count += count;
+        cur_block.delay += delay;
 
         total_size++;
-        total_count += i_iter->second->count;
-        total_delay += i_iter->second->delay;
+        total_count += count;
+        total_delay += delay;
 
         bool terminate = false;
-        if (i_iter->second->breakout == true)
+        if (instr->breakout == true)
         {
             terminate = true;
         }
-        if (++i_iter != instrTable.end())
+        if (i + 1 < nInstrs)
         {
-            if (i_iter->second->breakin == true)
+            if (instrs[i + 1]->breakin == true)
             {
                 terminate = true;
             }
         }
 
-        --i_iter;
-
         if (terminate == true)
         {
-            blockTable.insert(pair<UINT64, BB_BLOCK_CLASS *>(cur_block->delay, cur_block));
+            // blocks that did not run since the last dump are left out,
+            // and none are kept if none are listed
+            if ((BBREPORT_ALL || BBREPORT_SIZE != 0) &&
+                (! interval || cur_block.count != 0))
+            {
+                blocks.push_back(cur_block);
+            }
 
-            cur_block = new BB_BLOCK_CLASS;
-            cur_block->size = 0;
-            cur_block->count = 0;
-            cur_block->delay = 0;
+            cur_block.size = 0;
+            cur_block.count = 0;
+            cur_block.delay = 0;
         }
     }
 
-    // walk backwards through map (already sorted) and print blocks
+    // blocks sorted by retire delay, all of them with BBREPORT_ALL,
+    // otherwise the top BBREPORT_SIZE
+    vector<UINT64> order;
+    if (blocks.empty())
+    {
+        // nothing to sort
+    }
+    else if (BBREPORT_ALL)
+    {
+        SortBlocks(blocks, order);
+    }
+    else
+    {
+        TopBlocks(blocks, BBREPORT_SIZE, order);
+    }
+
     os << endl;
     os << "Unique basic blocks: " << total_blocks << endl;
     os << "Unique instructions: " << total_size << endl;
     os << "Total instructions : " << total_count << endl;
     os << "Total retire delay : " << total_delay << endl;
 
-    multimap<UINT64, BB_BLOCK_CLASS *>::reverse_iterator b_iter;
-    UINT64 BB_sort_index = 0;
-    for (b_iter = blockTable.rbegin(); b_iter != blockTable.rend(); b_iter++)
+    for (UINT64 b = 0; b < order.size(); b++)
     {
-        if (BB_sort_index++ < BBREPORT_SIZE)
+        const BB_BLOCK_CLASS & block = blocks[order[b]];
+
+        os << "Addr: " << instrs[block.first]->addr
+           << " Count: " << block.count
+           << " Size: " << block.size
+           << " Delay: " << block.delay
+           << " (" << fmt("5.2f", ((double) 100.0 * block.delay / total_delay)) << "%)" << endl;
+        for (UINT64 i = 0; i < block.size; i++)
         {
-            os << "Addr: " << b_iter->second->addr
-               << " Count: " << b_iter->second->count
-               << " Size: " << b_iter->second->size
-               << " Delay: " << b_iter->second->delay
-               << " (" << fmt("5.2f", ((double) 100.0 * b_iter->second->delay / total_delay)) << "%)" << endl;
-            IADDR_CLASS addr = b_iter->second->addr;
-            for (UINT64 i = 0; i < b_iter->second->size; i++)
+            BB_INSTR_CLASS * instr = instrs[block.first + i];
+            UINT64 count = instr->count;
+            UINT64 delay = instr->delay;
+            if (interval)
             {
-                i_iter = instrTable.find(addr);
-                ASSERTX(i_iter != instrTable.end());
+                count -= instr->dumpCount;
+                delay -= instr->dumpDelay;
+            }
+
+            os << "  [" << instr->addr << "] "
+               << fmt("-50", instr->name)
+               << " count " << fmt("6", count)
+               << " delay " << fmt("6", delay) << endl;
+        }
+        os << endl;
+    }
+}
 
-                os << "  [" << addr << "] "
-                   << fmt("-50", i_iter->second->name)
-                   << " count " << fmt("6", i_iter->second->count)
-                   << " delay " << fmt("6", i_iter->second->delay) << endl;
+void
+BBREPORT_CLASS::Print(ostream & os)
+{
+    Report(os, false);
+}
 
-                addr = addr.Next();
-            }
-            os << endl;
+void
+BBREPORT_CLASS::Dump(void)
+{
+    if (! dumpFile.is_open())
+    {
+        dumpFile.open(BBREPORT_DUMP_FILE, ios::out | ios::trunc);
+        if (! dumpFile)
+        {
+            ASIMWARNING("Can't open basic block dump file " << BBREPORT_DUMP_FILE << endl);
+            return;
         }
+    }
+
+    dumpCommits = 0;
 
-        delete b_iter->second;
+    dumpFile << "Basic block dump " << nDumps++ << endl;
+    Report(dumpFile, true);
+    dumpFile.flush();
+
+    for (UINT64 i = 0; i < nInstrs; i++)
+    {
+        BB_INSTR_CLASS * instr = Instr(i);
+        instr->dumpCount = instr->count;
+        instr->dumpDelay = instr->delay;
     }
-    blockTable.clear();
 }
 
 void
@@ -150,37 +400,54 @@ BBREPORT_CLASS::Commit(const IADDR_CLASS & addr, const string name, UINT64 delay
 
     bool split = (addr != lastAddr.Next());
 
-    map<IADDR_CLASS, BB_INSTR_CLASS *>::iterator iter = instrTable.find(addr);
+    // sequential commits usually follow the same path as last time
+    BB_INSTR_CLASS * cur_instr = NULL;
+    if (! split && lastInstr != NULL && lastInstr->next != NULL)
+    {
+        cur_instr = lastInstr->next;
+        if (cur_instr->addr != addr)
+        {
+            cur_instr = NULL;
+        }
+    }
 
-    if (iter != instrTable.end())
+    if (cur_instr == NULL)
+    {
+        cur_instr = Find(addr);
+    }
+
+    if (cur_instr != NULL)
     {
         TRACE(Trace_Sys, cout << "\tAddr match found, updating" << endl);
-        iter->second->count += 1;
-        iter->second->delay += delay;
     }
     else
     {
         TRACE(Trace_Sys, cout << "\tCreating new instance" << endl);
-        BB_INSTR_CLASS * cur_instr = new BB_INSTR_CLASS;
-        cur_instr->addr = addr;
-        cur_instr->name = name;
-        cur_instr->count = 1;
-        cur_instr->delay = delay;
-        cur_instr->breakin = false;
-        cur_instr->breakout = false;
-
-        iter = instrTable.insert(pair<IADDR_CLASS, BB_INSTR_CLASS *>(cur_instr->addr, cur_instr)).first;
+        cur_instr = Insert(addr, name);
     }
 
+    cur_instr->count += 1;
+    cur_instr->delay += delay;
+
     if (split == true)
     {
-        iter->second->breakin = true;
+        cur_instr->breakin = true;
 
-        iter = instrTable.find(lastAddr);
-        if (iter != instrTable.end())
+        if (lastInstr != NULL)
         {
-            iter->second->breakout = true;
+            lastInstr->breakout = true;
         }
     }
+    else if (lastInstr != NULL)
+    {
+        lastInstr->next = cur_instr;
+    }
+
     lastAddr = addr;
+    lastInstr = cur_instr;
+
+    if (BBREPORT_DUMP_PERIOD != 0 && ++dumpCommits >= BBREPORT_DUMP_PERIOD)
+    {
+        Dump();
+    }
 }
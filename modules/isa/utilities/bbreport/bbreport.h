@@ -26,7 +26,8 @@
 #define _BBREPORT_
 
 // generic (C++/STL)
-#include <map>
+#include <fstream>
+#include <vector>
 
 // ASIM core
 #include "asim/syntax.h"
@@ -41,7 +42,7 @@ class BBREPORT_CLASS
     // info about current block
     IADDR_CLASS lastAddr;
 
-    // hash table for instructions
+    // one entry per static instruction
     class BB_INSTR_CLASS
     {
       public:
@@ -52,27 +53,93 @@ class BBREPORT_CLASS
 
         bool breakin;
         bool breakout;
+
+        // instruction committed after this one the last time, if it
+        // was the next address
+        BB_INSTR_CLASS * next;
+
+        // count and delay at the last periodic dump
+        UINT64 dumpCount;
+        UINT64 dumpDelay;
+    };
+
+    // instructions live in slabs so they never move
+    enum { SLAB_SIZE = 4096 };
+    vector<BB_INSTR_CLASS *> slabs;
+    UINT64 nInstrs;
+
+    // open addressing hash table on instruction address, linear probing
+    struct BUCKET
+    {
+        UINT64 bundle;
+        UINT32 syllable;
+        BB_INSTR_CLASS * instr;     // NULL if empty
     };
+    vector<BUCKET> buckets;
+    UINT32 log2Buckets;
+
+    // last committed instruction
+    BB_INSTR_CLASS * lastInstr;
+
+    UINT64 Hash(UINT64 bundle, UINT32 syllable) const;
+    BB_INSTR_CLASS * Find(const IADDR_CLASS & addr);
+    BB_INSTR_CLASS * Insert(const IADDR_CLASS & addr, const string & name);
+    void Grow(void);
+    BB_INSTR_CLASS * Instr(UINT64 i) { return &slabs[i / SLAB_SIZE][i % SLAB_SIZE]; }
 
-    // sorted by IP
-    map<IADDR_CLASS, BB_INSTR_CLASS *> instrTable;
+    static bool InstrBefore(const BB_INSTR_CLASS * a, const BB_INSTR_CLASS * b);
 
-    // hash table for basic blocks
+    // basic blocks, built when the report is printed
     class BB_BLOCK_CLASS
     {
       public:
-        IADDR_CLASS addr;
+        UINT64 first;       // index of the first instruction in address order
         UINT64 size;
         UINT64 count;
         UINT64 delay;
     };
 
+    // orders block indices by delay, ties by index (higher first)
+    class BLOCK_AFTER
+    {
+      private:
+        const vector<BB_BLOCK_CLASS> & blocks;
+
+      public:
+        BLOCK_AFTER(const vector<BB_BLOCK_CLASS> & b) : blocks(b) {};
+        bool operator()(UINT64 a, UINT64 b) const
+        {
+            if (blocks[a].delay != blocks[b].delay)
+            {
+                return blocks[a].delay > blocks[b].delay;
+            }
+            return a > b;
+        }
+    };
+
+    static void TopBlocks(const vector<BB_BLOCK_CLASS> & blocks,
+                          UINT64 n, vector<UINT64> & order);
+    static void SortBlocks(const vector<BB_BLOCK_CLASS> & blocks,
+                           vector<UINT64> & order);
+
+    // print totals, or what changed since the last dump if interval
+    void Report(ostream & os, bool interval);
+
+    ofstream dumpFile;
+    UINT64 nDumps;
+    UINT64 dumpCommits;     // commits since the last dump
+
   public:
 
     BBREPORT_CLASS();
     ~BBREPORT_CLASS();
 
     void Print(ostream & os);
+
+    // write the blocks that ran since the last dump to BBREPORT_DUMP_FILE;
+    // called every BBREPORT_DUMP_PERIOD commits, or by the owner
+    void Dump(void);
+
     void Commit(const IADDR_CLASS & addr, const string name, UINT64 delay);
 
 };
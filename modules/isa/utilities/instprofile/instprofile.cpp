@@ -20,33 +20,28 @@
 // Author:  Srilatha Manne
 //
 
+#include <new>
+#include <algorithm>
+
+#include "asim/mesg.h"
 #include "asim/provides/inst_stats.h"
 
 //
-// PERINST_ENTRY
+// PERINST_ARENA
 //
 
-/**************************
- * Constructor
- **************************/
-
-
-PERINST_ENTRY_CLASS::PERINST_ENTRY_CLASS(const char* des_str, UINT64 a) :
-    addr(a), 
-    commHist(LAST_COUNTER),
-    noncommHist(LAST_COUNTER)
+PERINST_ARENA_CLASS::~PERINST_ARENA_CLASS()
 {
-
-    strncpy (des, des_str, 99);
-    
-    //
-    // Initialize row names.  We will register the stats at the end because
-    // that's the only time we'll have a ASIM_REGISTRY object with which to
-    // register the stats. 
-    commHist.RowNames(PERINST_COUNTER_STRING);
-    noncommHist.RowNames(PERINST_COUNTER_STRING);
+    for (UINT32 i = 0; i < chunks.size(); i++)
+    {
+        delete [] chunks[i];
+    }
 }
 
+//
+// PERINST_ENTRY
+//
+
 /**************************
  * Stats Registration
  **************************/
@@ -74,14 +69,22 @@ PERINST_ENTRY_CLASS::RegisterEntry(ASIM_REGISTRY reg)
 
 //    cout << "Address: " << os.str() << endl;
 
-    reg->RegisterState(&commHist, os1.str().c_str(), des);
-    reg->RegisterState(&noncommHist, os2.str().c_str(), des);
+    //
+    // The registry keeps pointing at the histograms, so they are never
+    // deleted.
+    HISTOGRAM_TEMPLATE<1> *commHist = new HISTOGRAM_TEMPLATE<1>(LAST_COUNTER);
+    HISTOGRAM_TEMPLATE<1> *noncommHist = new HISTOGRAM_TEMPLATE<1>(LAST_COUNTER);
+    commHist->RowNames(PERINST_COUNTER_STRING);
+    noncommHist->RowNames(PERINST_COUNTER_STRING);
+
+    reg->RegisterState(commHist, os1.str().c_str(), des);
+    reg->RegisterState(noncommHist, os2.str().c_str(), des);
 
     // Update the histogram with the correct data.  
     for (UINT32 i = 0; i < LAST_COUNTER; i++)
     {
-        commHist.AddEvent(i, 0, commInst.Get((PERINST_COUNTER)i));
-        noncommHist.AddEvent(i, 0, noncommInst.Get((PERINST_COUNTER)i));
+        commHist->AddEvent(i, 0, commInst.Get((PERINST_COUNTER)i));
+        noncommHist->AddEvent(i, 0, noncommInst.Get((PERINST_COUNTER)i));
     }
 }
 
@@ -94,91 +97,143 @@ PERINST_ENTRY_CLASS::RegisterEntry(ASIM_REGISTRY reg)
  **************************/
 PERINST_PAGE_CLASS::~PERINST_PAGE_CLASS()
 {
-/*
+    // Entries live in the cache's arena
     for (UINT32 i = 0; i < ENTRIES_PER_PAGE; i++) 
     {
         if (page[i] != NULL)
         {
-            delete page[i];
+            page[i]->~PERINST_ENTRY_CLASS();
         }
     }
-*/
 }
 
 
+
+//
+// PERINST_CACHE
+//
+
 /**************************
- * Update information for an instruction. 
+ * Destructor
  **************************/
 
-void 
-PERINST_PAGE_CLASS::UpdateInst(const UINT64 addr, 
-                               const char *inst_name, 
-                               const PERINST_STATS_CLASS &ifs, 
-                               bool commit) 
+PERINST_CACHE_CLASS::~PERINST_CACHE_CLASS()
 {
-    UINT64 offset = addr - pageAddr;
-
-//    cout << "Updating instruction, Addr: " << addr << ", offset: " << offset << endl;
-    
-    ASSERTX(offset < ENTRIES_PER_PAGE);
-    if (page[offset] == NULL) 
+    for (UINT64 i = 0; i < directory.size(); i++)
     {
-        //
-        // Null pointer, which means first time inst is seen.
-        page[offset] = new PERINST_ENTRY_CLASS(inst_name, addr);
-        UINT32 n = numInst++;
-        if (n > MAX_NUM_INSTS) 
+        if (directory[i].page != NULL)
         {
-            VERIFY(false, "Exceeding maximum number of static inst: 100000\n");
+            directory[i].page->~PERINST_PAGE_CLASS();
         }
     }
-    //
-    // Update 
-    ASSERTX(page[offset]->GetAddr() == addr);
-        
-    page[offset]->UpdateInst(ifs, commit);
 }
 
 /**************************
- * Register stats for a page
+ * Page directory
  **************************/
-//
-// Register a page of stats. 
-void
-PERINST_PAGE_CLASS::RegisterPage(ASIM_REGISTRY reg)
+
+inline UINT64
+PERINST_CACHE_CLASS::DirSlot(UINT64 pageNum) const
 {
-    for (UINT32 i = 0; i < ENTRIES_PER_PAGE; i++) 
+    return (pageNum * 0x9e3779b97f4a7c15ULL) >> (64 - log2Dir);
+}
+
+PERINST_PAGE
+PERINST_CACHE_CLASS::FindPage(UINT64 pageNum)
+{
+    UINT64 mask = directory.size() - 1;
+    for (UINT64 i = DirSlot(pageNum); ; i = (i + 1) & mask)
     {
-        if (page[i] != NULL)
+        if (directory[i].page == NULL)
         {
-//            cout << "Registering page" << endl;
-            page[i]->RegisterEntry(reg);
+            return NULL;
+        }
+        if (directory[i].pageNum == pageNum)
+        {
+            return directory[i].page;
         }
     }
 }
 
+void
+PERINST_CACHE_CLASS::GrowDirectory()
+{
+    vector<DIR_ENTRY> old;
+    old.swap(directory);
 
+    log2Dir++;
+    DIR_ENTRY empty = { 0, NULL };
+    directory.assign(1 << log2Dir, empty);
+    UINT64 mask = directory.size() - 1;
+
+    for (UINT64 j = 0; j < old.size(); j++)
+    {
+        if (old[j].page != NULL)
+        {
+            UINT64 i = DirSlot(old[j].pageNum);
+            while (directory[i].page != NULL)
+            {
+                i = (i + 1) & mask;
+            }
+            directory[i] = old[j];
+        }
+    }
+}
 
 //
-// PERINST_CACHE
+// Is there room in the budget for size more bytes of arena?
 //
+bool
+PERINST_CACHE_CLASS::Affordable(size_t size)
+{
+    UINT64 used = arena.Reserved() + arena.Growth(size) +
+                  directory.size() * sizeof(DIR_ENTRY);
+    return used <= budget;
+}
 
-/**************************
- * Destructor
- **************************/
-
-PERINST_CACHE_CLASS::~PERINST_CACHE_CLASS()
+PERINST_PAGE
+PERINST_CACHE_CLASS::NewPage(UINT64 pageNum)
 {
-    STAT_CACHE::iterator i = statCache.begin();
-    STAT_CACHE::iterator prev;
+    if (! Affordable(sizeof(PERINST_PAGE_CLASS)))
+    {
+        return NULL;
+    }
+
+    // Keep the directory at most half full
+    if (2 * (nPages + 1) > directory.size())
+    {
+        GrowDirectory();
+    }
+
+    PERINST_PAGE page = new (arena.Alloc(sizeof(PERINST_PAGE_CLASS)))
+        PERINST_PAGE_CLASS(pageNum << LOG2_ENTRIES_PER_PAGE);
+    nPages++;
 
-    while (i != statCache.end())
+    UINT64 mask = directory.size() - 1;
+    UINT64 i = DirSlot(pageNum);
+    while (directory[i].page != NULL)
     {
-        delete (*i).second;
-        prev = i;
-        ++i;
-        statCache.erase(prev);
+        i = (i + 1) & mask;
     }
+    directory[i].pageNum = pageNum;
+    directory[i].page = page;
+
+    return page;
+}
+
+PERINST_ENTRY
+PERINST_CACHE_CLASS::NewEntry(const char *name, UINT64 addr)
+{
+    if (! Affordable(sizeof(PERINST_ENTRY_CLASS)))
+    {
+        return NULL;
+    }
+
+    // Descriptions were limited to 99 characters
+    const char *des = names->insert(string(name).substr(0, 99)).first->c_str();
+
+    return new (arena.Alloc(sizeof(PERINST_ENTRY_CLASS)))
+        PERINST_ENTRY_CLASS(des, addr);
 }
 
 /**************************
@@ -193,55 +248,192 @@ PERINST_CACHE_CLASS::UpdateStats(UINT64 addr,
 {
 
     PERINST_PAGE page;
+    UINT64 page_num = addr >> LOG2_ENTRIES_PER_PAGE;
     
     //
     // Update per-inst stats.
     //
     if (lastPage && 
-        (addr & (~((1 << LOG2_ENTRIES_PER_PAGE) - 1)))==lastPage->PageAddr()) 
+        (page_num << LOG2_ENTRIES_PER_PAGE) == lastPage->PageAddr()) 
     {
-//            cout << "Using lastpage" << endl;
         page = lastPage;
     }
     else 
     {
-        STAT_CACHE::iterator i = statCache.find((addr >> LOG2_ENTRIES_PER_PAGE));
-        if (i != statCache.end()) {
-            page = (*i).second;
-            lastPage = page;
-//                cout << "Finding page in stat cache" << endl;
-        }
-        else 
+        page = FindPage(page_num);
+        if (page == NULL)
         {
             //
             // Page doesn't currently exist. 
             //
-            UINT64 page_addr = addr & (~((1 << LOG2_ENTRIES_PER_PAGE) - 1));
-            page = new PERINST_PAGE_CLASS(page_addr);
-//                cout << "Creating new page" << endl;
-            //
-            // Place new page into cache
-            //
-            statCache[(addr >> LOG2_ENTRIES_PER_PAGE)] = page;
-            lastPage = page;
+            page = NewPage(page_num);
+        }
+        if (page == NULL)
+        {
+            nDropped++;
+            return;
         }
+        lastPage = page;
+    }
+
+    PERINST_ENTRY& entry = page->Entry(addr);
+    if (entry == NULL)
+    {
+        //
+        // First time inst is seen.
+        entry = NewEntry(name, addr);
+        if (entry == NULL)
+        {
+            nDropped++;
+            return;
         }
-    // Update stats per address
-    page->UpdateInst(addr, name, ifs, commit);
+    }
+
+    //
+    // Update 
+    ASSERTX(entry->GetAddr() == addr);
+    entry->UpdateInst(ifs, commit);
+}
+
+/**************************
+ * Histogram selection
+ **************************/
+
+void
+PERINST_CACHE_CLASS::ParseRankCounters()
+{
+    rankCounters.clear();
+
+    string list = INST_PROFILE_RANK;
+    size_t pos = 0;
+    while (pos < list.size())
+    {
+        size_t end = list.find(',', pos);
+        if (end == string::npos)
+        {
+            end = list.size();
+        }
+        string name = list.substr(pos, end - pos);
+
+        UINT32 c = 0;
+        while (c < LAST_COUNTER && name != PERINST_COUNTER_STRING[c])
+        {
+            c++;
+        }
+        if (c == LAST_COUNTER)
+        {
+            ASIMERROR("Unknown counter \"" << name << "\" in INST_PROFILE_RANK"
+                      << endl);
+        }
+        rankCounters.push_back((PERINST_COUNTER)c);
+
+        pos = end + 1;
+    }
+}
+
+void
+PERINST_CACHE_CLASS::ParseAddrRanges()
+{
+    if (! addrRanges.Parse(INST_PROFILE_ADDRS))
+    {
+        ASIMERROR("Bad INST_PROFILE_ADDRS \"" << INST_PROFILE_ADDRS
+                  << "\", expected start-end[,start-end...]" << endl);
+    }
+}
+
+//
+// Entry ranked by its events.  More events first, then lower address.
+struct PERINST_RANKED
+{
+    UINT64 events;
+    PERINST_ENTRY entry;
+
+    bool operator<(const PERINST_RANKED& right) const
+    {
+        if (events != right.events)
+        {
+            return events > right.events;
+        }
+        return entry->GetAddr() < right.entry->GetAddr();
+    }
+};
+
+static bool
+PerinstAddrBefore(PERINST_ENTRY a, PERINST_ENTRY b)
+{
+    return a->GetAddr() < b->GetAddr();
 }
 
 /**************************
  * Register stats
  **************************/
+//
+// Only the chosen entries get histograms: the INST_PROFILE_TOP ones
+// with the most events (all if it is 0) and those in INST_PROFILE_ADDRS.
+//
 void
 PERINST_CACHE_CLASS::RegisterPerinstStats(ASIM_REGISTRY reg)
 {
-    STAT_CACHE::iterator i = statCache.begin();
-    while (i != statCache.end())
+    ParseRankCounters();
+    ParseAddrRanges();
+
+    vector<PERINST_ENTRY> chosen;
+    vector<PERINST_RANKED> top;     // heap, the worst one on top
+
+    for (UINT64 d = 0; d < directory.size(); d++)
     {
-//            cout << "Registering page: " << i << endl;
-        (*i).second->RegisterPage(reg);
-        ++i;
+        PERINST_PAGE page = directory[d].page;
+        if (page == NULL)
+        {
+            continue;
+        }
+
+        for (UINT32 i = 0; i < ENTRIES_PER_PAGE; i++)
+        {
+            PERINST_ENTRY entry = page->Entry(page->PageAddr() + i);
+            if (entry == NULL)
+            {
+                continue;
+            }
+
+            if (INST_PROFILE_TOP == 0 || addrRanges.Contains(entry->GetAddr()))
+            {
+                chosen.push_back(entry);
+                continue;
+            }
+
+            PERINST_RANKED ranked;
+            ranked.events = entry->Events(rankCounters);
+            ranked.entry = entry;
+
+            if (top.size() < INST_PROFILE_TOP)
+            {
+                top.push_back(ranked);
+                push_heap(top.begin(), top.end());
+            }
+            else if (ranked < top.front())
+            {
+                pop_heap(top.begin(), top.end());
+                top.back() = ranked;
+                push_heap(top.begin(), top.end());
+            }
+        }
     }
+
+    for (UINT32 i = 0; i < top.size(); i++)
+    {
+        chosen.push_back(top[i].entry);
+    }
+
+    // Register in address order
+    sort(chosen.begin(), chosen.end(), PerinstAddrBefore);
+    for (UINT64 i = 0; i < chosen.size(); i++)
+    {
+        chosen[i]->RegisterEntry(reg);
+    }
+
+    // Like the histograms, the count outlives the cache
+    UINT64 *dropped = new UINT64(nDropped);
+    reg->RegisterState(dropped, "PerinstDropped",
+                       "Updates of static insts over the profile memory budget");
 }
-    
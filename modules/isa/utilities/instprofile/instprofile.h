@@ -25,13 +25,13 @@
 
 #include <stdio.h>
 #include <memory.h>
-#include <map>
+#include <set>
+#include <string>
+#include <vector>
 #include "asim/registry.h"
-#include "asim/atomic.h"
+#include "asim/addr_ranges.h"
 #include "asim/restricted/perinst_stats.h"
 
-static UID_GEN32 numInst = 0;
-
 #define ENTRIES_PER_PAGE (1 << LOG2_ENTRIES_PER_PAGE)
 
 
@@ -42,20 +42,65 @@ static UID_GEN32 numInst = 0;
    inst profile.  Hence be careful when you use this profiling 
    algorithm. 
 
-   The number of maximum static instructions the data structure can
-   handle is 
-   
-   MAX_RECORDING_POINTS * (24 bytes/recording_point) * ENTRIES_PER_PAGE *
-           MAX_NUM_PAGES
-   
-   Note that there will be an assertion failure if the number of pages exceeds
-   781 even if each page has not reached the 2048 maximum number of inst. 
+   Pages and entries are carved out of an arena.  Once the arena and
+   the page directory reach INST_PROFILE_BUDGET Mbytes, instructions
+   seen for the first time are no longer profiled; they are counted in
+   the PerinstDropped stat instead.
+
+   Entries only hold counters.  Histograms are built when the stats are
+   registered, for the INST_PROFILE_TOP instructions with the most
+   INST_PROFILE_RANK events and for those in INST_PROFILE_ADDRS.
    
 */
 
+typedef class PERINST_ARENA_CLASS* PERINST_ARENA;
 typedef class PERINST_ENTRY_CLASS* PERINST_ENTRY;
 typedef class PERINST_PAGE_CLASS* PERINST_PAGE;
 typedef class PERINST_CACHE_CLASS* PERINST_CACHE;
+//
+// Memory for pages and entries, handed out in 1Mbyte chunks and only
+// released all at once.
+class PERINST_ARENA_CLASS {
+  private:
+    enum { CHUNK_BYTES = 1 << 20 };
+
+    vector<char *> chunks;
+    size_t free;            // bytes left in the last chunk
+
+  public:
+    PERINST_ARENA_CLASS() : free(0) {}
+    ~PERINST_ARENA_CLASS();
+
+    // Bytes taken from the system, and what allocating size would add
+    UINT64 Reserved() const { return UINT64(chunks.size()) * CHUNK_BYTES; }
+    UINT64 Growth(size_t size) const;
+
+    void *Alloc(size_t size);
+
+};
+
+inline UINT64
+PERINST_ARENA_CLASS::Growth(size_t size) const
+{
+    size = (size + 15) & ~size_t(15);
+    return size <= free ? 0 : CHUNK_BYTES;
+}
+
+inline void *
+PERINST_ARENA_CLASS::Alloc(size_t size)
+{
+    size = (size + 15) & ~size_t(15);
+    ASSERTX(size <= CHUNK_BYTES);
+    if (size > free)
+    {
+        chunks.push_back(new char[CHUNK_BYTES]);
+        free = CHUNK_BYTES;
+    }
+    void *p = chunks.back() + (CHUNK_BYTES - free);
+    free -= size;
+    return p;
+}
+
 //
 // Data structure for each static inst. or instset the program encounters.  
 class PERINST_ENTRY_CLASS {
@@ -69,12 +114,8 @@ class PERINST_ENTRY_CLASS {
     // Unique address of instruction we're storing
     UINT64 addr;
 
-    // Description of instruction 
-    char des[100];
-
-    // Histograms used to print out final information
-    HISTOGRAM_TEMPLATE<1> commHist;
-    HISTOGRAM_TEMPLATE<1> noncommHist;
+    // Description of instruction, owned by the cache
+    const char *des;
   
   public:
     //
@@ -92,11 +133,14 @@ class PERINST_ENTRY_CLASS {
     void UpdateInst(const PERINST_STATS_CLASS& ifs, bool commit); 
 
     // 
-    // Register the histogram for this instruction. 
+    // Build and register the histograms for this instruction. 
     void RegisterEntry(ASIM_REGISTRY reg);
 
     // Accessors
     UINT64 GetAddr();
+
+    // Committed plus non-committed events of the given counters
+    UINT64 Events(const vector<PERINST_COUNTER>& counters);
 };
 
 //
@@ -104,7 +148,14 @@ class PERINST_ENTRY_CLASS {
 //
 inline 
 PERINST_ENTRY_CLASS::PERINST_ENTRY_CLASS() :
-    addr(0)
+    addr(0),
+    des("")
+{}
+
+inline
+PERINST_ENTRY_CLASS::PERINST_ENTRY_CLASS(const char *name, UINT64 a) :
+    addr(a),
+    des(name)
 {}
 
 inline 
@@ -150,6 +201,17 @@ PERINST_ENTRY_CLASS::GetAddr()
 {
     return addr;
 }
+
+inline UINT64
+PERINST_ENTRY_CLASS::Events(const vector<PERINST_COUNTER>& counters)
+{
+    UINT64 n = 0;
+    for (UINT32 i = 0; i < counters.size(); i++)
+    {
+        n += commInst.Get(counters[i]) + noncommInst.Get(counters[i]);
+    }
+    return n;
+}
     
 // Data structure for one page of instructions. 
 class PERINST_PAGE_CLASS
@@ -166,11 +228,8 @@ class PERINST_PAGE_CLASS
     // Accessors
     UINT64 PageAddr();
 
-    // Modifiers
-    void UpdateInst(const UINT64 addr, const char* inst_name, 
-                    const PERINST_STATS_CLASS& ifs, 
-                    bool commit);
-    void RegisterPage(ASIM_REGISTRY reg);
+    // Slot for the instruction at addr, NULL until it is first seen
+    PERINST_ENTRY& Entry(const UINT64 addr);
 
 };
 
@@ -189,21 +248,56 @@ PERINST_PAGE_CLASS::PageAddr()
     return pageAddr; 
 }
 
+inline PERINST_ENTRY&
+PERINST_PAGE_CLASS::Entry(const UINT64 addr)
+{
+    UINT64 offset = addr - pageAddr;
+    ASSERTX(offset < ENTRIES_PER_PAGE);
+    return page[offset];
+}
+
 
 /*
  * Class perinst_cache_class contains all perinst stats for the program. It
- * contains a map whose entries are pages. Each page contains a number of
- * static instructions.
+ * contains a page directory, a hash table on the page number with linear
+ * probing. Each page contains a number of static instructions.
  */
 class PERINST_CACHE_CLASS
 {
   private:
     PERINST_PAGE lastPage;
   
-    // This map contains all stats accumulated per static
-    // instruction.
-    typedef map<UINT64, PERINST_PAGE> STAT_CACHE;
-    STAT_CACHE statCache;
+    // Page directory
+    struct DIR_ENTRY
+    {
+        UINT64 pageNum;
+        PERINST_PAGE page;      // NULL if empty
+    };
+    vector<DIR_ENTRY> directory;
+    UINT32 log2Dir;
+    UINT64 nPages;
+
+    PERINST_ARENA_CLASS arena;
+    UINT64 budget;              // bytes
+    UINT64 nDropped;            // updates of instructions not profiled
+
+    // Instruction descriptions, shared by the entries.  The registry
+    // keeps pointing at them, so they are never deleted.
+    set<string> *names;
+
+    // Which entries get histograms
+    vector<PERINST_COUNTER> rankCounters;
+    ADDR_RANGES_CLASS addrRanges;
+
+    UINT64 DirSlot(UINT64 pageNum) const;
+    PERINST_PAGE FindPage(UINT64 pageNum);
+    PERINST_PAGE NewPage(UINT64 pageNum);
+    PERINST_ENTRY NewEntry(const char *name, UINT64 addr);
+    void GrowDirectory();
+    bool Affordable(size_t size);
+
+    void ParseRankCounters();
+    void ParseAddrRanges();
 
  public:
     PERINST_CACHE_CLASS();
@@ -218,9 +312,18 @@ class PERINST_CACHE_CLASS
 
 
 inline
-PERINST_CACHE_CLASS::PERINST_CACHE_CLASS() : lastPage(NULL)
+PERINST_CACHE_CLASS::PERINST_CACHE_CLASS() :
+    lastPage(NULL),
+    log2Dir(8),
+    nPages(0),
+    budget(UINT64(INST_PROFILE_BUDGET) << 20),
+    nDropped(0),
+    names(new set<string>)
 {
     ASSERT(ENABLE_INST_PROFILE <= 2, "Legal values are 0, 1, and 2");
+
+    DIR_ENTRY empty = { 0, NULL };
+    directory.assign(1 << log2Dir, empty);
 }
 
 #endif // _INST_PROFILE_
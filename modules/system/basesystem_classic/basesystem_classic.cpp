@@ -26,6 +26,8 @@
 #include <iostream>
 #include <string>
 #include <sstream>
+#include <algorithm>
+#include <ctype.h>
 
 // ASIM core
 #include "asim/event.h"
@@ -47,7 +49,8 @@ ASIM_SYSTEM_CLASS::ASIM_SYSTEM_CLASS(
   : ASIM_MODULE_CLASS(NULL, n, e),
     cycles(0),
     base_cycles(0),
-    num_feeder_threads(feederThreads)
+    num_feeder_threads(feederThreads),
+    stateRegistry(NULL)
 {
   if (ncpu == 0)
   {
@@ -182,3 +185,86 @@ ASIM_SYSTEM_CLASS::InitEvents (void)
     // put ADF into DRAL file
     DRALEVENT(Comment(ADF_MAGICNUM,adf.c_str(),true));
 } 
+
+
+//----------------------------------------------------------------------------
+// STATE_REGISTRY
+//----------------------------------------------------------------------------
+
+std::string
+STATE_REGISTRY_CLASS::Key (const char *str)
+{
+    std::string key(str ? str : "");
+    for (std::string::size_type i = 0; i < key.size(); i++)
+    {
+        key[i] = tolower(key[i]);
+    }
+    return key;
+}
+
+STATE_REGISTRY_CLASS::STATE_REGISTRY_CLASS (ASIM_MODULE root)
+{
+    STATE_ITERATOR_CLASS iter(root, true);
+    ASIM_STATE state;
+
+    while ((state = iter.Next()) != NULL)
+    {
+        std::string path = Key(state->Path());
+        std::string name = Key(state->Name());
+        std::string fullName = path + "/" + name;
+
+        states.push_back(state);
+        known.insert(state);
+        byName[name] = state;
+        byFullName[fullName] = state;
+        byPath[path].push_back(state);
+        sorted.push_back(std::make_pair(fullName, state));
+    }
+
+    std::stable_sort(sorted.begin(), sorted.end(), LessKey);
+}
+
+bool
+STATE_REGISTRY_CLASS::LessKey (
+    const std::pair<std::string, ASIM_STATE>& a,
+    const std::pair<std::string, ASIM_STATE>& b)
+{
+    return a.first < b.first;
+}
+
+ASIM_STATE
+STATE_REGISTRY_CLASS::FindFullName (const char *fullName) const
+{
+    NAME_INDEX::const_iterator it = byFullName.find(Key(fullName));
+    return (it == byFullName.end()) ? NULL : it->second;
+}
+
+ASIM_STATE
+STATE_REGISTRY_CLASS::FindName (const char *name) const
+{
+    NAME_INDEX::const_iterator it = byName.find(Key(name));
+    return (it == byName.end()) ? NULL : it->second;
+}
+
+const std::vector<ASIM_STATE> *
+STATE_REGISTRY_CLASS::StatesAt (const char *path) const
+{
+    PATH_INDEX::const_iterator it = byPath.find(Key(path));
+    return (it == byPath.end()) ? NULL : &it->second;
+}
+
+void
+STATE_REGISTRY_CLASS::StatesWithPrefix (
+    const char *prefix,
+    std::vector<ASIM_STATE>& result) const
+{
+    std::string key = Key(prefix);
+    SORTED_INDEX::const_iterator it =
+        std::lower_bound(sorted.begin(), sorted.end(),
+                         std::make_pair(key, (ASIM_STATE)NULL), LessKey);
+
+    for (; it != sorted.end() && it->first.compare(0, key.size(), key) == 0; ++it)
+    {
+        result.push_back(it->second);
+    }
+}
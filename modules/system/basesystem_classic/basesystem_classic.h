@@ -32,6 +32,12 @@
 #include "asim/state.h"
 #include "asim/thread.h"
 
+// generic
+#include <string>
+#include <vector>
+#include <tr1/unordered_map>
+#include <tr1/unordered_set>
+
 // ASIM public modules -- BAD! in asim-core
 #include "asim/provides/isa.h"
 
@@ -44,6 +50,65 @@ typedef class CONTEXT_SCHEDULER_CLASS *CONTEXT_SCHEDULER;
 typedef class WARMUP_MANAGER_CLASS *WARMUP_MANAGER;
 
 
+/*
+ * STATE_REGISTRY
+ *
+ * Index over all exposed state of the system, for controllers and
+ * remote monitoring services that look up states by name.  Lookups
+ * are case-insensitive like the old linear PmState searches.  The
+ * index is built once, on first use after the model is initialized,
+ * since states are only registered while the model is constructed.
+ */
+typedef class STATE_REGISTRY_CLASS *STATE_REGISTRY;
+class STATE_REGISTRY_CLASS
+{
+    private:
+        typedef std::tr1::unordered_map<std::string, ASIM_STATE> NAME_INDEX;
+        typedef std::tr1::unordered_map<std::string, std::vector<ASIM_STATE> > PATH_INDEX;
+        typedef std::vector<std::pair<std::string, ASIM_STATE> > SORTED_INDEX;
+
+        std::vector<ASIM_STATE> states;     // in STATE_ITERATOR order
+        NAME_INDEX byFullName;              // "path/name" -> state
+        NAME_INDEX byName;                  // leaf name -> state
+        PATH_INDEX byPath;                  // module path -> its states
+        SORTED_INDEX sorted;                // "path/name", sorted
+        std::tr1::unordered_set<ASIM_STATE> known;
+
+        static std::string Key (const char *str);
+        static bool LessKey (const std::pair<std::string, ASIM_STATE>& a,
+                             const std::pair<std::string, ASIM_STATE>& b);
+
+    public:
+        STATE_REGISTRY_CLASS (ASIM_MODULE root);
+
+        const std::vector<ASIM_STATE>& AllStates (void) const { return states; }
+
+        // Return the state called 'path/name', or NULL.
+        ASIM_STATE FindFullName (const char *fullName) const;
+
+        // Return a state called 'name' anywhere in the system, or NULL.
+        // If several states share the name, the one the iterator visits
+        // last wins, which is the one the old prepended state lists
+        // returned.
+        ASIM_STATE FindName (const char *name) const;
+
+        // Return the states directly in module 'path', or NULL.
+        const std::vector<ASIM_STATE> *StatesAt (const char *path) const;
+
+        // Append all states whose "path/name" starts with 'prefix' to
+        // 'result', in path order.
+        void StatesWithPrefix (const char *prefix,
+                               std::vector<ASIM_STATE>& result) const;
+
+        // True if 'state' is one of the states of this system.  Used to
+        // validate state handles handed out to clients.
+        bool Contains (ASIM_STATE state) const
+        {
+            return known.find(state) != known.end();
+        }
+};
+
+
 typedef class ASIM_SYSTEM_CLASS *ASIM_SYSTEM;
 class ASIM_SYSTEM_CLASS : public ASIM_MODULE_CLASS
 {
@@ -79,6 +144,9 @@ class ASIM_SYSTEM_CLASS : public ASIM_MODULE_CLASS
 
         /// Initialize DRAL event stream
         void InitEvents (void);
+
+        /// Index of all exposed state, see StateRegistry()
+        STATE_REGISTRY stateRegistry;
         
     protected:
     
@@ -92,7 +160,7 @@ class ASIM_SYSTEM_CLASS : public ASIM_MODULE_CLASS
             UINT16 ncpu = 1,
             ASIM_EXCEPT e = NULL,
             UINT32 feederThreads = 0);
-        virtual ~ASIM_SYSTEM_CLASS () { delete [] committed; delete [] macroCommitted; delete [] cpu2module; }
+        virtual ~ASIM_SYSTEM_CLASS () { delete [] committed; delete [] macroCommitted; delete [] cpu2module; delete stateRegistry; }
 
         UINT32 NumCpus() const { return num_cpus; }
         UINT32 NumFeederThreads() const { return num_feeder_threads; };
@@ -247,6 +315,19 @@ class ASIM_SYSTEM_CLASS : public ASIM_MODULE_CLASS
          */
         virtual CONTEXT_SCHEDULER GetContextScheduler(void) { return NULL; }
         virtual WARMUP_MANAGER GetWarmupManager(void) { return NULL; }
+
+        /*
+         * Index of all exposed state of the system.  Only valid once
+         * the model has been initialized.
+         */
+        STATE_REGISTRY StateRegistry (void)
+        {
+            if (stateRegistry == NULL)
+            {
+                stateRegistry = new STATE_REGISTRY_CLASS(this);
+            }
+            return stateRegistry;
+        }
         
 };
 
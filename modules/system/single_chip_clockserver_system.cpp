@@ -36,6 +36,7 @@
 #include "asim/port.h"
 
 // ASIM public modules
+#include "asim/provides/controller.h"
 #include "asim/provides/instfeeder_interface.h"
 #include "asim/provides/system.h"
 
@@ -274,26 +275,35 @@ ASIM_COMMON_SYSTEM_CLASS::SYS_Execute(
     TRACE(Trace_Sys, cout << "Executing until cycle " << stop_cycle << " or inst " << stop_inst << " or nanosecond " << stop_nanosecond << endl);
 
     UINT64 sys_cycle = SYS_Cycle();
+
+    // Controller actions only run while we are stopped, so decide these once.
+    if (is_stats_on != statsOn)
+    {
+        cerr << "Turned statistics collection " << (statsOn ? "on" : "off") << " @ cycle " << sys_cycle << endl;
+        is_stats_on = statsOn;
+    }
+
+    if (is_events_on != eventsOn)
+    {
+        cerr << "Turned events collection " << (eventsOn ? "on" : "off") << " @ cycle " << sys_cycle << endl;
+        is_events_on = eventsOn;
+    }
+
+    // Skip the per-CPU committed sums when no instruction event is pending.
+    const bool watch_insts = (stop_inst != UINT64_MAX);
+    const bool watch_macroinsts = (stop_macroinst != UINT64_MAX);
+
+    // Per-cycle work that only some configurations need.
+    const bool update_thermal = (myThermalModel != NULL);
+    const bool dump_strips = stripsOn;
     
     while (!sysBreak && 
            (SYS_Nanosecond() < stop_nanosecond) &&
            (sys_cycle < stop_cycle) &&
-           (SYS_GlobalCommittedInsts() < stop_inst) &&
-           (SYS_GlobalCommittedMacroInsts() < stop_macroinst) &&
+           (!watch_insts || (SYS_GlobalCommittedInsts() < stop_inst)) &&
+           (!watch_macroinsts || (SYS_GlobalCommittedMacroInsts() < stop_macroinst)) &&
            (SYS_CommittedMarkers() < stop_marker)) 
     {
-        
-        if (is_stats_on != statsOn)
-        {
-            cerr << "Turned statistics collection " << (statsOn ? "on" : "off") << " @ cycle " << sys_cycle << endl;
-            is_stats_on = statsOn;
-        }
-
-        if (is_events_on != eventsOn)
-        {
-            cerr << "Turned events collection " << (eventsOn ? "on" : "off") << " @ cycle " << sys_cycle << endl;
-            is_events_on = eventsOn;
-        }
 
         // We clock the clockserver
         UINT64 bf_cycle_increment = clock->Clock();
@@ -304,15 +314,21 @@ ASIM_COMMON_SYSTEM_CLASS::SYS_Execute(
         
         myContextScheduler.Clock(sys_cycle);
 
-        // Calling the thermal model at this level to avoid problems with DFVS, sleep states 
-        // and similar potential problems.
-        myThermalModel->UpdateTemperature(sys_cycle);
+        if (update_thermal)
+        {
+            // Calling the thermal model at this level to avoid problems with DFVS, sleep states 
+            // and similar potential problems.
+            myThermalModel->UpdateTemperature(sys_cycle);
+        }
         
-        //
-        // Call the strip chart routines to dump the data if it is required.
-        // FIX ME: the capacity option is currently broken. By now strip charts are using
-        // the reference cycle, but they should use the local cycle instead.
-        DumpStripCharts(sys_cycle);
+        if (dump_strips)
+        {
+            //
+            // Call the strip chart routines to dump the data if it is required.
+            // FIX ME: the capacity option is currently broken. By now strip charts are using
+            // the reference cycle, but they should use the local cycle instead.
+            DumpStripCharts(sys_cycle);
+        }
 
         // increment the system clock here
         SYS_BaseCycle() += bf_cycle_increment; // Cycle counter @ clockserver base frequency
@@ -35,6 +35,7 @@
 #include "asim/port.h"
 
 // ASIM public modules
+#include "asim/provides/controller.h"
 #include "asim/provides/instfeeder_interface.h"
 #include "asim/provides/system.h"
 
@@ -243,24 +244,33 @@ ASIM_COMMON_SYSTEM_CLASS::SYS_Execute(
     myWarmupManager.DoWarmUp();
 
     T1("Executing until cycle " << stop_cycle << " or inst " << stop_inst); 
-    
-    while (!sysBreak && (SYS_Cycle() < stop_cycle) &&
-           (SYS_GlobalCommittedInsts() < stop_inst) &&
-           (SYS_GlobalCommittedMacroInsts() < stop_macroinst) &&
-           SYS_CommittedMarkers() < stop_marker) 
+
+    // Controller actions only run while we are stopped, so decide these once.
+    if (is_stats_on != statsOn)
     {
-        if (is_stats_on != statsOn)
-        {
-            cerr << "Turned statistics collection " << (statsOn ? "on" : "off") << " @ cycle " << SYS_Cycle() << endl;
-            is_stats_on = statsOn;
-        }
+        cerr << "Turned statistics collection " << (statsOn ? "on" : "off") << " @ cycle " << SYS_Cycle() << endl;
+        is_stats_on = statsOn;
+    }
 
-        if (is_events_on != eventsOn)
-        {
-            cerr << "Turned events collection " << (eventsOn ? "on" : "off") << " @ cycle " << SYS_Cycle() << endl;
-            is_events_on = eventsOn;
-        }
+    if (is_events_on != eventsOn)
+    {
+        cerr << "Turned events collection " << (eventsOn ? "on" : "off") << " @ cycle " << SYS_Cycle() << endl;
+        is_events_on = eventsOn;
+    }
+
+    // Skip the per-CPU committed sums when no instruction event is pending.
+    const bool watch_insts = (stop_inst != UINT64_MAX);
+    const bool watch_macroinsts = (stop_macroinst != UINT64_MAX);
+
+    // Per-cycle work that only some configurations need.
+    const bool update_thermal = (myThermalModel != NULL);
+    const bool dump_strips = stripsOn;
 
+    while (!sysBreak && (SYS_Cycle() < stop_cycle) &&
+           (!watch_insts || (SYS_GlobalCommittedInsts() < stop_inst)) &&
+           (!watch_macroinsts || (SYS_GlobalCommittedMacroInsts() < stop_macroinst)) &&
+           SYS_CommittedMarkers() < stop_marker) 
+    {
         // cycle event notification
         DRALEVENT(Cycle(SYS_Cycle()));
 
@@ -268,14 +278,20 @@ ASIM_COMMON_SYSTEM_CLASS::SYS_Execute(
 
         myContextScheduler.Clock(SYS_Cycle());
 
-        // Calling the thermal model at this level to avoid problems with DFVS, sleep states 
-        // and similar potential problems.
-        myThermalModel->UpdateTemperature(SYS_Cycle());
+        if (update_thermal)
+        {
+            // Calling the thermal model at this level to avoid problems with DFVS, sleep states 
+            // and similar potential problems.
+            myThermalModel->UpdateTemperature(SYS_Cycle());
+        }
 
-        //
-        // Call the strip chart routines to dump the data if it is required.
-        //
-        DumpStripCharts(SYS_Cycle());
+        if (dump_strips)
+        {
+            //
+            // Call the strip chart routines to dump the data if it is required.
+            //
+            DumpStripCharts(SYS_Cycle());
+        }
         
         // increment the system clock here
         SYS_Cycle()++; 
@@ -0,0 +1,191 @@
+/**************************************************************************
+ *Copyright (C) 2003-2006 Intel Corporation
+ *
+ *This program is free software; you can redistribute it and/or
+ *modify it under the terms of the GNU General Public License
+ *as published by the Free Software Foundation; either version 2
+ *of the License, or (at your option) any later version.
+ *
+ *This program is distributed in the hope that it will be useful,
+ *but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *GNU General Public License for more details.
+ *
+ *You should have received a copy of the GNU General Public License
+ *along with this program; if not, write to the Free Software
+ *Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * @file
+ * @brief ASIM Tarati Service: Profile
+ */
+
+// generic
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <sys/resource.h>
+
+// ASIM core
+#include "asim/syntax.h"
+
+// ASIM public modules
+#include "asim/provides/controller.h"
+
+// ASIM local modules
+#include "taratiProfile.h"
+
+namespace AsimTarati {
+
+/**
+ * Monotonic time in seconds
+ */
+static double
+Now (void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1000000000.0;
+}
+
+/**
+ * Resident set size in bytes, or 0 if unknown
+ */
+static double
+ResidentBytes (void)
+{
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    FILE * statm = fopen("/proc/self/statm", "r");
+    if (statm) {
+        if (fscanf(statm, "%lu %lu", &size, &resident) != 2) {
+            resident = 0;
+        }
+        fclose(statm);
+    }
+    return (double) resident * sysconf(_SC_PAGESIZE);
+}
+
+/**
+ * Heap bytes in use and bytes in mmapped blocks.  mallinfo() is
+ * deprecated since glibc 2.33 and its int fields wrap above 2GB.
+ */
+static void
+HeapBytes (double & heap, double & mmapped)
+{
+#if defined(__GLIBC__) && \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+    heap = (double) info.uordblks;
+    mmapped = (double) info.hblkhd;
+#else
+    struct mallinfo info = mallinfo();
+    heap = (double) (unsigned) info.uordblks;
+    mmapped = (double) (unsigned) info.hblkhd;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// Tarati Services
+//----------------------------------------------------------------------------
+Profile::Profile(
+    Server * server,
+    ASIM_SYSTEM system)
+  : Service(server, name, version)
+{
+    this->system = system;
+    startTime = Now();
+    lastTime = startTime;
+    lastCycle = system->SYS_Cycle();
+    lastInsts.resize(system->NumCpus());
+    for (UINT32 cpu = 0; cpu < system->NumCpus(); cpu++) {
+        lastInsts[cpu] = system->SYS_CommittedInsts(cpu);
+    }
+    progressTime = startTime;
+
+    method.sample = new Sample(this);
+}
+
+Profile::~Profile()
+{
+    delete method.sample;
+}
+
+//----------------------------------------------------------------------------
+// Methods
+//----------------------------------------------------------------------------
+//----- Sample -----
+/**
+ * Returns a struct of doubles.  Rates are over the time since the
+ * previous Sample; times are in seconds and counts since the start:
+ *  - "wall_time", "interval": since the start and the previous sample
+ *  - "cycle", "cycles_per_sec"
+ *  - "cpus": per cpu, "insts" and "insts_per_sec"
+ *  - "stalled_time": since a sample last saw the cycle count move
+ *  - "rss_bytes", "max_rss_bytes", "heap_bytes", "mmap_bytes",
+ *    "user_time", "system_time"
+ *  - "loops", "schedule_time", "execute_time", "emit_stats_time",
+ *    "emit_stats", "idle_time": controller loop; "execute_time"
+ *    includes Tarati work done from inside the model
+ *  - "tarati_time": simulator time spent executing Tarati calls
+ */
+void
+Profile::Sample::execute(
+    XmlRpcValue & params,
+    XmlRpcValue & result)
+{
+    ASIM_SYSTEM system = profile->system;
+    double now = Now();
+    double interval = now - profile->lastTime;
+
+    // throughput
+    UINT64 cycle = system->SYS_Cycle();
+    result["wall_time"] = now - profile->startTime;
+    result["interval"] = interval;
+    result["cycle"] = (double) cycle;
+    result["cycles_per_sec"] = interval > 0.0 ?
+        (cycle - profile->lastCycle) / interval : 0.0;
+    XmlRpcValue & cpus = result["cpus"];
+    cpus.setSize(system->NumCpus());
+    for (UINT32 cpu = 0; cpu < system->NumCpus(); cpu++) {
+        UINT64 insts = system->SYS_CommittedInsts(cpu);
+        cpus[cpu]["insts"] = (double) insts;
+        cpus[cpu]["insts_per_sec"] = interval > 0.0 ?
+            (insts - profile->lastInsts[cpu]) / interval : 0.0;
+        profile->lastInsts[cpu] = insts;
+    }
+    if (cycle != profile->lastCycle) {
+        profile->progressTime = now;
+    }
+    result["stalled_time"] = now - profile->progressTime;
+    profile->lastCycle = cycle;
+    profile->lastTime = now;
+
+    // memory and cpu
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double heap, mmapped;
+    HeapBytes(heap, mmapped);
+    result["rss_bytes"] = ResidentBytes();
+    result["max_rss_bytes"] = usage.ru_maxrss * 1024.0;
+    result["heap_bytes"] = heap;
+    result["mmap_bytes"] = mmapped;
+    result["user_time"] =
+        usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1000000.0;
+    result["system_time"] =
+        usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1000000.0;
+
+    // where the controller spends its time
+    CMD_LOOP_PROFILE loop = cmdLoopProfile;
+    result["loops"] = (double) loop.loops;
+    result["schedule_time"] = loop.scheduleNs / 1000000000.0;
+    result["execute_time"] = loop.executeNs / 1000000000.0;
+    result["emit_stats_time"] = loop.emitStatsNs / 1000000000.0;
+    result["emit_stats"] = (double) loop.emitStats;
+    result["idle_time"] = loop.idleNs / 1000000000.0;
+    result["tarati_time"] = service->GetServer()->GetBusyTime();
+}
+
+} // namespace AsimTarati
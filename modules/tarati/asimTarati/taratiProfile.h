@@ -0,0 +1,101 @@
+/**************************************************************************
+ *Copyright (C) 2003-2006 Intel Corporation
+ *
+ *This program is free software; you can redistribute it and/or
+ *modify it under the terms of the GNU General Public License
+ *as published by the Free Software Foundation; either version 2
+ *of the License, or (at your option) any later version.
+ *
+ *This program is distributed in the hope that it will be useful,
+ *but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *GNU General Public License for more details.
+ *
+ *You should have received a copy of the GNU General Public License
+ *along with this program; if not, write to the Free Software
+ *Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+
+/**
+ * @file
+ * @brief ASIM Tarati Service: Profile
+ */
+
+#ifndef _TARATI_PROFILE_
+#define _TARATI_PROFILE_
+
+// generic
+#include <vector>
+
+// ASIM public modules
+#include "asim/provides/system.h"
+#include "asim/provides/tarati.h"
+
+using namespace Tarati;
+
+namespace AsimTarati {
+
+//----------------------------------------------------------------------------
+// ASIM Tarati Service: Profile
+//----------------------------------------------------------------------------
+//----------------------------------------------------------------------------
+// Services
+//----------------------------------------------------------------------------
+/**
+ * @brief Tarati Service: resource usage and throughput of a live run
+ *
+ * Everything is read from counters that the controller and the Tarati
+ * server keep anyway, so a sample is cheap.  Sample reads them on the
+ * simulator thread, at the point where the server runs queued calls.
+ */
+class Profile
+  : public Service
+{
+  private:
+    static char * const name    = "Profile";
+    static char * const version = "0.1";
+
+    //------------------------------------------------------------------------
+    // Methods
+    //------------------------------------------------------------------------
+    /**
+     * @brief Tarati Method: Profile Sample
+     */
+    class Sample
+      : public Method
+    {
+      private:
+        Profile * profile;
+
+      public:
+        Sample(Profile * service)
+          : Method(service, "Sample"),
+            profile(service)
+        {};
+
+        /// RPC call method
+        void execute(XmlRpcValue& params, XmlRpcValue& result);
+    };
+    friend class Sample;
+
+    struct _method {
+        Sample * sample;
+    } method;
+
+    // members
+    ASIM_SYSTEM system;
+    double startTime;           ///< when the service was created
+    double lastTime;            ///< of the previous sample
+    UINT64 lastCycle;           ///< at the previous sample
+    vector<UINT64> lastInsts;   ///< per cpu, at the previous sample
+    double progressTime;        ///< when a sample last saw the cycle move
+
+  public:
+    Profile(Server * server, ASIM_SYSTEM system);
+    ~Profile();
+};
+
+} // namespace AsimTarati
+
+#endif /* _TARATI_PROFILE_ */
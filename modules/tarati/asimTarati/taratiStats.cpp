@@ -23,6 +23,11 @@
  */
 
 // generic
+#include <limits.h>
+#include <string.h>
+
+// ASIM public modules
+#include "asim/provides/tarati_stats.h"
 
 // ASIM local modules
 #include "taratiStats.h"
@@ -45,14 +50,8 @@ Stats::Stats(
 {
     // setup knowledge about PM
     pmSystem = system;
-    pmState = NULL;
-
-    // create a linked list of all state of the PM
-    STATE_ITERATOR_CLASS iter(system, true);
-    ASIM_STATE state;
-    while ((state = iter.Next()) != NULL) {
-        pmState = new ASIM_STATELINK_CLASS(state, pmState, false);
-    }
+    pmState = system->StateRegistry();
+    InitHandles();
 
     // instantiate and register methods
     method.states = new States(this);
@@ -61,6 +60,14 @@ Stats::Stats(
     method.name = new Name(this);
     method.desc = new Desc(this);
     method.value = new Value(this);
+    method.values = new Values(this);
+    method.subscribe = new Subscribe(this);
+    method.unsubscribe = new Unsubscribe(this);
+    method.drain = new Drain(this);
+
+    // no subscriptions yet
+    nextSubscription = 1;
+    Schedule();
 }
 
 /**
@@ -76,16 +83,250 @@ Stats::~Stats()
     delete method.name;
     delete method.desc;
     delete method.value;
+    delete method.values;
+    delete method.subscribe;
+    delete method.unsubscribe;
+    delete method.drain;
+
+    // drop all subscriptions
+    for (SubscriptionMap::iterator it = subscriptions.begin();
+         it != subscriptions.end(); ++it)
+    {
+        delete it->second;
+    }
+    subscriptions.clear();
 
-    // forget what we know about PM
+    // forget what we know about PM; the registry belongs to the system
     pmSystem = NULL;
+    pmState = NULL;
+}
+
+//----------------------------------------------------------------------------
+// Handles
+//----------------------------------------------------------------------------
+UINT32 Stats::generations = 0;
+
+/**
+ * Number all states of the model and pick this instance's generation.
+ */
+void
+Stats::InitHandles (void)
+{
+    generation = generations++ % (HANDLE_GENERATIONS - 1) + 1;
+
+    handles = pmState->AllStates();
+    if (handles.size() > HANDLE_INDEX_MASK + 1) {
+        ASIMERROR("Tarati Stats: too many states for handles ("
+                  << handles.size() << ")\n");
+    }
+    for (UINT32 i = 0; i < handles.size(); i++) {
+        handleIndex[handles[i]] = i;
+    }
+}
+
+int
+Stats::StateToHandle (
+    ASIM_STATE state)
+{
+    HANDLE_INDEX::const_iterator it = handleIndex.find(state);
+    ASSERTX(it != handleIndex.end());
+    return (generation << HANDLE_INDEX_BITS) | it->second;
+}
 
-    // delete allocated memory
-    while (pmState) {
-        ASIM_STATELINK nextState = pmState->next;
-        delete pmState;
-        pmState = nextState;
+/**
+ * The state named by 'handle'; throws for handles that are not ints,
+ * are out of range, or were handed out by another instance.
+ */
+ASIM_STATE
+Stats::HandleToState (
+    XmlRpcValue & handle)
+{
+    if (handle.getType() != XmlRpcValue::TypeInt) {
+        throw XmlRpcException("state handle is not an int");
     }
+    UINT32 h = (int) handle;
+    UINT32 index = h & HANDLE_INDEX_MASK;
+    if ((h >> HANDLE_INDEX_BITS) != generation || index >= handles.size()) {
+        throw XmlRpcException("invalid state handle");
+    }
+    return handles[index];
+}
+
+/**
+ * The state named by the only parameter.
+ */
+ASIM_STATE
+Stats::ParamToState (
+    XmlRpcValue & params)
+{
+    // get params
+    if (params.getType() != XmlRpcValue::TypeArray ||
+        params.size() != 1)
+    {
+        throw XmlRpcException("wrong number of arguments in method call");
+    }
+    return HandleToState(params[0]);
+}
+
+/**
+ * XML-RPC ints are 32 bits; larger counters are sent as doubles.
+ */
+XmlRpcValue
+Stats::UintToXml (
+    UINT64 value)
+{
+    if (value <= UINT64(INT_MAX)) {
+        return XmlRpcValue((int) value);
+    }
+    return XmlRpcValue((double) value);
+}
+
+/**
+ * Set 'result' to the values of 'state', an array of ints (or doubles,
+ * see UintToXml) for STATE_UINT and of doubles for STATE_FP.  Histogram
+ * and resource states do not expose their cells through ASIM_STATE; for
+ * those 'result' is a message string, as from awb.cpp:PmStateValue().
+ */
+void
+Stats::StateValue (
+    ASIM_STATE state,
+    XmlRpcValue & result)
+{
+    switch (state->Type()) {
+      case STATE_UINT:
+        result.setSize(state->Size());
+        for (UINT32 i = 0; i < state->Size(); i++) {
+            result[i] = UintToXml(state->IntValue(i));
+        }
+        break;
+      case STATE_FP:
+        result.setSize(state->Size());
+        for (UINT32 i = 0; i < state->Size(); i++) {
+            result[i] = state->FpValue(i);
+        }
+        break;
+      case STATE_HISTOGRAM:
+        result = "state type STATE_HISTOGRAM not supported";
+        break;
+      case STATE_RESOURCE:
+        result = "state type STATE_RESOURCE not supported";
+        break;
+      case STATE_THREE_DIM_HISTOGRAM:
+        result = "state type STATE_THREE_DIM_HISTOGRAM not supported";
+        break;
+      default:
+        ostringstream os;
+        os << "unknown state type " << state->Type();
+        result = os.str();
+    }
+}
+
+//----------------------------------------------------------------------------
+// Subscriptions
+//----------------------------------------------------------------------------
+/**
+ * Sum of committed instructions over all CPUs.
+ */
+UINT64
+Stats::CommittedInsts (void) const
+{
+    UINT64 insts = 0;
+    for (UINT32 cpu = 0; cpu < pmSystem->NumCpus(); cpu++) {
+        insts += pmSystem->SYS_CommittedInsts(cpu);
+    }
+    return insts;
+}
+
+/**
+ * Recompute the earliest cycle and instruction count at which any
+ * subscription is due, so that Sample() has only these to check.
+ */
+void
+Stats::Schedule (void)
+{
+    nextCycle = ~UINT64(0);
+    nextInst = ~UINT64(0);
+    haveInstPeriods = false;
+    for (SubscriptionMap::iterator it = subscriptions.begin();
+         it != subscriptions.end(); ++it)
+    {
+        Subscription * sub = it->second;
+        if (sub->byInsts) {
+            haveInstPeriods = true;
+            nextInst = min(nextInst, sub->next);
+        } else {
+            nextCycle = min(nextCycle, sub->next);
+        }
+    }
+}
+
+/**
+ * Append the current values of every due subscription's states to its
+ * ring.  Values are stored raw; converting them is left to Drain().
+ */
+void
+Stats::TakeSamples (
+    UINT64 cycle,
+    UINT64 insts)
+{
+    for (SubscriptionMap::iterator it = subscriptions.begin();
+         it != subscriptions.end(); ++it)
+    {
+        Subscription * sub = it->second;
+        UINT64 now = sub->byInsts ? insts : cycle;
+        if (now < sub->next) {
+            continue;
+        }
+        // next boundary after now; periods skipped while the simulator
+        // was not calling us are not sampled twice
+        sub->next += ((now - sub->next) / sub->period + 1) * sub->period;
+
+        UINT32 slot;
+        if (sub->count < sub->capacity) {
+            slot = (sub->head + sub->count++) % sub->capacity;
+        } else {
+            slot = sub->head;
+            sub->head = (sub->head + 1) % sub->capacity;
+            sub->dropped++;
+        }
+        sub->cycles[slot] = cycle;
+        sub->insts[slot] = insts;
+
+        UINT64 * values = &sub->values[slot * sub->width];
+        for (UINT32 s = 0; s < sub->states.size(); s++) {
+            ASIM_STATE state = sub->states[s];
+            if (state->Type() == STATE_FP) {
+                for (UINT32 i = 0; i < sub->sizes[s]; i++) {
+                    double fp = state->FpValue(i);
+                    memcpy(values++, &fp, sizeof(fp));
+                }
+            } else {
+                for (UINT32 i = 0; i < sub->sizes[s]; i++) {
+                    *values++ = state->IntValue(i);
+                }
+            }
+        }
+    }
+    Schedule();
+}
+
+/**
+ * The subscription named by the only parameter.
+ */
+Stats::Subscription *
+Stats::FindSubscription (
+    XmlRpcValue & params)
+{
+    if (params.getType() != XmlRpcValue::TypeArray ||
+        params.size() != 1)
+    {
+        throw XmlRpcException("wrong number of arguments in method call");
+    }
+    SubscriptionMap::iterator it = subscriptions.find((int) params[0]);
+    if (it == subscriptions.end()) {
+        throw XmlRpcException("unknown subscription");
+    }
+    return it->second;
 }
 
 //----------------------------------------------------------------------------
@@ -97,36 +338,30 @@ Stats::States::execute(
     XmlRpcValue & params,
     XmlRpcValue & result)
 {
-    const char * path;
-    int results = 0;
+    string path;
+    bool allStates = true;
 
     // get params
-    if (params.getType() == XmlRpcValue::TypeInvalid) {
-        path = NULL;
-    } else {
+    if (params.getType() != XmlRpcValue::TypeInvalid) {
         ASSERTX(params.getType() == XmlRpcValue::TypeArray);
         if (params.size() != 1) {
             throw XmlRpcException("wrong number of arguments in method call");
         }
-        path = ((string) params[0]).c_str();
-    }
-
-    ASIM_STATELINK scan = stats->pmState;
-    while (scan != NULL) {
-        ASIM_STATE state = scan->state;
-
-        if ((path == NULL) ||
-            (strcasecmp(state->Path(), path) == 0))
-        {
-            // If 'path' equals 'state's path, then return 'state's descriptor.
-            result[results] = (int) state;
-            // result[results]["path"] = state->Path();
-            // result[results]["name"] = state->Name();
-            // result[results]["desc"] = state->Description();
-            results++;
-        }
+        path = (string) params[0];
+        allStates = false;
+    }
+
+    // all states, or those whose path equals 'path'
+    const vector<ASIM_STATE> * states = allStates
+        ? &stats->pmState->AllStates()
+        : stats->pmState->StatesAt(path.c_str());
+    if (states == NULL) {
+        return;
+    }
 
-        scan = scan->next;
+    result.setSize(states->size());
+    for (UINT32 i = 0; i < states->size(); i++) {
+        result[i] = stats->StateToHandle((*states)[i]);
     }
 }
 
@@ -136,42 +371,18 @@ Stats::Find::execute(
     XmlRpcValue & params,
     XmlRpcValue & result)
 {
-    const char * name;
-
     // get params
     if (params.getType() != XmlRpcValue::TypeArray ||
         params.size() != 1)
     {
         throw XmlRpcException("wrong number of arguments in method call");
     }
-    name = ((string) params[0]).c_str();
-
-    ASIM_STATELINK scan = stats->pmState;
-    while (scan != NULL) {
-        ASIM_STATE state = scan->state;
+    string name = params[0];
 
-        if (strcasecmp(state->Name(), name) == 0) {
-            result[0] = (int) state;
-            return;
-        }
-
-        scan = scan->next;
-    }
-}
-
-static inline
-ASIM_STATE
-ParamToState (
-    XmlRpcValue & params)
-{
-    // get params
-    if (params.getType() != XmlRpcValue::TypeArray ||
-        params.size() != 1)
-    {
-        throw XmlRpcException("wrong number of arguments in method call");
+    ASIM_STATE state = stats->pmState->FindName(name.c_str());
+    if (state != NULL) {
+        result[0] = stats->StateToHandle(state);
     }
-    
-    return (ASIM_STATE) ((int) params[0]);
 }
 
 //----- Path -----
@@ -180,7 +391,7 @@ Stats::Path::execute(
     XmlRpcValue & params,
     XmlRpcValue & result)
 {
-    result = ParamToState(params)->Path();
+    result = stats->ParamToState(params)->Path();
 }
 
 //----- Name -----
@@ -189,7 +400,7 @@ Stats::Name::execute(
     XmlRpcValue & params,
     XmlRpcValue & result)
 {
-    result = ParamToState(params)->Name();
+    result = stats->ParamToState(params)->Name();
 }
 
 //----- Desc -----
@@ -198,7 +409,7 @@ Stats::Desc::execute(
     XmlRpcValue & params,
     XmlRpcValue & result)
 {
-    result = ParamToState(params)->Description();
+    result = stats->ParamToState(params)->Description();
 }
 
 //----- Value -----
@@ -207,36 +418,170 @@ Stats::Value::execute(
     XmlRpcValue & params,
     XmlRpcValue & result)
 {
-    ASIM_STATE state = ParamToState(params);
+    StateValue(stats->ParamToState(params), result);
+}
 
-    // bluntly copied from awb.cpp:PmStateValue()
-    if (state != NULL) {
-        // Iterate through 'state's values, appending them to the result list
-        switch (state->Type()) {
-          case STATE_UINT:
-            for (UINT32 i = 0; i < state->Size(); i++) {
-                result[i] = (int) state->IntValue(i);
-            }
-            break;
-          case STATE_FP:
-            for (UINT32 i = 0; i < state->Size(); i++) {
-                result[i] = state->FpValue(i);
+//----- Values -----
+/**
+ * Values(handles) returns what Value() returns for each of the handles,
+ * in order, so a client reads any number of states in one call.
+ */
+void
+Stats::Values::execute(
+    XmlRpcValue & params,
+    XmlRpcValue & result)
+{
+    // get params
+    if (params.getType() != XmlRpcValue::TypeArray ||
+        params.size() != 1 ||
+        params[0].getType() != XmlRpcValue::TypeArray)
+    {
+        throw XmlRpcException("wrong number of arguments in method call");
+    }
+    XmlRpcValue & handles = params[0];
+
+    result.setSize(handles.size());
+    for (int i = 0; i < handles.size(); i++) {
+        StateValue(stats->HandleToState(handles[i]), result[i]);
+    }
+}
+
+//----- Subscribe -----
+/**
+ * Subscribe(handles, period, [unit]) samples the states in 'handles' every
+ * 'period' cycles, or committed instructions if 'unit' is "instructions",
+ * starting with the next period boundary.  Returns the subscription id for
+ * Drain() and Unsubscribe().
+ */
+void
+Stats::Subscribe::execute(
+    XmlRpcValue & params,
+    XmlRpcValue & result)
+{
+    // get params
+    if (params.getType() != XmlRpcValue::TypeArray ||
+        params.size() < 2 || params.size() > 3 ||
+        params[0].getType() != XmlRpcValue::TypeArray)
+    {
+        throw XmlRpcException("wrong number of arguments in method call");
+    }
+    XmlRpcValue & handles = params[0];
+    int period = params[1];
+    if (period <= 0) {
+        throw XmlRpcException("period must be positive");
+    }
+    bool byInsts = false;
+    if (params.size() == 3) {
+        string unit = params[2];
+        if (unit == "instructions") {
+            byInsts = true;
+        } else if (unit != "cycles") {
+            throw XmlRpcException("unit must be cycles or instructions");
+        }
+    }
+
+    Subscription * sub = new Subscription;
+    sub->width = 0;
+    for (int i = 0; i < handles.size(); i++) {
+        ASIM_STATE state;
+        try {
+            state = stats->HandleToState(handles[i]);
+        } catch (...) {
+            delete sub;
+            throw;
+        }
+        if (state->Type() != STATE_UINT && state->Type() != STATE_FP) {
+            delete sub;
+            throw XmlRpcException("only STATE_UINT and STATE_FP states "
+                                  "can be subscribed to");
+        }
+        sub->states.push_back(state);
+        sub->sizes.push_back(state->Size());
+        sub->width += state->Size();
+    }
+
+    UINT64 now = byInsts ? stats->CommittedInsts()
+                         : stats->pmSystem->SYS_Cycle();
+    sub->byInsts = byInsts;
+    sub->period = period;
+    sub->next = (now / period + 1) * period;
+
+    sub->capacity = (TARATI_STATS_BUFFER > 0) ? TARATI_STATS_BUFFER : 1;
+    sub->head = 0;
+    sub->count = 0;
+    sub->dropped = 0;
+    sub->cycles.resize(sub->capacity);
+    sub->insts.resize(sub->capacity);
+    sub->values.resize(sub->capacity * sub->width);
+
+    int id = stats->nextSubscription++;
+    stats->subscriptions[id] = sub;
+    stats->Schedule();
+
+    result = id;
+}
+
+//----- Unsubscribe -----
+void
+Stats::Unsubscribe::execute(
+    XmlRpcValue & params,
+    XmlRpcValue & result)
+{
+    Subscription * sub = stats->FindSubscription(params);
+    stats->subscriptions.erase((int) params[0]);
+    delete sub;
+    stats->Schedule();
+
+    result = true;
+}
+
+//----- Drain -----
+/**
+ * Drain(id) returns and removes the buffered samples of a subscription:
+ * a struct with "dropped", the number of samples lost to a full buffer
+ * since the last Drain, and "samples", oldest first.  Each sample has
+ * "cycle" and "insts" (as doubles, they do not fit XML-RPC's int) and
+ * "values", one array per subscribed state in the order given to
+ * Subscribe, like Value() returns.
+ */
+void
+Stats::Drain::execute(
+    XmlRpcValue & params,
+    XmlRpcValue & result)
+{
+    Subscription * sub = stats->FindSubscription(params);
+
+    result["dropped"] = (double) sub->dropped;
+    XmlRpcValue & samples = result["samples"];
+    samples.setSize(sub->count);
+
+    for (UINT32 n = 0; n < sub->count; n++) {
+        UINT32 slot = (sub->head + n) % sub->capacity;
+        XmlRpcValue & sample = samples[n];
+        sample["cycle"] = (double) sub->cycles[slot];
+        sample["insts"] = (double) sub->insts[slot];
+
+        XmlRpcValue & values = sample["values"];
+        values.setSize(sub->states.size());
+        const UINT64 * raw = &sub->values[slot * sub->width];
+        for (UINT32 s = 0; s < sub->states.size(); s++) {
+            XmlRpcValue & value = values[s];
+            value.setSize(sub->sizes[s]);
+            for (UINT32 i = 0; i < sub->sizes[s]; i++, raw++) {
+                if (sub->states[s]->Type() == STATE_FP) {
+                    double fp;
+                    memcpy(&fp, raw, sizeof(fp));
+                    value[i] = fp;
+                } else {
+                    value[i] = UintToXml(*raw);
+                }
             }
-          case STATE_HISTOGRAM:
-            result = "state type STATE_HISTOGRAM not supported";
-            break;
-          case STATE_RESOURCE:
-            result = "state type STATE_RESOURCE not supported";
-            break;
-          case STATE_THREE_DIM_HISTOGRAM:
-            result = "state type STATE_THREE_DIM_HISTOGRAM not supported";
-            break;
-          default:
-            ostringstream os;
-            os << "unknown state type " << state->Type();
-            result = os.str();
         }
     }
+
+    sub->head = 0;
+    sub->count = 0;
+    sub->dropped = 0;
 }
 
 } // namespace AsimTarati
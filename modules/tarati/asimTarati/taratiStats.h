@@ -25,6 +25,11 @@
 #ifndef _TARATI_STATS_
 #define _TARATI_STATS_
 
+// generic
+#include <map>
+#include <vector>
+#include <tr1/unordered_map>
+
 // ASIM core
 #include "asim/state.h"
 
@@ -96,13 +101,18 @@ class Stats
     class Path
       : public Method
     {
+      private:
+        Stats * stats;
+
       public:
         Path(Stats * _stats)
-          : Method(_stats, "Path") {};
+          : Method(_stats, "Path"),
+            stats(_stats) {};
 
         /// RPC call method
         void execute(XmlRpcValue& params, XmlRpcValue& result);
     };
+    friend class Path;
 
     /**
      * @brief Tarati Method: Name(handle)
@@ -110,13 +120,18 @@ class Stats
     class Name
       : public Method
     {
+      private:
+        Stats * stats;
+
       public:
         Name(Stats * _stats)
-          : Method(_stats, "Name") {};
+          : Method(_stats, "Name"),
+            stats(_stats) {};
 
         /// RPC call method
         void execute(XmlRpcValue& params, XmlRpcValue& result);
     };
+    friend class Name;
 
     /**
      * @brief Tarati Method: Desc(handle)
@@ -124,13 +139,18 @@ class Stats
     class Desc
       : public Method
     {
+      private:
+        Stats * stats;
+
       public:
         Desc(Stats * _stats)
-          : Method(_stats, "Desc") {};
+          : Method(_stats, "Desc"),
+            stats(_stats) {};
 
         /// RPC call method
         void execute(XmlRpcValue& params, XmlRpcValue& result);
     };
+    friend class Desc;
 
     /**
      * @brief Tarati Method: Value(handle)
@@ -138,13 +158,94 @@ class Stats
     class Value
       : public Method
     {
+      private:
+        Stats * stats;
+
       public:
         Value(Stats * _stats)
-          : Method(_stats, "Value") {};
+          : Method(_stats, "Value"),
+            stats(_stats) {};
 
         /// RPC call method
         void execute(XmlRpcValue& params, XmlRpcValue& result);
     };
+    friend class Value;
+
+    /**
+     * @brief Tarati Method: Values(handles)
+     */
+    class Values
+      : public Method
+    {
+      private:
+        Stats * stats;
+
+      public:
+        Values(Stats * _stats)
+          : Method(_stats, "Values"),
+            stats(_stats) {};
+
+        /// RPC call method
+        void execute(XmlRpcValue& params, XmlRpcValue& result);
+    };
+    friend class Values;
+
+    /**
+     * @brief Tarati Method: Subscribe(handles, period, [unit])
+     */
+    class Subscribe
+      : public Method
+    {
+      private:
+        Stats * stats;
+
+      public:
+        Subscribe(Stats * _stats)
+          : Method(_stats, "Subscribe"),
+            stats(_stats) {};
+
+        /// RPC call method
+        void execute(XmlRpcValue& params, XmlRpcValue& result);
+    };
+    friend class Subscribe;
+
+    /**
+     * @brief Tarati Method: Unsubscribe(id)
+     */
+    class Unsubscribe
+      : public Method
+    {
+      private:
+        Stats * stats;
+
+      public:
+        Unsubscribe(Stats * _stats)
+          : Method(_stats, "Unsubscribe"),
+            stats(_stats) {};
+
+        /// RPC call method
+        void execute(XmlRpcValue& params, XmlRpcValue& result);
+    };
+    friend class Unsubscribe;
+
+    /**
+     * @brief Tarati Method: Drain(id)
+     */
+    class Drain
+      : public Method
+    {
+      private:
+        Stats * stats;
+
+      public:
+        Drain(Stats * _stats)
+          : Method(_stats, "Drain"),
+            stats(_stats) {};
+
+        /// RPC call method
+        void execute(XmlRpcValue& params, XmlRpcValue& result);
+    };
+    friend class Drain;
 
     struct _method {
         States * states;
@@ -153,17 +254,99 @@ class Stats
         Name * name;
         Desc * desc;
         Value * value;
+        Values * values;
+        Subscribe * subscribe;
+        Unsubscribe * unsubscribe;
+        Drain * drain;
     } method;
 
+    //------------------------------------------------------------------------
+    // Handles
+    //------------------------------------------------------------------------
+    /**
+     * Clients name states by handle, an int holding the state's index in
+     * 'handles' and the generation of this service instance, so handles
+     * resolve in O(1), do not depend on the width of host pointers, and
+     * handles from an earlier model instance are rejected.
+     */
+    enum {
+        HANDLE_INDEX_BITS = 22,
+        HANDLE_INDEX_MASK = (1 << HANDLE_INDEX_BITS) - 1,
+        HANDLE_GENERATIONS = 1 << (31 - HANDLE_INDEX_BITS)
+    };
+    typedef std::tr1::unordered_map<ASIM_STATE, UINT32> HANDLE_INDEX;
+
+    vector<ASIM_STATE> handles; ///< handle index -> state
+    HANDLE_INDEX handleIndex;   ///< state -> handle index
+    UINT32 generation;          ///< of this instance, in every handle
+    static UINT32 generations;  ///< instances created so far
+
+    void InitHandles(void);
+    int StateToHandle(ASIM_STATE state);
+    ASIM_STATE HandleToState(XmlRpcValue & handle);
+    ASIM_STATE ParamToState(XmlRpcValue & params);
+    static void StateValue(ASIM_STATE state, XmlRpcValue & result);
+    static XmlRpcValue UintToXml(UINT64 value);
+
+    //------------------------------------------------------------------------
+    // Subscriptions
+    //------------------------------------------------------------------------
+    /**
+     * @brief A set of states sampled every 'period' cycles or committed
+     * instructions.  Samples go into a ring of raw values that the client
+     * empties with Drain(); when the ring is full the oldest sample is
+     * dropped.
+     */
+    struct Subscription
+    {
+        vector<ASIM_STATE> states;
+        vector<UINT32> sizes;   ///< values sampled from each state
+        UINT32 width;           ///< values per sample, sum of sizes
+        bool byInsts;           ///< period counts instructions, not cycles
+        UINT64 period;
+        UINT64 next;            ///< cycle or instruction of the next sample
+
+        UINT32 capacity;        ///< samples in the ring
+        UINT32 head;            ///< oldest sample
+        UINT32 count;           ///< samples in the ring
+        UINT64 dropped;         ///< samples lost to a full ring
+        vector<UINT64> cycles;  ///< [capacity] cycle of each sample
+        vector<UINT64> insts;   ///< [capacity] committed insts of each sample
+        vector<UINT64> values;  ///< [capacity * width] raw state values
+    };
+    typedef map<int, Subscription *> SubscriptionMap;
+
+    SubscriptionMap subscriptions;
+    int nextSubscription;   ///< id of the next subscription
+    UINT64 nextCycle;       ///< earliest cycle any subscription samples at
+    UINT64 nextInst;        ///< earliest instruction count ditto
+    bool haveInstPeriods;   ///< some subscription counts instructions
+
+    Subscription * FindSubscription(XmlRpcValue & params);
+    UINT64 CommittedInsts(void) const;
+    void Schedule(void);
+    void TakeSamples(UINT64 cycle, UINT64 insts);
+
     //------------------------------------------------------------------------
     // Service
     //------------------------------------------------------------------------
     ASIM_SYSTEM    pmSystem; ///< root of the PM (system module)
-    ASIM_STATELINK pmState;  ///< root of linked list of all PM state
+    STATE_REGISTRY pmState;  ///< index of all PM state
 
   public:
     Stats(Server * server, ASIM_SYSTEM system);
     ~Stats();
+
+    /// Sample subscribed states that are due; call once per cycle
+    void Sample(void)
+    {
+        UINT64 cycle = pmSystem->SYS_Cycle();
+        if (cycle >= nextCycle ||
+            (haveInstPeriods && CommittedInsts() >= nextInst))
+        {
+            TakeSamples(cycle, CommittedInsts());
+        }
+    }
 };
 
 } // namespace AsimTarati
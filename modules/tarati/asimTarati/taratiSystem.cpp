@@ -46,6 +46,7 @@ System::System(ASIM_SYSTEM system)
     service.globalState = new GlobalState(server, system);
     service.stats = new Stats(server, system);
     service.timeScheduler = new TimeScheduler(server);
+    service.profile = new Profile(server, system);
 }
 
 System::~System()
@@ -55,6 +56,7 @@ System::~System()
     delete service.globalState;
     delete service.stats;
     delete service.timeScheduler;
+    delete service.profile;
 
     // delete server
     delete server;
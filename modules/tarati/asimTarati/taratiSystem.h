@@ -34,6 +34,7 @@
 #include "asim/provides/tarati_global_state.h"
 #include "asim/provides/tarati_stats.h"
 #include "asim/provides/tarati_time_scheduler.h"
+#include "asim/provides/tarati_profile.h"
 
 using namespace Tarati;
 
@@ -53,6 +54,7 @@ class System
         GlobalState * globalState;
         Stats * stats;
         TimeScheduler * timeScheduler;
+        Profile * profile;
     } service;
 
   public:
@@ -61,7 +63,11 @@ class System
     ~System();
     Server * GetServer(void) const { return server; }
     int GetPort(void) const { return server->GetPort(); }
-    void Work(double timeout = 0.0) const { server->Work(timeout); }
+    void Work(double timeout = 0.0) const
+    {
+        service.stats->Sample();
+        server->Work(timeout);
+    }
     void Wait(void) const { server->Wait(); }
 };
 
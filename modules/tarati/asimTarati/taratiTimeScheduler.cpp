@@ -23,37 +23,341 @@
  */
 
 // generic
+// ASIM public modules
+#include "asim/provides/tarati_time_scheduler.h"
 
 // ASIM local modules
 #include "taratiTimeScheduler.h"
 
 namespace AsimTarati {
 
+TimeScheduler * TimeScheduler::active = NULL;
+
 //----------------------------------------------------------------------------
 // Tarati Services
 //----------------------------------------------------------------------------
 TimeScheduler::TimeScheduler(
     Server * server)
-  : Service(server, "TimeScheduler", "0.1")
+  : Service(server, name, version)
 {
-    method.hello = new Hello(this);
+    method.now = new Now(this);
+    method.runUntil = new RunUntil(this);
+    method.stop = new Stop(this);
+    method.emitStats = new EmitStats(this);
+    method.notify = new Notify(this);
+    method.progress = new Progress(this);
+    method.cancel = new Cancel(this);
+    method.events = new Events(this);
+
+    dropped = 0;
+    nextId = 1;
+
+    active = this;
 }
 
 TimeScheduler::~TimeScheduler()
 {
-    delete method.hello;
+    // notifications still on the controller's schedule go nowhere now
+    active = NULL;
+
+    delete method.now;
+    delete method.runUntil;
+    delete method.stop;
+    delete method.emitStats;
+    delete method.notify;
+    delete method.progress;
+    delete method.cancel;
+    delete method.events;
+}
+
+//----------------------------------------------------------------------------
+// Notifications
+//----------------------------------------------------------------------------
+/**
+ * Put a notification on the controller's schedule; returns its id.
+ */
+int
+TimeScheduler::AddNotify (
+    const string & tag,
+    CMD_ACTIONTRIGGER trigger,
+    UINT64 count)
+{
+    int id = nextId++;
+    pending.insert(id);
+
+    CMD_ScheduleItem(new NotifyItem(id, tag, trigger, count));
+    return id;
+}
+
+/**
+ * Runs in the controller when the notification is due.  A cancelled
+ * periodic item turns itself into a one-shot item, so the controller
+ * deletes it instead of scheduling it again.
+ */
+void
+TimeScheduler::NotifyItem::CmdAction (void)
+{
+    TimeScheduler * scheduler = active;
+    bool live = scheduler && scheduler->pending.count(id);
+    if (live) {
+        Event event;
+        event.id = id;
+        event.tag = tag;
+        event.cycle = asimSystem->SYS_Cycle();
+        event.insts = 0;
+        for (UINT32 i = 0; i < asimSystem->NumCpus(); i++) {
+            event.insts += asimSystem->SYS_CommittedInsts(i);
+        }
+        if (scheduler->fired.size() >= TARATI_SCHEDULER_EVENTS) {
+            scheduler->fired.pop_front();
+            scheduler->dropped++;
+        }
+        scheduler->fired.push_back(event);
+
+        if (trigger == ACTION_CYCLE_ONCE ||
+            trigger == ACTION_INST_ONCE ||
+            trigger == ACTION_MACROINST_ONCE)
+        {
+            scheduler->pending.erase(id);
+        }
+    }
+
+    if ( ! live) {
+        switch (trigger) {
+          case ACTION_CYCLE_PERIOD:
+            trigger = ACTION_CYCLE_ONCE;
+            break;
+          case ACTION_INST_PERIOD:
+            trigger = ACTION_INST_ONCE;
+            break;
+          case ACTION_MACROINST_PERIOD:
+            trigger = ACTION_MACROINST_ONCE;
+            break;
+          default:
+            break;
+        }
+    }
+}
+
+//----------------------------------------------------------------------------
+// Parameters
+//----------------------------------------------------------------------------
+/**
+ * A count passed as int or double.
+ */
+static UINT64
+ParamToCount (
+    XmlRpcValue & param)
+{
+    if (param.getType() == XmlRpcValue::TypeInt) {
+        int count = param;
+        if (count >= 0) {
+            return count;
+        }
+    } else if (param.getType() == XmlRpcValue::TypeDouble) {
+        double count = param;
+        if (count >= 0) {
+            return (UINT64) count;
+        }
+    }
+    throw XmlRpcException("count must be a non-negative int or double");
+}
+
+/**
+ * The trigger for a unit name.  One-shot times must lie ahead of the
+ * model: the controller only fires cycle events on the exact cycle, and
+ * it may take until the end of the next cycle to see a new item.
+ */
+static CMD_ACTIONTRIGGER
+ParamToTrigger (
+    XmlRpcValue & param,
+    UINT64 count,
+    bool periodic)
+{
+    string unit = param;
+    UINT64 now = 0;
+    CMD_ACTIONTRIGGER once, period;
+    if (unit == "cycle") {
+        now = asimSystem->SYS_Cycle() + 1;
+        once = ACTION_CYCLE_ONCE;
+        period = ACTION_CYCLE_PERIOD;
+    } else if (unit == "inst") {
+        for (UINT32 i = 0; i < asimSystem->NumCpus(); i++) {
+            now += asimSystem->SYS_CommittedInsts(i);
+        }
+        once = ACTION_INST_ONCE;
+        period = ACTION_INST_PERIOD;
+    } else if (unit == "macroinst") {
+        for (UINT32 i = 0; i < asimSystem->NumCpus(); i++) {
+            now += asimSystem->SYS_CommittedMacroInsts(i);
+        }
+        once = ACTION_MACROINST_ONCE;
+        period = ACTION_MACROINST_PERIOD;
+    } else {
+        throw XmlRpcException("unit must be cycle, inst or macroinst");
+    }
+
+    if (periodic) {
+        if (count == 0) {
+            throw XmlRpcException("period must be positive");
+        }
+        return period;
+    }
+    if (count <= now) {
+        throw XmlRpcException("time has already passed");
+    }
+    return once;
+}
+
+static inline void
+CheckParams (
+    XmlRpcValue & params,
+    int min,
+    int max)
+{
+    if (min == 0 && params.getType() == XmlRpcValue::TypeInvalid) {
+        return;
+    }
+    if (params.getType() != XmlRpcValue::TypeArray ||
+        params.size() < min || params.size() > max)
+    {
+        throw XmlRpcException("wrong number of arguments in method call");
+    }
 }
 
 //----------------------------------------------------------------------------
 // Methods
 //----------------------------------------------------------------------------
-//----- Hello -----
+//----- Now -----
 void
-TimeScheduler::Hello::execute(
+TimeScheduler::Now::execute(
     XmlRpcValue & params,
     XmlRpcValue & result)
 {
-    result = "Hello from TimeScheduler";
+    CheckParams(params, 0, 0);
+
+    UINT64 insts = 0;
+    UINT64 macroInsts = 0;
+    for (UINT32 i = 0; i < asimSystem->NumCpus(); i++) {
+        insts += asimSystem->SYS_CommittedInsts(i);
+        macroInsts += asimSystem->SYS_CommittedMacroInsts(i);
+    }
+    result["cycle"] = (double) asimSystem->SYS_Cycle();
+    result["inst"] = (double) insts;
+    result["macroinst"] = (double) macroInsts;
+}
+
+//----- RunUntil -----
+void
+TimeScheduler::RunUntil::execute(
+    XmlRpcValue & params,
+    XmlRpcValue & result)
+{
+    CheckParams(params, 2, 2);
+    UINT64 count = ParamToCount(params[1]);
+    CMD_ACTIONTRIGGER trigger = ParamToTrigger(params[0], count, false);
+
+    CMD_Stop(trigger, count);
+    CMD_Start();
+    result = true;
+}
+
+//----- Stop -----
+void
+TimeScheduler::Stop::execute(
+    XmlRpcValue & params,
+    XmlRpcValue & result)
+{
+    CheckParams(params, 0, 0);
+
+    CMD_Stop(ACTION_NOW);
+    result = true;
+}
+
+//----- EmitStats -----
+void
+TimeScheduler::EmitStats::execute(
+    XmlRpcValue & params,
+    XmlRpcValue & result)
+{
+    CheckParams(params, 2, 3);
+    UINT64 count = ParamToCount(params[1]);
+    bool periodic = (params.size() == 3) && (bool) params[2];
+    CMD_ACTIONTRIGGER trigger = ParamToTrigger(params[0], count, periodic);
+
+    CMD_EmitStats(trigger, count);
+    result = true;
+}
+
+//----- Notify -----
+void
+TimeScheduler::Notify::execute(
+    XmlRpcValue & params,
+    XmlRpcValue & result)
+{
+    CheckParams(params, 3, 4);
+    UINT64 count = ParamToCount(params[1]);
+    string tag = params[2];
+    bool periodic = (params.size() == 4) && (bool) params[3];
+    CMD_ACTIONTRIGGER trigger = ParamToTrigger(params[0], count, periodic);
+
+    result = scheduler->AddNotify(tag, trigger, count);
+}
+
+//----- Progress -----
+/**
+ * A periodic notification tagged "progress".
+ */
+void
+TimeScheduler::Progress::execute(
+    XmlRpcValue & params,
+    XmlRpcValue & result)
+{
+    CheckParams(params, 2, 2);
+    UINT64 count = ParamToCount(params[1]);
+    CMD_ACTIONTRIGGER trigger = ParamToTrigger(params[0], count, true);
+
+    result = scheduler->AddNotify("progress", trigger, count);
+}
+
+//----- Cancel -----
+void
+TimeScheduler::Cancel::execute(
+    XmlRpcValue & params,
+    XmlRpcValue & result)
+{
+    CheckParams(params, 1, 1);
+    int id = params[0];
+
+    result = (scheduler->pending.erase(id) != 0);
+}
+
+//----- Events -----
+/**
+ * Events() returns and forgets the notifications that fired since the
+ * last call: a struct with "dropped", the number lost to a full buffer,
+ * and "events", oldest first, each with "id", "tag", and the "cycle" and
+ * "inst" count it fired at (doubles).
+ */
+void
+TimeScheduler::Events::execute(
+    XmlRpcValue & params,
+    XmlRpcValue & result)
+{
+    CheckParams(params, 0, 0);
+
+    result["dropped"] = (double) scheduler->dropped;
+    XmlRpcValue & events = result["events"];
+    events.setSize(scheduler->fired.size());
+    for (UINT32 i = 0; i < scheduler->fired.size(); i++) {
+        const Event & event = scheduler->fired[i];
+        events[i]["id"] = event.id;
+        events[i]["tag"] = event.tag;
+        events[i]["cycle"] = (double) event.cycle;
+        events[i]["inst"] = (double) event.insts;
+    }
+    scheduler->fired.clear();
+    scheduler->dropped = 0;
 }
 
 } // namespace AsimTarati
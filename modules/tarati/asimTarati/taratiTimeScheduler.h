@@ -26,8 +26,12 @@
 #define _TARATI_TIME_SCHEDULER
 
 // generic
+#include <deque>
+#include <set>
+#include <string>
 
 // ASIM public modules
+#include "asim/provides/controller.h"
 #include "asim/provides/tarati.h"
 
 using namespace Tarati;
@@ -37,41 +41,219 @@ namespace AsimTarati {
 //----------------------------------------------------------------------------
 // ASIM Tarati Service: Time Scheduler
 //----------------------------------------------------------------------------
-//----------------------------------------------------------------------------
-// Services
-//----------------------------------------------------------------------------
 /**
- * @brief Tarati Service: Time Scheduler of model
+ * @brief Tarati Service: Time Scheduler - put actions on the controller's
+ * schedule, so a remote client can let the model run at full speed until
+ * something it is interested in happens.
+ *
+ * Times are given as a unit, "cycle", "inst" or "macroinst" (committed
+ * instructions summed over all CPUs), and a count that is absolute for
+ * one-shot actions and the period for periodic ones.  XML-RPC ints are
+ * 32 bits, so counts may also be passed as doubles.
+ *
+ * Notifications are recorded when the controller reaches them and
+ * collected by the client with Events(); XML-RPC cannot push them.
  */
 class TimeScheduler
   : public Service
 {
   private:
     static char * const name    = "TimeScheduler";
-    static char * const version = "0.1";
+    static char * const version = "0.2";
 
     //------------------------------------------------------------------------
     // Methods
     //------------------------------------------------------------------------
     /**
-     * Note: temporary hack just for testing purposes - this is not to stay
-     * @brief Tarati Method: Hello
+     * @brief Tarati Method: Now() - current cycle and instruction counts
+     */
+    class Now
+      : public Method
+    {
+      public:
+        Now(Service * service)
+          : Method(service, "Now") {};
+
+        /// RPC call method
+        void execute(XmlRpcValue& params, XmlRpcValue& result);
+    };
+
+    /**
+     * @brief Tarati Method: RunUntil(unit, count) - run, stop at count
+     */
+    class RunUntil
+      : public Method
+    {
+      public:
+        RunUntil(Service * service)
+          : Method(service, "RunUntil") {};
+
+        /// RPC call method
+        void execute(XmlRpcValue& params, XmlRpcValue& result);
+    };
+
+    /**
+     * @brief Tarati Method: Stop() - stop the model now
      */
-    class Hello
+    class Stop
       : public Method
     {
       public:
-        Hello(Service * service)
-          : Method(service, "Hello") {};
+        Stop(Service * service)
+          : Method(service, "Stop") {};
 
         /// RPC call method
         void execute(XmlRpcValue& params, XmlRpcValue& result);
     };
 
+    /**
+     * @brief Tarati Method: EmitStats(unit, count, [periodic])
+     */
+    class EmitStats
+      : public Method
+    {
+      public:
+        EmitStats(Service * service)
+          : Method(service, "EmitStats") {};
+
+        /// RPC call method
+        void execute(XmlRpcValue& params, XmlRpcValue& result);
+    };
+
+    /**
+     * @brief Tarati Method: Notify(unit, count, tag, [periodic])
+     */
+    class Notify
+      : public Method
+    {
+      private:
+        TimeScheduler * scheduler;
+
+      public:
+        Notify(TimeScheduler * _scheduler)
+          : Method(_scheduler, "Notify"),
+            scheduler(_scheduler) {};
+
+        /// RPC call method
+        void execute(XmlRpcValue& params, XmlRpcValue& result);
+    };
+    friend class Notify;
+
+    /**
+     * @brief Tarati Method: Progress(unit, period)
+     */
+    class Progress
+      : public Method
+    {
+      private:
+        TimeScheduler * scheduler;
+
+      public:
+        Progress(TimeScheduler * _scheduler)
+          : Method(_scheduler, "Progress"),
+            scheduler(_scheduler) {};
+
+        /// RPC call method
+        void execute(XmlRpcValue& params, XmlRpcValue& result);
+    };
+    friend class Progress;
+
+    /**
+     * @brief Tarati Method: Cancel(id) - cancel a notification
+     */
+    class Cancel
+      : public Method
+    {
+      private:
+        TimeScheduler * scheduler;
+
+      public:
+        Cancel(TimeScheduler * _scheduler)
+          : Method(_scheduler, "Cancel"),
+            scheduler(_scheduler) {};
+
+        /// RPC call method
+        void execute(XmlRpcValue& params, XmlRpcValue& result);
+    };
+    friend class Cancel;
+
+    /**
+     * @brief Tarati Method: Events() - collect fired notifications
+     */
+    class Events
+      : public Method
+    {
+      private:
+        TimeScheduler * scheduler;
+
+      public:
+        Events(TimeScheduler * _scheduler)
+          : Method(_scheduler, "Events"),
+            scheduler(_scheduler) {};
+
+        /// RPC call method
+        void execute(XmlRpcValue& params, XmlRpcValue& result);
+    };
+    friend class Events;
+
     struct _method {
-        Hello * hello;
+        Now * now;
+        RunUntil * runUntil;
+        Stop * stop;
+        EmitStats * emitStats;
+        Notify * notify;
+        Progress * progress;
+        Cancel * cancel;
+        Events * events;
     } method;
 
+    //------------------------------------------------------------------------
+    // Notifications
+    //------------------------------------------------------------------------
+    /**
+     * @brief Controller work item that records a notification when the
+     * controller's schedule reaches it.  It only refers to the scheduler
+     * through 'active', so items still on the schedule when the service
+     * goes away are harmless.
+     */
+    class NotifyItem
+      : public CMD_WORKITEM_CLASS
+    {
+      private:
+        int id;
+        string tag;
+
+      public:
+        NotifyItem(int _id, const string & _tag,
+                   CMD_ACTIONTRIGGER trigger, UINT64 count)
+          : CMD_WORKITEM_CLASS("TARATI_NOTIFY", trigger, count),
+            id(_id),
+            tag(_tag) {};
+
+        void CmdAction(void);
+    };
+    friend class NotifyItem;
+
+    /// A notification that fired
+    struct Event {
+        int id;
+        string tag;
+        UINT64 cycle;
+        UINT64 insts;
+    };
+
+    // all of this is only touched on the simulator thread: the methods
+    // are not concurrent and NotifyItem runs in the controller loop
+    static TimeScheduler * active;  ///< the live instance, or NULL
+
+    set<int> pending;               ///< ids of uncancelled notifications
+    deque<Event> fired;             ///< not yet collected by Events()
+    UINT64 dropped;                 ///< events lost to a full 'fired'
+    int nextId;
+
+    int AddNotify(const string & tag, CMD_ACTIONTRIGGER trigger,
+                  UINT64 count);
+
   public:
     TimeScheduler(Server * server);
     ~TimeScheduler();
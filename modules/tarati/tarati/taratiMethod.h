@@ -53,10 +53,13 @@ class Method
   protected:
     Service * service;
     string name;
+    bool concurrent;
 
   public:
     // contructors / destructors
-    Method(Service * service, const string & name);
+    /// concurrent methods don't touch simulator state that could be
+    /// changing under them; the I/O thread runs them right away
+    Method(Service * service, const string & name, bool concurrent = false);
     //~Method();
 
     // accessors / modifiers
@@ -66,6 +69,8 @@ class Method
     //void SetService (Service * service) { this->service = service; }
     /// Get method name
     const string & GetName (void) const { return name; }
+    /// May run on the I/O thread while the simulator runs
+    bool IsConcurrent (void) const { return concurrent; }
     /// Set method name
     //void SetName (const string & name) { this->name = name; }
     //
@@ -30,6 +30,9 @@
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/sem.h>
+#include <errno.h>
+#include <time.h>
+#include <vector>
 
 // ASIM local module
 #include "taratiUtil.h"
@@ -43,7 +46,8 @@
 
 namespace Tarati {
 
-// note: this does not scale to more than 1 server
+// note: this does not scale to more than 1 server;
+// servers with a background I/O thread (TARATI_IO_THREAD) don't use it
 static int ServerAttentionSema = -1;
 /**
  * maintains the property that it is false IFF there is guaranteed that
@@ -90,12 +94,59 @@ void IoAttention(int signo, siginfo_t * info, void * context)
  * Create a new Tarati server
  */
 Server::Server()
+  : busyTime(0.0),
+    threaded(TARATI_IO_THREAD != 0),
+    ioThreadRunning(false),
+    ioThreadExit(false),
+    multicall(NULL)
 {
     //
     // set a custom error handler for underlying XML-RPC errors
     //
     XmlRpcErrorHandler::setErrorHandler( & taratiXmlRpcErrorHandler);
 
+    pthread_mutex_init(&xmlrpcLock, NULL);
+    pthread_mutex_init(&doneLock, NULL);
+    pthread_cond_init(&doneCond, NULL);
+    pthread_cond_init(&workCond, NULL);
+
+    //
+    // create the XML-RPC server
+    //
+    xmlrpcServer = new XmlRpc::XmlRpcServer(TARATI_EPOLL ?
+        XmlRpc::XmlRpcDispatch::EpollBackend :
+        XmlRpc::XmlRpcDispatch::SelectBackend);
+    if ( ! xmlrpcServer) {
+        TARATI_ERROR("could not create XmlRcpServer object");
+    }
+    bool ok = xmlrpcServer->bindAndListen(TARATI_SERVER_PORT);
+    if ( ! ok) {
+        TARATI_ERROR("could not bind socket to Tarati Server port "
+                     << TARATI_SERVER_PORT);
+    }
+    // binary protocol clients, if enabled, on a second port
+    if (TARATI_BINARY_PORT &&
+        ! xmlrpcServer->bindAndListenBinary(TARATI_BINARY_PORT))
+    {
+        TARATI_ERROR("could not bind socket to Tarati binary port "
+                     << TARATI_BINARY_PORT);
+    }
+
+    // Server's built-in Service
+    service.server = new ServerBuiltin::Server(this);
+
+    if (threaded) {
+        // no signals or semaphores: the I/O thread blocks in select()/epoll
+        // and hands method calls over through the command queue;
+        // batches go to the simulator in one piece
+        multicall = new Multicall(this);
+        xmlrpcServer->addMethod(multicall);
+
+        // the I/O thread is started by the first Work() or Wait(), once
+        // all services have registered their methods
+        return;
+    }
+
     //
     // create a semaphore to indicate available work
     //
@@ -132,22 +183,6 @@ Server::Server()
     timeout.it_interval.tv_usec = 0;
 //    setitimer(ITIMER_REAL, &timeout, NULL);
 
-    //
-    // create the XML-RPC server
-    //
-    xmlrpcServer = new XmlRpc::XmlRpcServer;
-    if ( ! xmlrpcServer) {
-        TARATI_ERROR("could not create XmlRcpServer object");
-    }
-    bool ok = xmlrpcServer->bindAndListen(TARATI_SERVER_PORT);
-    if ( ! ok) {
-        TARATI_ERROR("could not bind socket to Tarati Server port "
-                     << TARATI_SERVER_PORT);
-    }
-
-    // Server's built-in Service
-    service.server = new ServerBuiltin::Server(this);
-
     // turn on generation of async I/O events
     xmlrpcServer->setAsyncIo(SIGIO);
 };
@@ -157,11 +192,32 @@ Server::Server()
  */
 Server::~Server()
 {
+    // stop the I/O thread; a call it is still waiting on is failed
+    if (ioThreadRunning) {
+        pthread_mutex_lock(&doneLock);
+        ioThreadExit = true;
+        pthread_cond_broadcast(&doneCond);
+        pthread_mutex_unlock(&doneLock);
+        pthread_join(ioThread, NULL);
+        ioThreadRunning = false;
+    }
+
     // Server's built-in Service
     delete service.server;
 
     // XML-RPC
     delete xmlrpcServer;
+    delete multicall;
+
+    // proxies of methods that were never unregistered
+    for (ProxyMap::iterator it = proxies.begin(); it != proxies.end(); it++) {
+        delete it->second;
+    }
+
+    pthread_cond_destroy(&workCond);
+    pthread_cond_destroy(&doneCond);
+    pthread_mutex_destroy(&doneLock);
+    pthread_mutex_destroy(&xmlrpcLock);
 };
 
 /**
@@ -198,7 +254,27 @@ Server::MethodRegister (
     Method * method) ///< new method to register
 { 
     method->SetXmlName (GenerateMethodName (method));
-    xmlrpcServer->addMethod (method);
+    if ( ! threaded) {
+        xmlrpcServer->addMethod (method);
+        return;
+    }
+
+    // concurrent methods don't need to wait for the simulator
+    if (method->IsConcurrent()) {
+        pthread_mutex_lock (&xmlrpcLock);
+        direct[method] = method->GetXmlName();
+        xmlrpcServer->addMethod (method);
+        pthread_mutex_unlock (&xmlrpcLock);
+        return;
+    }
+
+    // the I/O thread only ever sees the proxy
+    MethodProxy * proxy = new MethodProxy (this, method, method->GetXmlName());
+    pthread_mutex_lock (&xmlrpcLock);
+    proxies[method] = proxy;
+    registry[method->GetXmlName()] = method;
+    xmlrpcServer->addMethod (proxy);
+    pthread_mutex_unlock (&xmlrpcLock);
 }
 
 /**
@@ -208,7 +284,26 @@ void
 Server::MethodUnregister (
     Method * method) ///< existing method to unregister
 {
-    xmlrpcServer->removeMethod (method);
+    if ( ! threaded) {
+        xmlrpcServer->removeMethod (method);
+        return;
+    }
+
+    pthread_mutex_lock (&xmlrpcLock);
+    ProxyMap::iterator it = proxies.find(method);
+    if (it != proxies.end()) {
+        // the method may already be gone, its proxy knows the name
+        registry.erase(it->second->name());
+        xmlrpcServer->removeMethod (it->second);
+        delete it->second;
+        proxies.erase(it);
+    }
+    DirectMap::iterator dit = direct.find(method);
+    if (dit != direct.end()) {
+        xmlrpcServer->removeMethod (dit->second);
+        direct.erase(dit);
+    }
+    pthread_mutex_unlock (&xmlrpcLock);
 }
 
 /**
@@ -223,10 +318,10 @@ const
 }
 
 /**
- * Check if there is something to do and do it
+ * Check if there is something to do and do it (SIGIO driven server)
  */
 void
-Server::Work (
+Server::WorkAsyncIo (
     double timeout) ///< number of seconds to keep waiting/working
 {
     if (ServerNeedsAttention) {
@@ -239,10 +334,23 @@ Server::Work (
             TARATI_ERROR("internal semaphore error: " << strerror(errno));
         }
         // and pick up all accumulated work
+        double start = Now();
         xmlrpcServer->work(timeout);
+        busyTime += Now() - start;
     }
 }
 
+/**
+ * Monotonic time in seconds, for accounting
+ */
+double
+Server::Now (void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1000000000.0;
+}
+
 
 /**
  * Wait until there is work to do. (Might give false positives)
@@ -250,6 +358,26 @@ Server::Work (
 void
 Server::Wait (void)
 {
+    if (threaded) {
+        if ( ! ioThreadRunning) {
+            StartIoThread();
+        }
+        // wake up periodically, callers also poll other channels
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_nsec += 100 * 1000 * 1000;
+        if (until.tv_nsec >= 1000 * 1000 * 1000) {
+            until.tv_sec++;
+            until.tv_nsec -= 1000 * 1000 * 1000;
+        }
+        pthread_mutex_lock(&doneLock);
+        if (commands.Empty()) {
+            pthread_cond_timedwait(&workCond, &doneLock, &until);
+        }
+        pthread_mutex_unlock(&doneLock);
+        return;
+    }
+
     // wait until semaphore can be decremented by 1
     struct sembuf operation;
     operation.sem_num = 0;
@@ -265,4 +393,236 @@ Server::Wait (void)
     }
 }
 
+//----------------------------------------------------------------------------
+// Background I/O thread
+//----------------------------------------------------------------------------
+/**
+ * Start the thread that serves the XML-RPC sockets
+ */
+void
+Server::StartIoThread (void)
+{
+    ioThreadRunning = true;
+    if (pthread_create(&ioThread, NULL, IoThreadMain, this) != 0) {
+        TARATI_ERROR("can't create Tarati I/O thread: " << strerror(errno));
+    }
+}
+
+/**
+ * Body of the I/O thread: accept connections and parse requests; method
+ * calls end up in Handoff()
+ */
+void *
+Server::IoThreadMain (
+    void * arg)
+{
+    Server * server = static_cast<Server *>(arg);
+
+    // leave signals meant for the simulator to the simulator thread
+    sigset_t mask;
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+    while ( ! server->ioThreadExit) {
+        // short slices so that registration and shutdown are not held
+        // off for long
+        pthread_mutex_lock(&server->xmlrpcLock);
+        server->xmlrpcServer->work(0.1);
+        pthread_mutex_unlock(&server->xmlrpcLock);
+    }
+    return NULL;
+}
+
+/**
+ * Queue cmds->count calls, starting at cmds, for the simulator and wait
+ * until it has executed them at a safe point (I/O thread, xmlrpcLock held)
+ * @returns false if the server shut down first
+ */
+bool
+Server::Submit (
+    Command * cmds)
+{
+    cmds->done = false;
+
+    // let the simulator (un)register methods while we wait
+    pthread_mutex_unlock(&xmlrpcLock);
+
+    while ( ! commands.Push(cmds)) {
+        // only one call is in flight per server, so this won't spin
+        usleep(1000);
+    }
+
+    pthread_mutex_lock(&doneLock);
+    pthread_cond_broadcast(&workCond);
+    while ( ! cmds->done && ! ioThreadExit) {
+        pthread_cond_wait(&doneCond, &doneLock);
+    }
+    bool done = cmds->done;
+    pthread_mutex_unlock(&doneLock);
+
+    pthread_mutex_lock(&xmlrpcLock);
+    return done;
+}
+
+/**
+ * Called on the I/O thread for every method call: queue it for the
+ * simulator and wait until it has been executed
+ */
+void
+Server::Handoff (
+    Method * method,
+    XmlRpcValue & params,
+    XmlRpcValue & result)
+{
+    Command cmd;
+    cmd.method = method;
+    cmd.params = &params;
+    cmd.result = &result;
+    cmd.failed = false;
+    cmd.faultCode = -1;
+    cmd.count = 1;
+
+    if ( ! Submit(&cmd)) {
+        throw XmlRpcException("Tarati server shutting down");
+    }
+    if (cmd.failed) {
+        throw XmlRpcException(cmd.fault, cmd.faultCode);
+    }
+}
+
+/**
+ * Called on the I/O thread for system.multicall: params[0] is an array
+ * of {methodName, params} structs.  Our methods in the batch are queued
+ * for the simulator together; XML-RPC's own system.* methods are
+ * answered right here.  Each result is a 1-element array holding the
+ * method's result, or a {faultCode, faultString} struct.
+ */
+void
+Server::HandoffBatch (
+    XmlRpcValue & params,
+    XmlRpcValue & result)
+{
+    static const string METHODNAME = "methodName";
+    static const string PARAMS = "params";
+    static const string FAULTCODE = "faultCode";
+    static const string FAULTSTRING = "faultString";
+
+    if (params.size() != 1 || params[0].getType() != XmlRpcValue::TypeArray) {
+        throw XmlRpcException(
+            "system.multicall: Invalid argument (expected an array)");
+    }
+
+    XmlRpcValue & calls = params[0];
+    int nc = calls.size();
+    result.setSize(nc);
+
+    vector<Command> cmds;
+    vector<int> slot;
+    cmds.reserve(nc);
+    slot.reserve(nc);
+
+    // monitoring clients tend to call the same few methods over and
+    // over, so look a name up only when it changes
+    string lastName;
+    Method * lastMethod = NULL;
+
+    for (int i = 0; i < nc; i++) {
+        XmlRpcValue & call = calls[i];
+        if (call.getType() != XmlRpcValue::TypeStruct ||
+            ! call.hasMember(METHODNAME) || ! call.hasMember(PARAMS) ||
+            call[METHODNAME].getType() != XmlRpcValue::TypeString)
+        {
+            result[i][FAULTCODE] = -1;
+            result[i][FAULTSTRING] = "system.multicall: Invalid argument "
+                "(expected a struct with string methodName and params)";
+            continue;
+        }
+
+        const string & name = call[METHODNAME];
+        if (lastMethod == NULL || name != lastName) {
+            MethodRegistry::iterator it = registry.find(name);
+            lastMethod = (it == registry.end()) ? NULL : it->second;
+            lastName = name;
+        }
+
+        if (lastMethod != NULL) {
+            result[i].setSize(1);
+            Command cmd;
+            cmd.method = lastMethod;
+            cmd.params = &call[PARAMS];
+            cmd.result = &result[i][0];
+            cmd.failed = false;
+            cmd.faultCode = -1;
+            cmd.count = 0;
+            cmds.push_back(cmd);
+            slot.push_back(i);
+            continue;
+        }
+
+        XmlRpcServerMethod * other = xmlrpcServer->findMethod(name);
+        if (other == NULL || other == multicall) {
+            result[i][FAULTCODE] = -1;
+            result[i][FAULTSTRING] = name + ": unknown method name";
+            continue;
+        }
+        try {
+            XmlRpcValue value;
+            other->execute(call[PARAMS], value);
+            result[i].setSize(1);
+            result[i][0] = value;
+        }
+        catch (const XmlRpcException & fault) {
+            result[i][FAULTCODE] = fault.getCode();
+            result[i][FAULTSTRING] = fault.getMessage();
+        }
+    }
+
+    if (cmds.empty()) {
+        return;
+    }
+    cmds[0].count = cmds.size();
+    if ( ! Submit(&cmds[0])) {
+        throw XmlRpcException("Tarati server shutting down");
+    }
+
+    for (unsigned k = 0; k < cmds.size(); k++) {
+        XmlRpcValue & value = result[slot[k]];
+        if (cmds[k].failed) {
+            value.clear();
+            value[FAULTCODE] = cmds[k].faultCode;
+            value[FAULTSTRING] = cmds[k].fault;
+        } else if ( ! value[0].valid()) {
+            value[0] = string();
+        }
+    }
+}
+
+/**
+ * Execute all method calls queued by the I/O thread (simulator thread)
+ */
+void
+Server::ExecuteCommands (void)
+{
+    double start = Now();
+    Command * cmd;
+    while ((cmd = commands.Pop()) != NULL) {
+        for (int i = 0; i < cmd->count; i++) {
+            try {
+                cmd[i].method->execute(*cmd[i].params, *cmd[i].result);
+            }
+            catch (const XmlRpcException & fault) {
+                cmd[i].failed = true;
+                cmd[i].fault = fault.getMessage();
+                cmd[i].faultCode = fault.getCode();
+            }
+        }
+
+        pthread_mutex_lock(&doneLock);
+        cmd->done = true;
+        pthread_cond_broadcast(&doneCond);
+        pthread_mutex_unlock(&doneLock);
+    }
+    busyTime += Now() - start;
+}
+
 } // namespace Tarati
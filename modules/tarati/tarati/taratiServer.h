@@ -28,6 +28,8 @@
 // generic
 #include <string>
 #include <map>
+#include <tr1/unordered_map>
+#include <pthread.h>
 
 // XML-RPC low level transport library
 #include <asim/provides/xmlrpc.h>
@@ -59,16 +61,154 @@ class Server
     typedef map<string, Service *> ServiceMap;
 
   private:
+    //------------------------------------------------------------------------
+    // Background I/O thread support (TARATI_IO_THREAD)
+    //------------------------------------------------------------------------
+    /**
+     * @brief A method call handed from the I/O thread to the simulator
+     */
+    struct Command {
+      Method * method;         ///< method to execute
+      XmlRpcValue * params;    ///< call parameters
+      XmlRpcValue * result;    ///< call result
+      bool failed;             ///< method threw an XmlRpcException
+      string fault;            ///< fault message if failed
+      int faultCode;           ///< fault code if failed
+      int count;               ///< calls queued together, starting here
+      bool done;               ///< result is ready (guarded by doneLock)
+    };
+
+    /**
+     * @brief Lock-free single-producer/single-consumer command queue
+     *
+     * The I/O thread is the only producer, the simulator thread the
+     * only consumer, so head and tail each have a single writer.
+     */
+    class CommandQueue {
+      private:
+        enum { Size = 16 };               ///< power of 2
+        Command * volatile slot[Size];
+        volatile unsigned head;           ///< next slot to pop (consumer)
+        volatile unsigned tail;           ///< next slot to push (producer)
+
+      public:
+        CommandQueue() : head(0), tail(0) {}
+
+        bool Empty (void) const { return head == tail; }
+
+        bool Push (Command * cmd)
+        {
+            if (tail - head == Size) {
+                return false;
+            }
+            slot[tail & (Size - 1)] = cmd;
+            __sync_synchronize(); // publish slot before tail
+            tail = tail + 1;
+            return true;
+        }
+
+        Command * Pop (void)
+        {
+            if (head == tail) {
+                return NULL;
+            }
+            __sync_synchronize(); // see slot after tail
+            Command * cmd = slot[head & (Size - 1)];
+            __sync_synchronize(); // read slot before freeing it
+            head = head + 1;
+            return cmd;
+        }
+    };
+
+    /**
+     * @brief Stand-in registered with XML-RPC for a Tarati method
+     *
+     * Runs on the I/O thread and hands the call to the simulator.
+     */
+    class MethodProxy
+      : public XmlRpcServerMethod
+    {
+      private:
+        Server * server;
+        Method * method;
+
+      public:
+        MethodProxy(Server * _server, Method * _method, const string & name)
+          : XmlRpcServerMethod(name),
+            server(_server),
+            method(_method) {};
+
+        void execute(XmlRpcValue& params, XmlRpcValue& result)
+        {
+            server->Handoff(method, params, result);
+        }
+    };
+    friend class MethodProxy;
+
+    /**
+     * @brief Replaces XML-RPC's built-in system.multicall
+     *
+     * Hands all calls of the batch to the simulator at once, so they
+     * cost one trip to a safe point instead of one each.
+     */
+    class Multicall
+      : public XmlRpcServerMethod
+    {
+      private:
+        Server * server;
+
+      public:
+        Multicall(Server * _server)
+          : XmlRpcServerMethod("system.multicall"),
+            server(_server) {};
+
+        void execute(XmlRpcValue& params, XmlRpcValue& result)
+        {
+            server->HandoffBatch(params, result);
+        }
+    };
+    friend class Multicall;
+
+    typedef map<Method *, MethodProxy *> ProxyMap;
+    typedef map<Method *, string> DirectMap;
+    typedef tr1::unordered_map<string, Method *> MethodRegistry;
+
     // members
     // -- XML-RPC
     XmlRpcServer * xmlrpcServer;  ///< XML-RPC transport layer server
     // -- registered services 
     ServiceMap services;           ///< registered service to object map
+    // -- accounting
+    double busyTime;               ///< seconds the simulator spent on calls
 
     struct _service {
       ServerBuiltin::Server * server; ///< built-in server service
     } service;
 
+    // -- background I/O thread
+    bool threaded;                 ///< sockets are served by ioThread
+    bool ioThreadRunning;          ///< ioThread has been started
+    volatile bool ioThreadExit;    ///< ask ioThread to terminate
+    pthread_t ioThread;            ///< thread running the XML-RPC server
+    pthread_mutex_t xmlrpcLock;    ///< guards xmlrpcServer
+    pthread_mutex_t doneLock;      ///< guards Command::done
+    pthread_cond_t doneCond;       ///< a command has completed
+    pthread_cond_t workCond;       ///< a command has been queued
+    CommandQueue commands;         ///< calls waiting for the simulator
+    ProxyMap proxies;              ///< XML-RPC stand-ins for our methods
+    DirectMap direct;              ///< concurrent methods, no proxy
+    MethodRegistry registry;       ///< our methods by XML-RPC name
+    Multicall * multicall;         ///< batched calls
+
+    static void * IoThreadMain (void * arg);
+    void StartIoThread (void);
+    bool Submit (Command * cmds);
+    void Handoff (Method * method, XmlRpcValue& params, XmlRpcValue& result);
+    void HandoffBatch (XmlRpcValue& params, XmlRpcValue& result);
+    void ExecuteCommands (void);
+    void WorkAsyncIo (double timeout);
+    static double Now (void);
+
   public:
     // constructors / destructors
     Server();
@@ -84,10 +224,27 @@ class Server
     /// Accessor for registered services
     const ServiceMap & GetServices (void) const { return services; }
     int GetPort (void) const { return xmlrpcServer->getPort(); }
+    /// Seconds the simulator thread has spent executing calls
+    double GetBusyTime (void) const { return busyTime; }
 
     // other methods
-    /// check if there is work and do it
-    void Work (double timeout = 0.0);
+    /// check if there is work and do it; with the I/O thread, queued
+    /// method calls are executed here, so the caller picks the safe point.
+    /// The APE system calls it between model cycles and the controller
+    /// while the model is stopped; per cycle it costs one queue check.
+    void Work (double timeout = 0.0)
+    {
+        if ( ! threaded) {
+            WorkAsyncIo(timeout);
+        } else {
+            if ( ! ioThreadRunning) {
+                StartIoThread();
+            }
+            if ( ! commands.Empty()) {
+                ExecuteCommands();
+            }
+        }
+    }
     /// wait for work to become available
     void Wait (void);
     /// Generate the low-level XML server name for a method call
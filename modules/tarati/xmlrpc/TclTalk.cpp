@@ -257,7 +257,8 @@ AwbStartInterpreter (
 void
 Usage (void)
 {
-  cerr << "Usage: TclTalk [-s server] [-p port] [-h] [-d] [-q]\n";
+  cerr << "Usage: TclTalk [-s server] [-p port] [-b port] [-h] [-d] [-q]\n";
+  cerr << "       -b ... make calls over the binary protocol on this port\n";
   cerr << "       -h ... help (this text)\n";
   cerr << "       -d ... debug on\n";
   cerr << "       -q ... quiet\n";
@@ -269,6 +270,7 @@ int main(int argc, char* argv[])
   RemoteArgs there;
   string server = "localhost";
   string port = "11088";
+  string binaryPort = "0";
 
   // a kindergarten cmdline parser
   for (int i = 1; i < argc; ) {
@@ -295,6 +297,13 @@ int main(int argc, char* argv[])
       } else {
         port = argv[i++];
       }
+    } else if (arg == "-b") {
+      if (i >= argc) {
+        cerr << "Error: -b missing port number" << endl;
+        Usage();
+      } else {
+        binaryPort = argv[i++];
+      }
     } else if (arg[0] == '-') {
       cerr << "Error: don't understand flag '" << arg << "'" << endl;
       Usage();
@@ -305,12 +314,13 @@ int main(int argc, char* argv[])
   }
 
   int portnum = strtol(port.c_str(), NULL, 0);
+  int binaryPortnum = strtol(binaryPort.c_str(), NULL, 0);
 
   //XmlRpc::setVerbosity(5);
   if ( ! quiet) {
     cout << "Connecting to " << server << ":" << portnum << " ... " << flush;
   }
-  Tarati::Client client(server, portnum, debug);
+  Tarati::Client client(server, portnum, debug, binaryPortnum);
   if ( ! quiet) {
     cout << "done" << endl;
   }
@@ -41,8 +41,9 @@ static bool quiet = false;
 void
 Usage (void)
 {
-  cerr << "Usage: TclTalk [-s server] [-p port] [-h] [-d] [-q]\n";
-  cerr << "Usage: atalk [-s server] [-p port] [-h|d|q] [service [method [args...]]]\n";
+  cerr << "Usage: TclTalk [-s server] [-p port] [-b port] [-h] [-d] [-q]\n";
+  cerr << "Usage: atalk [-s server] [-p port] [-b port] [-h|d|q] [service [method [args...]]]\n";
+  cerr << "       -b ... make calls over the binary protocol on this port\n";
   cerr << "       -h ... help (this text)\n";
   cerr << "       -d ... debug on\n";
   cerr << "       -q ... quiet\n";
@@ -55,10 +56,21 @@ Usage (void)
   exit (1);
 }
 
+// result of one call of a multicall, or its fault
+static XmlRpcValue &
+Unwrap (XmlRpcValue & result)
+{
+  if (result.getType() == XmlRpcValue::TypeArray) {
+    return result[0];
+  }
+  return result;
+}
+
 int main(int argc, char* argv[])
 {
   string server = "localhost";
   string port = "11088";
+  string binaryPort = "0";
   string service = def_service;
   string method = def_method;
   bool serviceSet = false;
@@ -90,6 +102,13 @@ int main(int argc, char* argv[])
       } else {
         port = argv[i++];
       }
+    } else if (arg == "-b") {
+      if (i >= argc) {
+        cerr << "Error: -b missing port number" << endl;
+        Usage();
+      } else {
+        binaryPort = argv[i++];
+      }
     } else if (arg[0] == '-') {
       cerr << "Error: don't understand flag '" << arg << "'" << endl;
       Usage();
@@ -107,10 +126,11 @@ int main(int argc, char* argv[])
   }
 
   int portnum = strtol(port.c_str(), NULL, 0);
+  int binaryPortnum = strtol(binaryPort.c_str(), NULL, 0);
 
   //XmlRpc::setVerbosity(5);
   cout << "Connecting to " << server << ":" << portnum << " ... " << flush;
-  Tarati::Client client(server, portnum, debug);
+  Tarati::Client client(server, portnum, debug, binaryPortnum);
   cout << "done" << endl;
 
   XmlRpcValue noArgs, result;
@@ -152,22 +172,27 @@ int main(int argc, char* argv[])
         string method = "States";
         cout << "Service: " << service << "::" << method << "()" << endl;
         XmlRpcValue states;
-        if (client.execute(service, method, noArgs, states)) {
+        // all queries about all states in one round trip
+        XmlRpcValue calls;
+        XmlRpcValue results;
+        if (client.execute(service, method, noArgs, states) &&
+            states.size() > 0)
+        {
           for (int i = 0; i < states.size(); i++) {
             XmlRpcValue args = states[i];
-            XmlRpcValue path;
-            client.execute(service, "Path", args, path);
-            XmlRpcValue name;
-            client.execute(service, "Name", args, name);
-            XmlRpcValue desc;
-            client.execute(service, "Desc", args, desc);
-            XmlRpcValue value;
-            client.execute(service, "Value", args, value);
+            Tarati::Client::batch(calls, service, "Path", args);
+            Tarati::Client::batch(calls, service, "Name", args);
+            Tarati::Client::batch(calls, service, "Desc", args);
+            Tarati::Client::batch(calls, service, "Value", args);
+          }
+        }
+        if (calls.valid() && client.multicall(calls, results)) {
+          for (int i = 0; i < states.size(); i++) {
             cout << "    State:" << endl;
-            cout << "        Path  = " << path << endl;
-            cout << "        Name  = " << name << endl;
-            cout << "        Desc  = " << desc << endl;
-            cout << "        Value = " << value << endl;
+            cout << "        Path  = " << Unwrap(results[4*i]) << endl;
+            cout << "        Name  = " << Unwrap(results[4*i+1]) << endl;
+            cout << "        Desc  = " << Unwrap(results[4*i+2]) << endl;
+            cout << "        Value = " << Unwrap(results[4*i+3]) << endl;
           }
         }
       } else {
@@ -40,9 +40,11 @@ namespace Tarati {
 Client::Client (
     const string & hostname,
     const int port,
-    bool dbg)
+    bool dbg,
+    const int binaryPort)
   : XmlRpcClient (hostname.c_str(), port),
-    debug(dbg)
+    debug(dbg),
+    binaryFd(-1)
 {
   // turn xml-rpc error reporting off for a bit
   OffErrorHandler errorOff;
@@ -63,10 +65,52 @@ Client::Client (
       nanosleep(&time, NULL); // take a nap
     }
   } while ( ! ok);
+  // the server is up, so its binary port is open too
+  if (binaryPort) {
+    string host = hostname;
+    binaryFd = XmlRpcSocket::socket();
+    if (binaryFd < 0 || ! XmlRpcSocket::connect(binaryFd, host, binaryPort)) {
+      cerr << "Error connecting to binary port " << binaryPort
+           << ", using XML-RPC" << endl;
+      if (binaryFd >= 0) {
+        XmlRpcSocket::close(binaryFd);
+      }
+      binaryFd = -1;
+    }
+  }
   // turn xml-rpc error reporting back on
   XmlRpcErrorHandler::setErrorHandler(origErrorHandler);
 }
 
+Client::~Client ()
+{
+  if (binaryFd >= 0) {
+    XmlRpcSocket::close(binaryFd);
+  }
+}
+
+/**
+ * Do a call over the binary protocol.
+ * @returns true if a response came back; fault is set if it is a fault
+ */
+bool
+Client::executeBinary (
+    const string & call,
+    XmlRpcValue & args,
+    XmlRpcValue & result,
+    bool & fault)
+{
+  string frame;
+  XmlRpcBinary::encodeCall(call, args, frame);
+  if ( ! XmlRpcBinary::writeFrame(binaryFd, frame) ||
+       ! XmlRpcBinary::readFrame(binaryFd, frame))
+  {
+    return false;
+  }
+  return XmlRpcBinary::decodeResponse(frame.data(),
+           frame.data() + frame.length(), result, fault);
+}
+
 bool
 Client::execute (
     const string & service,
@@ -79,12 +123,19 @@ Client::execute (
          << args << ")" << endl;
   }
   string call = service + "::" + method;
-  bool ok = XmlRpcClient::execute (call.c_str(), args, result);
+  bool fault = false;
+  bool ok;
+  if (binaryFd >= 0) {
+    ok = executeBinary (call, args, result, fault);
+  } else {
+    ok = XmlRpcClient::execute (call.c_str(), args, result);
+    fault = ok && isFault();
+  }
   if ( ! ok) {
     cerr << "Error calling " << service << "::" << method << "():"
          << endl << "  internal XML-RPC error" << endl;
   } else {
-    if (isFault()) {
+    if (fault) {
       ok = false;
       cerr << "Error calling " << service << "::" << method << "():"
            << endl << "  " << result << endl;
@@ -93,6 +144,50 @@ Client::execute (
   return ok;
 }
 
+void
+Client::batch (
+    XmlRpcValue & calls,
+    const string & service,
+    const string & method,
+    XmlRpcValue & args)
+{
+  int i = calls.getType() == XmlRpcValue::TypeArray ? calls.size() : 0;
+  calls[i]["methodName"] = service + "::" + method;
+  calls[i]["params"] = args;
+  if ( ! args.valid()) {
+    calls[i]["params"].setSize(0);
+  }
+}
+
+bool
+Client::multicall (
+    XmlRpcValue & calls,
+    XmlRpcValue & results)
+{
+  if (debug) {
+    cout << "Batch of " << calls.size() << " calls" << endl;
+  }
+  XmlRpcValue args;
+  args[0] = calls;
+  bool fault = false;
+  bool ok;
+  if (binaryFd >= 0) {
+    ok = executeBinary ("system.multicall", args, results, fault);
+  } else {
+    ok = XmlRpcClient::execute ("system.multicall", args, results);
+    fault = ok && isFault();
+  }
+  if ( ! ok) {
+    cerr << "Error calling system.multicall():" << endl
+         << "  internal XML-RPC error" << endl;
+  } else if (fault) {
+    ok = false;
+    cerr << "Error calling system.multicall():" << endl
+         << "  " << results << endl;
+  }
+  return ok;
+}
+
 /**
  * Test if the server connection is still alive.
  * @returns true on success, false otherwise
@@ -113,7 +208,12 @@ Client::ping (void)
   XmlRpcValue args;
   XmlRpcValue result;
   bool ok;
-  ok = XmlRpcClient::execute ("", args, result);
+  if (binaryFd >= 0) {
+    bool fault;
+    ok = executeBinary ("", args, result, fault);
+  } else {
+    ok = XmlRpcClient::execute ("", args, result);
+  }
   // turn xml-rpc error reporting back on
 //  XmlRpcErrorHandler::setErrorHandler(origErrorHandler);
 
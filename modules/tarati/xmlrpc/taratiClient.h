@@ -47,6 +47,11 @@ class Client : public XmlRpcClient
 {
   private:
     bool debug;
+    int binaryFd;   ///< socket of the binary protocol, or -1
+
+    /// Do a RPC call over the binary protocol
+    bool executeBinary (const string & call, XmlRpcValue & args,
+                        XmlRpcValue & result, bool & fault);
 
     class OffErrorHandler : public XmlRpcErrorHandler
     {
@@ -55,12 +60,20 @@ class Client : public XmlRpcClient
     };
 
   public:
-    Client (const string & hostname, const int port, bool dbg = false);
-    //~Client();
+    /// binaryPort != 0 makes calls over the binary protocol on that port
+    Client (const string & hostname, const int port, bool dbg = false,
+            const int binaryPort = 0);
+    ~Client();
 
     /// Do a RPC call
     bool execute (const string & service, const string & method,
                   XmlRpcValue & args, XmlRpcValue & result);
+    /// Add a call to a batch for multicall()
+    static void batch (XmlRpcValue & calls, const string & service,
+                       const string & method, XmlRpcValue & args);
+    /// Do all calls of a batch in one round trip; results[i] is a
+    /// 1-element array holding the result of call i, or a fault struct
+    bool multicall (XmlRpcValue & calls, XmlRpcValue & results);
     /// Check if connection is still alive
     bool ping (void);
 };
@@ -25,6 +25,7 @@
 # include <string>
 #endif
 
+#include "XmlRpcBinary.h"
 #include "XmlRpcClient.h"
 #include "XmlRpcException.h"
 #include "XmlRpcServer.h"
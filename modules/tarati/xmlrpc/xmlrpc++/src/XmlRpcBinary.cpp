@@ -0,0 +1,510 @@
+
+#include "XmlRpcBinary.h"
+#include "XmlRpcDispatch.h"
+#include "XmlRpcException.h"
+#include "XmlRpcServer.h"
+#include "XmlRpcSocket.h"
+#include "XmlRpcUtil.h"
+
+#ifndef MAKEDEPEND
+# include <errno.h>
+# include <string.h>
+# if defined(_WINDOWS)
+#  include <winsock2.h>
+# else
+#  include <unistd.h>
+#  include <sys/socket.h>
+# endif
+#endif
+
+#ifndef MSG_NOSIGNAL
+# define MSG_NOSIGNAL 0
+#endif
+
+namespace XmlRpc {
+
+
+  // Value type codes
+  static const char T_INVALID  = 'n';
+  static const char T_BOOLEAN  = 'b';
+  static const char T_INT      = 'i';
+  static const char T_DOUBLE   = 'd';
+  static const char T_STRING   = 's';
+  static const char T_DATETIME = 't';
+  static const char T_BINARY   = 'x';
+  static const char T_ARRAY    = 'a';
+  static const char T_STRUCT   = 'm';
+
+  // Payload kinds
+  static const char K_CALL     = 'C';
+  static const char K_RESPONSE = 'R';
+  static const char K_FAULT    = 'F';
+
+  static const int PREFIX = 4;     // length prefix
+  static const int MAX_RESERVE = 64 * 1024;   // largest up-front frame buffer
+
+
+  // varints and strings
+
+  void XmlRpcBinary::putVarint(std::string& buf, unsigned long long value)
+  {
+    while (value >= 0x80) {
+      buf += char((value & 0x7f) | 0x80);
+      value >>= 7;
+    }
+    buf += char(value);
+  }
+
+  bool XmlRpcBinary::getVarint(const char** cp, const char* end, unsigned long long& value)
+  {
+    value = 0;
+    for (int shift = 0; *cp < end && shift < 64; shift += 7) {
+      unsigned char c = (unsigned char) *(*cp)++;
+      value |= (unsigned long long)(c & 0x7f) << shift;
+      if ( ! (c & 0x80))
+        return true;
+    }
+    return false;
+  }
+
+  static inline unsigned long long zigzag(long long v)
+  {
+    return ((unsigned long long) v << 1) ^ (unsigned long long)(v >> 63);
+  }
+
+  static inline long long unzigzag(unsigned long long v)
+  {
+    return (long long)(v >> 1) ^ -(long long)(v & 1);
+  }
+
+  void XmlRpcBinary::putString(std::string& buf, std::string const& s)
+  {
+    putVarint(buf, s.length());
+    buf += s;
+  }
+
+  bool XmlRpcBinary::getString(const char** cp, const char* end, std::string& s)
+  {
+    unsigned long long n;
+    if ( ! getVarint(cp, end, n) || n > (unsigned long long)(end - *cp))
+      return false;
+    s.assign(*cp, size_t(n));
+    *cp += n;
+    return true;
+  }
+
+
+  // Values
+
+  void XmlRpcBinary::encode(XmlRpcValue const& v, std::string& buf)
+  {
+    switch (v._type) {
+      case XmlRpcValue::TypeBoolean:
+        buf += T_BOOLEAN;
+        buf += char(v._value.asBool ? 1 : 0);
+        break;
+
+      case XmlRpcValue::TypeInt:
+        buf += T_INT;
+        putVarint(buf, zigzag(v._value.asInt));
+        break;
+
+      case XmlRpcValue::TypeDouble:
+        {
+          unsigned long long bits;
+          memcpy(&bits, &v._value.asDouble, sizeof(bits));
+          buf += T_DOUBLE;
+          for (int i = 0; i < 8; ++i, bits >>= 8)
+            buf += char(bits & 0xff);
+          break;
+        }
+
+      case XmlRpcValue::TypeString:
+        buf += T_STRING;
+        putString(buf, *v._value.asString);
+        break;
+
+      case XmlRpcValue::TypeDateTime:
+        {
+          struct tm* t = v._value.asTime;
+          buf += T_DATETIME;
+          putVarint(buf, zigzag(t->tm_year));
+          putVarint(buf, zigzag(t->tm_mon));
+          putVarint(buf, zigzag(t->tm_mday));
+          putVarint(buf, zigzag(t->tm_hour));
+          putVarint(buf, zigzag(t->tm_min));
+          putVarint(buf, zigzag(t->tm_sec));
+          break;
+        }
+
+      case XmlRpcValue::TypeBase64:
+        buf += T_BINARY;
+        putVarint(buf, v._value.asBinary->size());
+        if ( ! v._value.asBinary->empty())
+          buf.append(&(*v._value.asBinary)[0], v._value.asBinary->size());
+        break;
+
+      case XmlRpcValue::TypeArray:
+        {
+          XmlRpcValue::ValueArray& a = *v._value.asArray;
+          buf += T_ARRAY;
+          putVarint(buf, a.size());
+          for (size_t i = 0; i < a.size(); ++i)
+            encode(a[i], buf);
+          break;
+        }
+
+      case XmlRpcValue::TypeStruct:
+        {
+          XmlRpcValue::ValueStruct& m = *v._value.asStruct;
+          buf += T_STRUCT;
+          putVarint(buf, m.size());
+          for (XmlRpcValue::ValueStruct::const_iterator it = m.begin(); it != m.end(); ++it) {
+            putString(buf, it->first);
+            encode(it->second, buf);
+          }
+          break;
+        }
+
+      default:
+        buf += T_INVALID;
+        break;
+    }
+  }
+
+
+  bool XmlRpcBinary::decode(const char** cp, const char* end, XmlRpcValue& v)
+  {
+    v.invalidate();
+    if (*cp >= end)
+      return false;
+
+    unsigned long long n;
+    switch (*(*cp)++) {
+      case T_INVALID:
+        return true;
+
+      case T_BOOLEAN:
+        if (*cp >= end)
+          return false;
+        v._type = XmlRpcValue::TypeBoolean;
+        v._value.asBool = (*(*cp)++ != 0);
+        return true;
+
+      case T_INT:
+        if ( ! getVarint(cp, end, n))
+          return false;
+        v._type = XmlRpcValue::TypeInt;
+        v._value.asInt = int(unzigzag(n));
+        return true;
+
+      case T_DOUBLE:
+        {
+          if (end - *cp < 8)
+            return false;
+          unsigned long long bits = 0;
+          for (int i = 7; i >= 0; --i)
+            bits = (bits << 8) | (unsigned char) (*cp)[i];
+          *cp += 8;
+          v._type = XmlRpcValue::TypeDouble;
+          memcpy(&v._value.asDouble, &bits, sizeof(bits));
+          return true;
+        }
+
+      case T_STRING:
+        v._type = XmlRpcValue::TypeString;
+        v._value.asString = new std::string();
+        if (getString(cp, end, *v._value.asString))
+          return true;
+        break;
+
+      case T_DATETIME:
+        {
+          unsigned long long f[6];
+          for (int i = 0; i < 6; ++i)
+            if ( ! getVarint(cp, end, f[i]))
+              return false;
+          struct tm t;
+          memset(&t, 0, sizeof(t));
+          t.tm_year = int(unzigzag(f[0]));
+          t.tm_mon  = int(unzigzag(f[1]));
+          t.tm_mday = int(unzigzag(f[2]));
+          t.tm_hour = int(unzigzag(f[3]));
+          t.tm_min  = int(unzigzag(f[4]));
+          t.tm_sec  = int(unzigzag(f[5]));
+          t.tm_isdst = -1;
+          v._type = XmlRpcValue::TypeDateTime;
+          v._value.asTime = new struct tm(t);
+          return true;
+        }
+
+      case T_BINARY:
+        if ( ! getVarint(cp, end, n) || n > (unsigned long long)(end - *cp))
+          return false;
+        v._type = XmlRpcValue::TypeBase64;
+        v._value.asBinary = new XmlRpcValue::BinaryData(*cp, *cp + n);
+        *cp += n;
+        return true;
+
+      case T_ARRAY:
+        {
+          // every element takes at least one byte
+          if ( ! getVarint(cp, end, n) || n > (unsigned long long)(end - *cp))
+            return false;
+          v._type = XmlRpcValue::TypeArray;
+          v._value.asArray = new XmlRpcValue::ValueArray(size_t(n));
+          XmlRpcValue::ValueArray& a = *v._value.asArray;
+          size_t i;
+          for (i = 0; i < a.size(); ++i)
+            if ( ! decode(cp, end, a[i]))
+              break;
+          if (i == a.size())
+            return true;
+          break;
+        }
+
+      case T_STRUCT:
+        {
+          if ( ! getVarint(cp, end, n) || n > (unsigned long long)(end - *cp))
+            return false;
+          v._type = XmlRpcValue::TypeStruct;
+          v._value.asStruct = new XmlRpcValue::ValueStruct;
+          std::string name;
+          unsigned long long i;
+          for (i = 0; i < n; ++i) {
+            if ( ! getString(cp, end, name) ||
+                 ! decode(cp, end, (*v._value.asStruct)[name]))
+              break;
+          }
+          if (i == n)
+            return true;
+          break;
+        }
+
+      default:
+        break;
+    }
+
+    v.invalidate();
+    return false;
+  }
+
+
+  // Frames
+
+  void XmlRpcBinary::beginFrame(std::string& frame, char kind)
+  {
+    frame.assign(PREFIX, '\0');
+    frame += kind;
+  }
+
+  void XmlRpcBinary::endFrame(std::string& frame)
+  {
+    unsigned long len = (unsigned long) (frame.length() - PREFIX);
+    frame[0] = char(len >> 24);
+    frame[1] = char(len >> 16);
+    frame[2] = char(len >> 8);
+    frame[3] = char(len);
+  }
+
+  static int prefixLength(const unsigned char* p)
+  {
+    unsigned long len = (unsigned long) p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+    return len > (unsigned long) XmlRpcBinary::MAX_FRAME ? XmlRpcBinary::MAX_FRAME + 1 : int(len);
+  }
+
+  int XmlRpcBinary::frameLength(std::string const& buf)
+  {
+    if (buf.length() < size_t(PREFIX))
+      return -1;
+    return prefixLength((const unsigned char*) buf.data());
+  }
+
+  void XmlRpcBinary::encodeCall(std::string const& methodName, XmlRpcValue const& params, std::string& frame)
+  {
+    beginFrame(frame, K_CALL);
+    putString(frame, methodName);
+    encode(params, frame);
+    endFrame(frame);
+  }
+
+  void XmlRpcBinary::encodeResponse(XmlRpcValue const& result, std::string& frame)
+  {
+    beginFrame(frame, K_RESPONSE);
+    encode(result, frame);
+    endFrame(frame);
+  }
+
+  void XmlRpcBinary::encodeFault(std::string const& msg, int errorCode, std::string& frame)
+  {
+    XmlRpcValue fault;
+    fault[XmlRpcServerConnection::FAULTCODE] = errorCode;
+    fault[XmlRpcServerConnection::FAULTSTRING] = msg;
+    beginFrame(frame, K_FAULT);
+    encode(fault, frame);
+    endFrame(frame);
+  }
+
+  bool XmlRpcBinary::decodeCall(const char* cp, const char* end, std::string& methodName, XmlRpcValue& params)
+  {
+    return cp < end && *cp++ == K_CALL &&
+           getString(&cp, end, methodName) &&
+           decode(&cp, end, params) && cp == end;
+  }
+
+  bool XmlRpcBinary::decodeResponse(const char* cp, const char* end, XmlRpcValue& result, bool& isFault)
+  {
+    if (cp >= end || (*cp != K_RESPONSE && *cp != K_FAULT))
+      return false;
+    isFault = (*cp++ == K_FAULT);
+    return decode(&cp, end, result) && cp == end;
+  }
+
+
+  // Blocking I/O
+
+  bool XmlRpcBinary::writeFrame(int fd, std::string const& frame)
+  {
+    const char* cp = frame.data();
+    size_t left = frame.length();
+    while (left > 0) {
+      int n = ::send(fd, cp, left, MSG_NOSIGNAL);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false;
+      cp += n;
+      left -= n;
+    }
+    return true;
+  }
+
+  static bool readFully(int fd, char* cp, size_t left)
+  {
+    while (left > 0) {
+      int n = ::recv(fd, cp, left, 0);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false;
+      cp += n;
+      left -= n;
+    }
+    return true;
+  }
+
+  bool XmlRpcBinary::readFrame(int fd, std::string& payload)
+  {
+    unsigned char prefix[PREFIX];
+    if ( ! readFully(fd, (char*) prefix, PREFIX))
+      return false;
+
+    int len = prefixLength(prefix);
+    if (len > MAX_FRAME)
+      return false;
+
+    payload.resize(len);
+    return len == 0 || readFully(fd, &payload[0], len);
+  }
+
+
+  // Server side
+
+  XmlRpcBinaryConnection::XmlRpcBinaryConnection(int fd, XmlRpcServer* server, bool deleteOnClose /*= false*/) :
+    XmlRpcServerConnection(fd, server, deleteOnClose)
+  {
+    _bytesWritten = 0;
+  }
+
+
+  // Read frames, run them, write the responses. A client may send its
+  // next call before reading the previous response; the calls are
+  // answered in order.
+  unsigned
+  XmlRpcBinaryConnection::handleEvent(unsigned /*eventType*/)
+  {
+    bool eof = false;
+    if (_connectionState != WRITE_RESPONSE) {
+      if ( ! XmlRpcSocket::nbRead(this->getfd(), _request, &eof)) {
+        if (_request.length() > 0)
+          XmlRpcUtil::error("XmlRpcBinaryConnection::handleEvent: read error (%s).",XmlRpcSocket::getErrorMsg().c_str());
+        return 0;
+      }
+    }
+
+    for (;;) {
+      if (_connectionState == WRITE_RESPONSE) {
+        if ( ! XmlRpcSocket::nbWrite(this->getfd(), _response, &_bytesWritten)) {
+          XmlRpcUtil::error("XmlRpcBinaryConnection::handleEvent: write error (%s).",XmlRpcSocket::getErrorMsg().c_str());
+          return 0;
+        }
+        if (_bytesWritten < int(_response.length()))
+          return XmlRpcDispatch::WritableEvent;
+        _response.clear();
+        _connectionState = READ_HEADER;
+      }
+
+      int length = XmlRpcBinary::frameLength(_request);
+      if (length > XmlRpcBinary::MAX_FRAME) {
+        XmlRpcUtil::error("XmlRpcBinaryConnection::handleEvent: frame too large.");
+        return 0;
+      }
+      if (length < 0 || int(_request.length()) < PREFIX + length) {
+        if (eof) {
+          if (_request.length() > 0)
+            XmlRpcUtil::error("XmlRpcBinaryConnection::handleEvent: EOF while reading request");
+          return 0;
+        }
+        // The length is the peer's claim; past MAX_RESERVE let the buffer
+        // grow as bytes actually arrive.
+        if (length > 0)
+          _request.reserve(PREFIX + (length < MAX_RESERVE ? length : MAX_RESERVE));
+        return XmlRpcDispatch::ReadableEvent;
+      }
+
+      executeFrame(length);
+    }
+  }
+
+
+  void
+  XmlRpcBinaryConnection::executeFrame(int length)
+  {
+    const char* cp = _request.data() + PREFIX;
+    std::string methodName;
+    XmlRpcValue params, resultValue;
+    bool ok = XmlRpcBinary::decodeCall(cp, cp + length, methodName, params);
+    _request.erase(0, PREFIX + length);
+
+    if ( ! ok)
+      XmlRpcBinary::encodeFault("invalid binary request", -1, _response);
+    else {
+      XmlRpcUtil::log(2, "XmlRpcBinaryConnection::executeFrame: server calling method '%s'",
+                      methodName.c_str());
+      try {
+        if ( ! executeMethod(methodName, params, resultValue) &&
+             ! executeMulticall(methodName, params, resultValue))
+          XmlRpcBinary::encodeFault(methodName + ": unknown method name", -1, _response);
+        else
+          XmlRpcBinary::encodeResponse(resultValue, _response);
+
+      } catch (const XmlRpcException& fault) {
+        XmlRpcUtil::log(2, "XmlRpcBinaryConnection::executeFrame: fault %s.",
+                        fault.getMessage().c_str());
+        XmlRpcBinary::encodeFault(fault.getMessage(), fault.getCode(), _response);
+      }
+    }
+
+    _bytesWritten = 0;
+    _connectionState = WRITE_RESPONSE;
+  }
+
+
+  unsigned
+  XmlRpcBinaryListener::handleEvent(unsigned /*eventType*/)
+  {
+    _server->acceptBinaryConnection();
+    return XmlRpcDispatch::ReadableEvent;   // Continue to monitor this fd
+  }
+
+} // namespace XmlRpc
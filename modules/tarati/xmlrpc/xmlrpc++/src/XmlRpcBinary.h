@@ -0,0 +1,110 @@
+
+#ifndef _XMLRPCBINARY_H_
+#define _XMLRPCBINARY_H_
+//
+// XmlRpc++ Copyright (c) 2002-2003 by Chris Morley
+//
+#if defined(_MSC_VER)
+# pragma warning(disable:4786)    // identifier was truncated in debug info
+#endif
+
+#ifndef MAKEDEPEND
+# include <string>
+#endif
+
+#include "XmlRpcValue.h"
+#include "XmlRpcSource.h"
+#include "XmlRpcServerConnection.h"
+
+namespace XmlRpc {
+
+  class XmlRpcServer;
+
+  //! Compact binary encoding of calls and values.
+  //! This is an alternative to the HTTP/XML transport for clients that need
+  //! low per-call overhead. Method dispatch is the same as for XML-RPC.
+  //!
+  //! <pre>
+  //! frame    := length(4 bytes, big endian) payload
+  //! call     := 'C' string(methodName) value(params array)
+  //! response := 'R' value(result) | 'F' value(fault struct)
+  //! value    := 'n'                                 invalid
+  //!           | 'b' byte                            boolean
+  //!           | 'i' varint                          int, zigzag encoded
+  //!           | 'd' 8 bytes                         double, IEEE little endian
+  //!           | 's' string                          string
+  //!           | 't' varint*6                        dateTime (y m d h m s)
+  //!           | 'x' varint(n) n bytes               binary, not base64
+  //!           | 'a' varint(n) value*n               array
+  //!           | 'm' varint(n) (string value)*n      struct
+  //! string   := varint(n) n bytes
+  //! </pre>
+  //! varints are unsigned LEB128.
+  class XmlRpcBinary {
+  public:
+    //! Largest payload accepted
+    static const int MAX_FRAME = 256 * 1024 * 1024;
+
+    //! Append the encoding of v to buf.
+    static void encode(XmlRpcValue const& v, std::string& buf);
+    //! Decode a value at *cp, not reading past end. Moves *cp past it.
+    static bool decode(const char** cp, const char* end, XmlRpcValue& v);
+
+    //! Build complete frames.
+    static void encodeCall(std::string const& methodName, XmlRpcValue const& params, std::string& frame);
+    static void encodeResponse(XmlRpcValue const& result, std::string& frame);
+    static void encodeFault(std::string const& msg, int errorCode, std::string& frame);
+
+    //! Decode the call payload in [cp, end).
+    static bool decodeCall(const char* cp, const char* end, std::string& methodName, XmlRpcValue& params);
+    //! Decode the response payload in [cp, end); isFault is set for fault responses.
+    static bool decodeResponse(const char* cp, const char* end, XmlRpcValue& result, bool& isFault);
+
+    //! Payload length of the frame at the start of buf, or -1 if buf
+    //! does not hold a complete length prefix yet.
+    static int frameLength(std::string const& buf);
+
+    //! Blocking frame I/O for clients.
+    static bool writeFrame(int fd, std::string const& frame);
+    static bool readFrame(int fd, std::string& payload);
+
+  protected:
+    static void putVarint(std::string& buf, unsigned long long value);
+    static bool getVarint(const char** cp, const char* end, unsigned long long& value);
+    static void putString(std::string& buf, std::string const& s);
+    static bool getString(const char** cp, const char* end, std::string& s);
+    static void beginFrame(std::string& frame, char kind);
+    static void endFrame(std::string& frame);
+  };
+
+
+  //! A connection from a client speaking the binary protocol.
+  class XmlRpcBinaryConnection : public XmlRpcServerConnection {
+  public:
+    //! Constructor
+    XmlRpcBinaryConnection(int fd, XmlRpcServer* server, bool deleteOnClose = false);
+
+    //! Handle IO on the client connection socket.
+    virtual unsigned handleEvent(unsigned eventType);
+
+  protected:
+    // Decode one call from _request, run it, and encode the response.
+    void executeFrame(int length);
+  };
+
+
+  //! Listens on the binary port of an XmlRpcServer.
+  class XmlRpcBinaryListener : public XmlRpcSource {
+  public:
+    XmlRpcBinaryListener(int fd, XmlRpcServer* server) : XmlRpcSource(fd), _server(server) {}
+
+    //! Accept a connection
+    virtual unsigned handleEvent(unsigned eventType);
+
+  protected:
+    XmlRpcServer* _server;
+  };
+
+} // namespace XmlRpc
+
+#endif // _XMLRPCBINARY_H_
@@ -2,6 +2,7 @@
 #include "XmlRpcClient.h"
 
 #include "XmlRpcSocket.h"
+#include "XmlRpcParser.h"
 #include "XmlRpc.h"
 
 #include <stdio.h>
@@ -10,6 +11,9 @@
 
 using namespace XmlRpc;
 
+// Largest buffer reserved on the strength of a Content-length header.
+static const int MAX_RESERVE = 64 * 1024;
+
 // Static data
 const char XmlRpcClient::REQUEST_BEGIN[] = 
   "<?xml version=\"1.0\"?>\r\n"
@@ -343,7 +347,10 @@ XmlRpcClient::readHeader()
   XmlRpcUtil::log(4, "client read content length: %d", _contentLength);
 
   // Otherwise copy non-header data to response buffer and set state to read response.
-  _response = bp;
+  // Reserve room for the body up front, but no more than MAX_RESERVE: the
+  // length comes from the peer, so anything bigger grows as bytes arrive.
+  _response.reserve(_contentLength < MAX_RESERVE ? _contentLength : MAX_RESERVE);
+  _response.assign(bp, ep - bp);
   _header = "";   // should parse out any interesting bits from the header (connection, etc)...
   _connectionState = READ_RESPONSE;
   return true;    // Continue monitoring this source
@@ -384,19 +391,19 @@ XmlRpcClient::readResponse()
 bool 
 XmlRpcClient::parseResponse(XmlRpcValue& result)
 {
-  // Parse response xml into result
-  int offset = 0;
-  if ( ! XmlRpcUtil::findTag(METHODRESPONSE_TAG,_response,&offset)) {
+  // Parse response xml into result, decoding straight from the buffer
+  XmlRpcParser parser(_response);
+  if ( ! parser.findTag(METHODRESPONSE_TAG)) {
     XmlRpcUtil::error("Error in XmlRpcClient::parseResponse: Invalid response - no methodResponse. Response:\n%s", _response.c_str());
     return false;
   }
 
   // Expect either <params><param>... or <fault>...
-  if ((XmlRpcUtil::nextTagIs(PARAMS_TAG,_response,&offset) &&
-       XmlRpcUtil::nextTagIs(PARAM_TAG,_response,&offset)) ||
-      XmlRpcUtil::nextTagIs(FAULT_TAG,_response,&offset) && (_isFault = true))
+  if ((parser.nextTagIs(PARAMS_TAG) &&
+       parser.nextTagIs(PARAM_TAG)) ||
+      parser.nextTagIs(FAULT_TAG) && (_isFault = true))
   {
-    if ( ! result.fromXml(_response, &offset)) {
+    if ( ! parser.parseValue(result)) {
       XmlRpcUtil::error("Error in XmlRpcClient::parseResponse: Invalid response value. Response:\n%s", _response.c_str());
       _response = "";
       return false;
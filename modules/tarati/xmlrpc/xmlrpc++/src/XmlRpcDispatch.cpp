@@ -20,20 +20,44 @@
 # include <sys/time.h>
 #endif  // _WINDOWS
 
+#ifdef XMLRPC_HAVE_EPOLL
+# include <sys/epoll.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
 
 using namespace XmlRpc;
 
 
-XmlRpcDispatch::XmlRpcDispatch()
+XmlRpcDispatch::XmlRpcDispatch(Backend backend)
 {
   _endTime = -1.0;
   _doClear = false;
   _inWork = false;
+  _backend = SelectBackend;
+  _epfd = -1;
+
+#ifdef XMLRPC_HAVE_EPOLL
+  if (backend == EpollBackend) {
+    _epfd = epoll_create(64);     // size is only a hint
+    if (_epfd < 0)
+      XmlRpcUtil::error("XmlRpcDispatch: epoll_create failed (%d), using select.", errno);
+    else {
+      fcntl(_epfd, F_SETFD, FD_CLOEXEC);
+      _backend = EpollBackend;
+    }
+  }
+#endif
 }
 
 
 XmlRpcDispatch::~XmlRpcDispatch()
 {
+#ifdef XMLRPC_HAVE_EPOLL
+  if (_epfd >= 0)
+    ::close(_epfd);
+#endif
 }
 
 // Monitor this source for the specified events and call its event handler
@@ -41,6 +65,22 @@ XmlRpcDispatch::~XmlRpcDispatch()
 void
 XmlRpcDispatch::addSource(XmlRpcSource* source, unsigned mask)
 {
+  if (_backend == EpollBackend) {
+    // epoll refuses to watch an fd twice, so adding a source again
+    // just changes what it is watched for
+    SourceIndex::iterator ii = _index.find(source);
+    if (ii != _index.end()) {
+      ii->second->getMask() = mask;
+      epollUpdate(*ii->second);
+      return;
+    }
+    _sources.push_back(MonitoredSource(source, mask));
+    SourceList::iterator it = --_sources.end();
+    _index[source] = it;
+    epollUpdate(*it);
+    return;
+  }
+
   _sources.push_back(MonitoredSource(source, mask));
 }
 
@@ -48,6 +88,13 @@ XmlRpcDispatch::addSource(XmlRpcSource* source, unsigned mask)
 void
 XmlRpcDispatch::removeSource(XmlRpcSource* source)
 {
+  if (_backend == EpollBackend) {
+    SourceIndex::iterator ii = _index.find(source);
+    if (ii != _index.end())
+      epollRemove(ii->second);
+    return;
+  }
+
   for (SourceList::iterator it=_sources.begin(); it!=_sources.end(); ++it)
     if (it->getSource() == source)
     {
@@ -61,6 +108,15 @@ XmlRpcDispatch::removeSource(XmlRpcSource* source)
 void 
 XmlRpcDispatch::setSourceEvents(XmlRpcSource* source, unsigned eventMask)
 {
+  if (_backend == EpollBackend) {
+    SourceIndex::iterator ii = _index.find(source);
+    if (ii != _index.end()) {
+      ii->second->getMask() = eventMask;
+      epollUpdate(*ii->second);
+    }
+    return;
+  }
+
   for (SourceList::iterator it=_sources.begin(); it!=_sources.end(); ++it)
     if (it->getSource() == source)
     {
@@ -90,6 +146,19 @@ XmlRpcDispatch::work(double timeout)
   _doClear = false;
   _inWork = true;
 
+  if (_backend == EpollBackend)
+    workEpoll(timeout);
+  else
+    workSelect(timeout);
+
+  _inWork = false;
+}
+
+
+// Rebuild the descriptor sets from the source list on every iteration
+void
+XmlRpcDispatch::workSelect(double timeout)
+{
   // Only work while there is something to monitor
   while (_sources.size() > 0) {
 
@@ -124,7 +193,6 @@ XmlRpcDispatch::work(double timeout)
     if (nEvents < 0 && errno != EINTR)
     {
       XmlRpcUtil::error("Error in XmlRpcDispatch::work: error in select (%d).", nEvents);
-      _inWork = false;
       return;
     }
 
@@ -157,13 +225,83 @@ XmlRpcDispatch::work(double timeout)
     // Check whether to clear all sources
     if (_doClear)
     {
-      SourceList closeList = _sources;
-      _sources.clear();
-      for (SourceList::iterator it=closeList.begin(); it!=closeList.end(); ++it) {
-	XmlRpcSource *src = it->getSource();
-        src->close();
+      closeAll();
+      _doClear = false;
+    }
+
+    // Check whether end time has passed
+    if (0 <= _endTime && getTime() > _endTime)
+      break;
+  }
+}
+
+
+// Let the kernel keep the interest set; each wakeup only costs the
+// number of ready sources.  Level triggered, so handlers may consume
+// input in pieces just like with select.
+void
+XmlRpcDispatch::workEpoll(double timeout)
+{
+#ifdef XMLRPC_HAVE_EPOLL
+  const int MaxEvents = 256;
+  struct epoll_event events[MaxEvents];
+
+  // Only work while there is something to monitor
+  while (_sources.size() > 0) {
+
+    int msTimeout = (timeout < 0.0) ? -1 : (int)floor(1000.0 * timeout);
+    int nEvents = epoll_wait(_epfd, events, MaxEvents, msTimeout);
+
+    if (nEvents < 0 && errno != EINTR)
+    {
+      XmlRpcUtil::error("Error in XmlRpcDispatch::work: error in epoll_wait (%d).", errno);
+      return;
+    }
+
+    // Process events
+    for (int i=0; i<nEvents; ++i)
+    {
+      MonitoredSource* ms = (MonitoredSource*) events[i].data.ptr;
+      if (ms->_removed)
+        continue;       // removed by an earlier handler in this batch
+
+      XmlRpcSource* src = ms->getSource();
+      unsigned ev = events[i].events;
+      unsigned newMask = (unsigned) -1;
+
+      // select reports errors and hangups as readable/writable, so the
+      // handler finds out when it reads or writes; do the same
+      if (ev & (EPOLLERR | EPOLLHUP))
+        ev |= ms->_events;
+
+      if (ev & EPOLLIN)
+        newMask &= src->handleEvent(ReadableEvent);
+      if ((ev & EPOLLOUT) && ! ms->_removed)
+        newMask &= src->handleEvent(WritableEvent);
+      if ((ev & EPOLLPRI) && ! ms->_removed)
+        newMask &= src->handleEvent(Exception);
+
+      if (ms->_removed)
+        continue;
+
+      if ( ! newMask) {
+        SourceIndex::iterator ii = _index.find(src);
+        if (ii != _index.end())
+          epollRemove(ii->second);  // Stop monitoring this one
+        if ( ! src->getKeepOpen())
+          src->close();
+      } else if (newMask != (unsigned) -1) {
+        ms->getMask() = newMask;
+        epollUpdate(*ms);
       }
+    }
 
+    epollSweep();
+
+    // Check whether to clear all sources
+    if (_doClear)
+    {
+      closeAll();
       _doClear = false;
     }
 
@@ -171,8 +309,101 @@ XmlRpcDispatch::work(double timeout)
     if (0 <= _endTime && getTime() > _endTime)
       break;
   }
+#endif
+}
 
-  _inWork = false;
+
+// Bring the kernel's interest set in line with the source's mask
+void
+XmlRpcDispatch::epollUpdate(MonitoredSource& ms)
+{
+#ifdef XMLRPC_HAVE_EPOLL
+  unsigned events = 0;
+  if (ms.getMask() & ReadableEvent) events |= EPOLLIN;
+  if (ms.getMask() & WritableEvent) events |= EPOLLOUT;
+  if (ms.getMask() & Exception)     events |= EPOLLPRI;
+
+  int fd = ms.getSource()->getfd();
+  if (fd == ms._fd && events == ms._events)
+    return;
+
+  struct epoll_event ev;
+  ev.events = events;
+  ev.data.ptr = &ms;
+
+  // Drop the old registration if the fd changed or nothing is watched;
+  // epoll would still report hangups for a registered fd with no events.
+  if (ms._fd >= 0 && (fd != ms._fd || events == 0)) {
+    epoll_ctl(_epfd, EPOLL_CTL_DEL, ms._fd, &ev);
+    ms._fd = -1;
+    ms._events = 0;
+  }
+  if (events == 0 || fd < 0)
+    return;
+
+  int op = (ms._fd < 0) ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+  if (epoll_ctl(_epfd, op, fd, &ev) < 0)
+    XmlRpcUtil::error("XmlRpcDispatch: epoll_ctl failed for fd %d (%d).", fd, errno);
+  else {
+    ms._fd = fd;
+    ms._events = events;
+  }
+#endif
+}
+
+
+// Stop watching a source.  Events for it may still be pending in the
+// batch being processed, so its entry is kept until the batch is done.
+void
+XmlRpcDispatch::epollRemove(SourceList::iterator it)
+{
+#ifdef XMLRPC_HAVE_EPOLL
+  if (it->_fd >= 0) {
+    struct epoll_event ev;   // ignored, but old kernels want one
+    epoll_ctl(_epfd, EPOLL_CTL_DEL, it->_fd, &ev);   // fd may already be closed
+    it->_fd = -1;
+  }
+#endif
+  _index.erase(it->getSource());
+  if (_inWork) {
+    it->_removed = true;
+    _removedSources.push_back(it);
+  } else
+    _sources.erase(it);
+}
+
+
+// Erase the entries of sources removed during the last batch of events
+void
+XmlRpcDispatch::epollSweep()
+{
+  for (size_t i=0; i<_removedSources.size(); ++i)
+    _sources.erase(_removedSources[i]);
+  _removedSources.clear();
+}
+
+
+// Stop monitoring and close all sources
+void
+XmlRpcDispatch::closeAll()
+{
+  if (_backend == EpollBackend) {
+    epollSweep();
+    for (SourceList::iterator it=_sources.begin(); it!=_sources.end(); ++it)
+      if (it->_fd >= 0) {
+#ifdef XMLRPC_HAVE_EPOLL
+        struct epoll_event ev;
+        epoll_ctl(_epfd, EPOLL_CTL_DEL, it->_fd, &ev);
+#endif
+        it->_fd = -1;
+      }
+    _index.clear();
+  }
+
+  SourceList closeList = _sources;
+  _sources.clear();
+  for (SourceList::iterator it=closeList.begin(); it!=closeList.end(); ++it)
+    it->getSource()->close();
 }
 
 
@@ -191,12 +422,7 @@ XmlRpcDispatch::clear()
   if (_inWork)
     _doClear = true;  // Finish reporting current events before clearing
   else
-  {
-    SourceList closeList = _sources;
-    _sources.clear();
-    for (SourceList::iterator it=closeList.begin(); it!=closeList.end(); ++it)
-      it->getSource()->close();
-  }
+    closeAll();
 }
 
 
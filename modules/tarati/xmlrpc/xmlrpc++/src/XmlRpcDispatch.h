@@ -10,6 +10,14 @@
 
 #ifndef MAKEDEPEND
 # include <list>
+# include <map>
+# include <vector>
+#endif
+
+// epoll is only available on linux; elsewhere the epoll backend
+// silently falls back to select.
+#if defined(__linux__) && !defined(XMLRPC_NO_EPOLL)
+# define XMLRPC_HAVE_EPOLL 1
 #endif
 
 namespace XmlRpc {
@@ -21,10 +29,21 @@ namespace XmlRpc {
   //! callbacks when interesting events happen.
   class XmlRpcDispatch {
   public:
+    //! Mechanisms used to wait for events
+    enum Backend {
+      SelectBackend,        //!< select(); portable, limited to FD_SETSIZE
+      EpollBackend          //!< epoll (linux); cost independent of # sources
+    };
+
     //! Constructor
-    XmlRpcDispatch();
+    //!  @param backend How to wait for events.  EpollBackend falls back to
+    //!                 SelectBackend where epoll is not available.
+    XmlRpcDispatch(Backend backend = SelectBackend);
     ~XmlRpcDispatch();
 
+    //! Return the backend actually in use
+    Backend getBackend() const { return _backend; }
+
     //! Values indicating the type of events a source is interested in
     enum EventType {
       ReadableEvent = 1,    //!< data available to read
@@ -64,13 +83,23 @@ namespace XmlRpc {
     // helper
     double getTime();
 
+    // select and epoll versions of work()
+    void workSelect(double timeout);
+    void workEpoll(double timeout);
+
     // A source to monitor and what to monitor it for
     struct MonitoredSource {
-      MonitoredSource(XmlRpcSource* src, unsigned mask) : _src(src), _mask(mask) {}
+      MonitoredSource(XmlRpcSource* src, unsigned mask)
+        : _src(src), _mask(mask), _fd(-1), _events(0), _removed(false) {}
       XmlRpcSource* getSource() const { return _src; }
       unsigned& getMask() { return _mask; }
       XmlRpcSource* _src;
       unsigned _mask;
+      // epoll only: fd and epoll events as registered with the kernel,
+      // and whether the source was removed while events were pending
+      int _fd;
+      unsigned _events;
+      bool _removed;
     };
 
     // A list of sources to monitor
@@ -79,6 +108,24 @@ namespace XmlRpc {
     // Sources being monitored
     SourceList _sources;
 
+    // How we wait for events
+    Backend _backend;
+
+    // epoll only: the epoll instance, where each source is in _sources,
+    // and sources removed during the current batch of events.  Events
+    // point to their list entry, so entries are only erased once the
+    // batch is done.
+    typedef std::map< XmlRpcSource*, SourceList::iterator > SourceIndex;
+    int _epfd;
+    SourceIndex _index;
+    std::vector< SourceList::iterator > _removedSources;
+
+    // epoll helpers
+    void epollUpdate(MonitoredSource& ms);
+    void epollRemove(SourceList::iterator it);
+    void epollSweep();
+    void closeAll();
+
     // When work should stop (-1 implies wait forever, or until exit is called)
     double _endTime;
 
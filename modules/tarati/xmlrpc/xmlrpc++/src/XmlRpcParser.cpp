@@ -0,0 +1,382 @@
+
+#include "XmlRpcParser.h"
+#include "base64.h"
+
+#ifndef MAKEDEPEND
+# include <ctype.h>
+# include <stdlib.h>
+# include <stdio.h>
+# include <string.h>
+#endif
+
+namespace XmlRpc {
+
+
+  static const char VALUE_TAG[]     = "<value>";
+  static const char VALUE_ETAG[]    = "</value>";
+
+  static const char BOOLEAN_TAG[]   = "<boolean>";
+  static const char DOUBLE_TAG[]    = "<double>";
+  static const char INT_TAG[]       = "<int>";
+  static const char I4_TAG[]        = "<i4>";
+  static const char STRING_TAG[]    = "<string>";
+  static const char DATETIME_TAG[]  = "<dateTime.iso8601>";
+  static const char BASE64_TAG[]    = "<base64>";
+
+  static const char ARRAY_TAG[]     = "<array>";
+  static const char DATA_TAG[]      = "<data>";
+  static const char DATA_ETAG[]     = "</data>";
+
+  static const char STRUCT_TAG[]    = "<struct>";
+  static const char MEMBER_TAG[]    = "<member>";
+  static const char NAME_TAG[]      = "<name>";
+  static const char NAME_ETAG[]     = "</name>";
+  static const char MEMBER_ETAG[]   = "</member>";
+
+  // Length of a tag constant
+# define TAGLEN(tag) (int(sizeof(tag)) - 1)
+
+
+  // xml encodings (xml-encoded entities are preceded with '&')
+  static const char  rawEntity[] = { '<',   '>',   '&',    '\'',    '\"',    0 };
+  static const char* xmlEntity[] = { "lt;", "gt;", "amp;", "apos;", "quot;", 0 };
+  static const int   xmlEntLen[] = { 3,     3,     4,      5,       5 };
+
+
+  XmlRpcParser::XmlRpcParser(std::string const& xml, int offset)
+  {
+    _begin = xml.c_str();
+    _end = _begin + xml.length();
+    _cp = _begin + offset;
+    if (_cp > _end) _cp = _end;
+  }
+
+  XmlRpcParser::XmlRpcParser(const char* xml, int len)
+  {
+    _begin = _cp = xml;
+    _end = xml + len;
+  }
+
+
+  // Tag helpers
+
+  void XmlRpcParser::skipSpace()
+  {
+    while (_cp < _end && isspace(*_cp))
+      ++_cp;
+  }
+
+  // Is the tag at the cursor?  Moves past it if it is.
+  bool XmlRpcParser::tagIs(const char* tag, int len)
+  {
+    if (_end - _cp < len || memcmp(_cp, tag, len) != 0)
+      return false;
+    _cp += len;
+    return true;
+  }
+
+  bool XmlRpcParser::findTag(const char* tag, int len)
+  {
+    for (const char* cp = _cp; _end - cp >= len; ++cp) {
+      cp = (const char*) memchr(cp, tag[0], _end - cp);
+      if (cp == 0 || _end - cp < len)
+        return false;
+      if (memcmp(cp, tag, len) == 0) {
+        _cp = cp + len;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Position of the next c, or 0
+  const char* XmlRpcParser::findChar(char c) const
+  {
+    return (const char*) memchr(_cp, c, _end - _cp);
+  }
+
+  bool XmlRpcParser::findTag(const char* tag)
+  {
+    return findTag(tag, int(strlen(tag)));
+  }
+
+  bool XmlRpcParser::nextTagIs(const char* tag)
+  {
+    const char* saved = _cp;
+    skipSpace();
+    if (tagIs(tag, int(strlen(tag))))
+      return true;
+    _cp = saved;
+    return false;
+  }
+
+  bool XmlRpcParser::parseTag(const char* tag, std::string& contents)
+  {
+    contents.clear();
+    const char* saved = _cp;
+    if ( ! findTag(tag))
+      return false;
+
+    // </tag> is tag with a '/' after the '<'
+    const char* start = _cp;
+    int len = int(strlen(tag));
+    for (const char* cp = start; (cp = (const char*) memchr(cp, '<', _end - cp)) != 0; ++cp)
+      if (_end - cp > len && cp[1] == '/' && memcmp(cp + 2, tag + 1, len - 1) == 0) {
+        contents.assign(start, cp - start);
+        _cp = cp + len + 1;
+        return true;
+      }
+
+    _cp = saved;
+    return false;
+  }
+
+
+  // Append the text in [first, last) to s, replacing xml entities
+  void XmlRpcParser::decode(const char* first, const char* last, std::string& s)
+  {
+    s.reserve(s.length() + (last - first));
+    while (first < last) {
+      const char* amp = (const char*) memchr(first, '&', last - first);
+      if (amp == 0) {
+        s.append(first, last - first);
+        return;
+      }
+      s.append(first, amp - first);
+
+      int iEntity;
+      for (iEntity=0; xmlEntity[iEntity] != 0; ++iEntity)
+        if (last - amp > xmlEntLen[iEntity] &&
+            memcmp(amp+1, xmlEntity[iEntity], xmlEntLen[iEntity]) == 0)
+          break;
+
+      if (xmlEntity[iEntity] != 0) {
+        s += rawEntity[iEntity];
+        first = amp + 1 + xmlEntLen[iEntity];
+      } else {                          // unrecognized sequence
+        s += '&';
+        first = amp + 1;
+      }
+    }
+  }
+
+
+  // Set the value from xml. The cursor should be at the start of a
+  // <value> tag (modulo whitespace). Destroys any existing value.
+  bool XmlRpcParser::parseValue(XmlRpcValue& value)
+  {
+    const char* saved = _cp;
+
+    value.invalidate();
+    if ( ! nextTagIs(VALUE_TAG))
+      return false;       // Not a value, cursor not moved
+
+    const char* afterValue = _cp;
+    skipSpace();
+
+    bool result = false;
+    if (_cp >= _end || *_cp != '<') {
+      _cp = afterValue;   // untagged string, including leading blanks
+      result = parseString(value);
+    }
+    else if (tagIs(BOOLEAN_TAG, TAGLEN(BOOLEAN_TAG)))
+      result = parseBool(value);
+    else if (tagIs(I4_TAG, TAGLEN(I4_TAG)) || tagIs(INT_TAG, TAGLEN(INT_TAG)))
+      result = parseInt(value);
+    else if (tagIs(DOUBLE_TAG, TAGLEN(DOUBLE_TAG)))
+      result = parseDouble(value);
+    else if (tagIs(STRING_TAG, TAGLEN(STRING_TAG)))
+      result = parseString(value);
+    else if (tagIs(DATETIME_TAG, TAGLEN(DATETIME_TAG)))
+      result = parseTime(value);
+    else if (tagIs(BASE64_TAG, TAGLEN(BASE64_TAG)))
+      result = parseBinary(value);
+    else if (tagIs(ARRAY_TAG, TAGLEN(ARRAY_TAG)))
+      result = parseArray(value);
+    else if (tagIs(STRUCT_TAG, TAGLEN(STRUCT_TAG)))
+      result = parseStruct(value);
+    // Watch for empty/blank strings with no <string>tag
+    else if (tagIs(VALUE_ETAG, TAGLEN(VALUE_ETAG)))
+    {
+      _cp = afterValue;   // back up & try again
+      result = parseString(value);
+    }
+
+    if (result)  // Skip over the </value> tag
+      findTag(VALUE_ETAG, TAGLEN(VALUE_ETAG));
+    else {       // Unrecognized tag after <value>
+      value.invalidate();
+      _cp = saved;
+    }
+
+    return result;
+  }
+
+
+  // Boolean
+  bool XmlRpcParser::parseBool(XmlRpcValue& value)
+  {
+    char* valueEnd;
+    long ivalue = strtol(_cp, &valueEnd, 10);
+    if (valueEnd == _cp || (ivalue != 0 && ivalue != 1))
+      return false;
+
+    value._type = XmlRpcValue::TypeBoolean;
+    value._value.asBool = (ivalue == 1);
+    _cp = valueEnd;
+    return true;
+  }
+
+  // Int
+  bool XmlRpcParser::parseInt(XmlRpcValue& value)
+  {
+    char* valueEnd;
+    long ivalue = strtol(_cp, &valueEnd, 10);
+    if (valueEnd == _cp)
+      return false;
+
+    value._type = XmlRpcValue::TypeInt;
+    value._value.asInt = int(ivalue);
+    _cp = valueEnd;
+    return true;
+  }
+
+  // Double
+  bool XmlRpcParser::parseDouble(XmlRpcValue& value)
+  {
+    char* valueEnd;
+    double dvalue = strtod(_cp, &valueEnd);
+    if (valueEnd == _cp)
+      return false;
+
+    value._type = XmlRpcValue::TypeDouble;
+    value._value.asDouble = dvalue;
+    _cp = valueEnd;
+    return true;
+  }
+
+  // String
+  bool XmlRpcParser::parseString(XmlRpcValue& value)
+  {
+    const char* valueEnd = findChar('<');
+    if (valueEnd == 0)
+      return false;     // No end tag;
+
+    value._type = XmlRpcValue::TypeString;
+    value._value.asString = new std::string();
+    decode(_cp, valueEnd, *value._value.asString);
+    _cp = valueEnd;
+    return true;
+  }
+
+  // DateTime (stored as a struct tm)
+  bool XmlRpcParser::parseTime(XmlRpcValue& value)
+  {
+    const char* valueEnd = findChar('<');
+    if (valueEnd == 0)
+      return false;     // No end tag;
+
+    struct tm t;
+    if (sscanf(_cp,"%4d%2d%2dT%2d:%2d:%2d",&t.tm_year,&t.tm_mon,&t.tm_mday,&t.tm_hour,&t.tm_min,&t.tm_sec) != 6)
+      return false;
+
+    t.tm_isdst = -1;
+    value._type = XmlRpcValue::TypeDateTime;
+    value._value.asTime = new struct tm(t);
+    _cp = valueEnd;
+    return true;
+  }
+
+  // Base64
+  bool XmlRpcParser::parseBinary(XmlRpcValue& value)
+  {
+    const char* valueEnd = findChar('<');
+    if (valueEnd == 0)
+      return false;     // No end tag;
+
+    value._type = XmlRpcValue::TypeBase64;
+    value._value.asBinary = new XmlRpcValue::BinaryData();
+    value._value.asBinary->reserve((valueEnd - _cp) * 3 / 4);
+
+    // convert from base64 to binary
+    int iostatus = 0;
+    base64<char> decoder;
+    std::back_insert_iterator<XmlRpcValue::BinaryData> ins = std::back_inserter(*value._value.asBinary);
+    decoder.get(_cp, valueEnd, ins, iostatus);
+
+    _cp = valueEnd;
+    return true;
+  }
+
+  // Array
+  bool XmlRpcParser::parseArray(XmlRpcValue& value)
+  {
+    if ( ! nextTagIs(DATA_TAG))
+      return false;
+
+    value._type = XmlRpcValue::TypeArray;
+    value._value.asArray = new XmlRpcValue::ValueArray;
+    XmlRpcValue::ValueArray& array = *value._value.asArray;
+
+    // Parse each element where it will live
+    while (parseValue(append(array)))
+      ;
+    array.pop_back();     // the one that did not parse
+
+    // Skip the trailing </data>
+    (void) nextTagIs(DATA_ETAG);
+    return true;
+  }
+
+  // Growing a vector of values would copy each value, including all of
+  // its nested arrays and structs; move them by swapping instead.
+  XmlRpcValue& XmlRpcParser::append(XmlRpcValue::ValueArray& array)
+  {
+    if (array.size() == array.capacity()) {
+      XmlRpcValue::ValueArray bigger;
+      bigger.reserve(array.empty() ? 8 : 2 * array.size());
+      bigger.resize(array.size());
+      for (size_t i=0; i<array.size(); ++i)
+        bigger[i].swap(array[i]);
+      array.swap(bigger);
+    }
+    array.resize(array.size() + 1);
+    return array.back();
+  }
+
+  // Struct
+  bool XmlRpcParser::parseStruct(XmlRpcValue& value)
+  {
+    value._type = XmlRpcValue::TypeStruct;
+    value._value.asStruct = new XmlRpcValue::ValueStruct;
+    XmlRpcValue::ValueStruct& members = *value._value.asStruct;
+
+    std::string name;
+    while (nextTagIs(MEMBER_TAG)) {
+      // name
+      name.clear();
+      if (findTag(NAME_TAG, TAGLEN(NAME_TAG))) {
+        const char* nameEnd = findChar('<');
+        if (nameEnd != 0) {
+          decode(_cp, nameEnd, name);
+          _cp = nameEnd;
+        }
+        (void) nextTagIs(NAME_ETAG);
+      }
+
+      // value, decoded into its place in the struct; the first of
+      // several members with the same name wins
+      std::pair<XmlRpcValue::ValueStruct::iterator, bool> ins =
+        members.insert(std::make_pair(name, XmlRpcValue()));
+      XmlRpcValue duplicate;
+      if ( ! parseValue(ins.second ? ins.first->second : duplicate)) {
+        value.invalidate();
+        return false;
+      }
+
+      (void) nextTagIs(MEMBER_ETAG);
+    }
+    return true;
+  }
+
+} // namespace XmlRpc
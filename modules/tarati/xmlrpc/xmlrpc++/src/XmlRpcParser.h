@@ -0,0 +1,80 @@
+
+#ifndef _XMLRPCPARSER_H_
+#define _XMLRPCPARSER_H_
+//
+// XmlRpc++ Copyright (c) 2002-2003 by Chris Morley
+//
+#if defined(_MSC_VER)
+# pragma warning(disable:4786)    // identifier was truncated in debug info
+#endif
+
+#ifndef MAKEDEPEND
+# include <string>
+#endif
+
+#include "XmlRpcValue.h"
+
+namespace XmlRpc {
+
+  //! Decodes XML-RPC messages in place.
+  //! The parser walks a character buffer with a cursor and builds values
+  //! directly from it: tags are matched where they stand, and text is
+  //! entity-decoded straight into the value being built, so no substrings
+  //! are copied on the way.  The buffer must stay alive and unchanged while
+  //! the parser is used, and must be NUL-terminated (std::string is).
+  class XmlRpcParser {
+  public:
+    //! Parse xml, starting offset chars into it.
+    XmlRpcParser(std::string const& xml, int offset = 0);
+    //! Parse the len chars at xml; xml[len] must be 0.
+    XmlRpcParser(const char* xml, int len);
+
+    //! Number of chars consumed so far.
+    int getOffset() const { return int(_cp - _begin); }
+
+    //! Returns true if the tag is found and moves past it.
+    bool findTag(const char* tag);
+
+    //! Returns true if the tag is next (modulo any whitespace) and moves past it.
+    bool nextTagIs(const char* tag);
+
+    //! Sets contents to what is between the next <tag> and </tag> and moves
+    //! past </tag>.  Returns false, leaving contents empty, if either is missing.
+    bool parseTag(const char* tag, std::string& contents);
+
+    //! Decode a <value> into value, destroying its previous contents.
+    //! On failure the value is invalid and the cursor is not moved.
+    bool parseValue(XmlRpcValue& value);
+
+  protected:
+
+    // Tag helpers
+    void skipSpace();
+    bool tagIs(const char* tag, int len);
+    bool findTag(const char* tag, int len);
+    const char* findChar(char c) const;
+
+    // Append the entity-decoded text in [first, last) to s
+    static void decode(const char* first, const char* last, std::string& s);
+
+    // Decode the contents of the value; the cursor is past the type tag
+    bool parseBool(XmlRpcValue& value);
+    bool parseInt(XmlRpcValue& value);
+    bool parseDouble(XmlRpcValue& value);
+    bool parseString(XmlRpcValue& value);
+    bool parseTime(XmlRpcValue& value);
+    bool parseBinary(XmlRpcValue& value);
+    bool parseArray(XmlRpcValue& value);
+    bool parseStruct(XmlRpcValue& value);
+
+    // Add an element to an array without deep-copying the existing ones
+    static XmlRpcValue& append(XmlRpcValue::ValueArray& array);
+
+    const char* _begin;   // start of the buffer
+    const char* _cp;      // cursor
+    const char* _end;     // end of the buffer (points at the terminating 0)
+  };
+
+} // namespace XmlRpc
+
+#endif // _XMLRPCPARSER_H_
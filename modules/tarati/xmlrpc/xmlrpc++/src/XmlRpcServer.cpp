@@ -1,18 +1,26 @@
 
 #include "XmlRpcServer.h"
 #include "XmlRpcServerConnection.h"
+#include "XmlRpcBinary.h"
 #include "XmlRpcServerMethod.h"
 #include "XmlRpcSocket.h"
 #include "XmlRpcUtil.h"
 #include "XmlRpcException.h"
 
+#ifndef MAKEDEPEND
+# include <algorithm>
+# include <vector>
+#endif
+
 
 using namespace XmlRpc;
 
 
-XmlRpcServer::XmlRpcServer()
+XmlRpcServer::XmlRpcServer(XmlRpcDispatch::Backend backend)
+  : _disp(backend)
 {
   _introspectionEnabled = false;
+  _binaryListener = 0;
   _listMethods = 0;
   _methodHelp = 0;
   _asyncIoSignal = -1; // default: no async I/O notification
@@ -22,6 +30,7 @@ XmlRpcServer::XmlRpcServer()
 XmlRpcServer::~XmlRpcServer()
 {
   this->shutdown();
+  delete _binaryListener;
   _methods.clear();
   delete _listMethods;
   delete _methodHelp;
@@ -69,6 +78,32 @@ XmlRpcServer::findMethod(const std::string& name) const
 // set it in listen mode to make it available for clients.
 bool 
 XmlRpcServer::bindAndListen(int port, int backlog /*= 5*/)
+{
+  return listenOn(this, port, backlog);
+}
+
+
+// Listen for binary protocol clients on a second port.
+bool 
+XmlRpcServer::bindAndListenBinary(int port, int backlog /*= 5*/)
+{
+  if (_binaryListener)
+    return false;   // already listening
+
+  _binaryListener = new XmlRpcBinaryListener(-1, this);
+  if ( ! listenOn(_binaryListener, port, backlog))
+  {
+    delete _binaryListener;
+    _binaryListener = 0;
+    return false;
+  }
+  return true;
+}
+
+
+// Set up a listening socket for src and have the dispatcher watch it.
+bool
+XmlRpcServer::listenOn(XmlRpcSource* src, int port, int backlog)
 {
   int fd = XmlRpcSocket::socket();
   if (fd < 0)
@@ -77,12 +112,12 @@ XmlRpcServer::bindAndListen(int port, int backlog /*= 5*/)
     return false;
   }
 
-  this->setfd(fd);
+  src->setfd(fd);
 
   // Don't block on reads/writes
   if ( ! XmlRpcSocket::setNonBlocking(fd))
   {
-    this->close();
+    src->close();
     XmlRpcUtil::error("XmlRpcServer::bindAndListen: Could not set socket to non-blocking input mode (%s).", XmlRpcSocket::getErrorMsg().c_str());
     return false;
   }
@@ -90,7 +125,7 @@ XmlRpcServer::bindAndListen(int port, int backlog /*= 5*/)
   // Set async I/O notification
   if ( ! XmlRpcSocket::setAsyncIo(fd, _asyncIoSignal))
   {
-    this->close();
+    src->close();
     XmlRpcUtil::error("XmlRpcServer::bindAndListen: Could not set socket async I/O behavior (%s).", XmlRpcSocket::getErrorMsg().c_str());
     return false;
   }
@@ -98,7 +133,7 @@ XmlRpcServer::bindAndListen(int port, int backlog /*= 5*/)
   // Allow this port to be re-bound immediately so server re-starts are not delayed
   if ( ! XmlRpcSocket::setReuseAddr(fd))
   {
-    this->close();
+    src->close();
     XmlRpcUtil::error("XmlRpcServer::bindAndListen: Could not set SO_REUSEADDR socket option (%s).", XmlRpcSocket::getErrorMsg().c_str());
     return false;
   }
@@ -106,7 +141,7 @@ XmlRpcServer::bindAndListen(int port, int backlog /*= 5*/)
   // Bind to the specified port on the default interface
   if ( ! XmlRpcSocket::bind(fd, port))
   {
-    this->close();
+    src->close();
     XmlRpcUtil::error("XmlRpcServer::bindAndListen: Could not bind to specified port (%s).", XmlRpcSocket::getErrorMsg().c_str());
     return false;
   }
@@ -114,7 +149,7 @@ XmlRpcServer::bindAndListen(int port, int backlog /*= 5*/)
   // Set in listening mode
   if ( ! XmlRpcSocket::listen(fd, backlog))
   {
-    this->close();
+    src->close();
     XmlRpcUtil::error("XmlRpcServer::bindAndListen: Could not set socket in listening mode (%s).", XmlRpcSocket::getErrorMsg().c_str());
     return false;
   }
@@ -122,7 +157,7 @@ XmlRpcServer::bindAndListen(int port, int backlog /*= 5*/)
   XmlRpcUtil::log(2, "XmlRpcServer::bindAndListen: server listening on port %d fd %d", port, fd);
 
   // Notify the dispatcher to listen on this source when we are in work()
-  _disp.addSource(this, XmlRpcDispatch::ReadableEvent);
+  _disp.addSource(src, XmlRpcDispatch::ReadableEvent);
 
   return true;
 }
@@ -134,6 +169,13 @@ XmlRpcServer::getPort(void) const
   return XmlRpcSocket::getPort(getfd());
 }
 
+// get port number of the binary protocol, or -1
+int
+XmlRpcServer::getBinaryPort(void) const
+{
+  return _binaryListener ? XmlRpcSocket::getPort(_binaryListener->getfd()) : -1;
+}
+
 // Process client requests for the specified time
 void 
 XmlRpcServer::work(double msTime)
@@ -159,7 +201,20 @@ XmlRpcServer::handleEvent(unsigned mask)
 void
 XmlRpcServer::acceptConnection()
 {
-  int s = XmlRpcSocket::accept(this->getfd());
+  acceptConnection(this->getfd(), false);
+}
+
+// Same for a client of the binary protocol.
+void
+XmlRpcServer::acceptBinaryConnection()
+{
+  acceptConnection(_binaryListener->getfd(), true);
+}
+
+void
+XmlRpcServer::acceptConnection(int listenFd, bool binary)
+{
+  int s = XmlRpcSocket::accept(listenFd);
   XmlRpcUtil::log(2, "XmlRpcServer::acceptConnection: socket %d", s);
   if (s < 0)
   {
@@ -179,7 +234,9 @@ XmlRpcServer::acceptConnection()
   else  // Notify the dispatcher to listen for input on this source when we are in work()
   {
     XmlRpcUtil::log(2, "XmlRpcServer::acceptConnection: creating a connection");
-    _disp.addSource(this->createConnection(s), XmlRpcDispatch::ReadableEvent);
+    XmlRpcServerConnection* sc = binary ? this->createBinaryConnection(s)
+                                        : this->createConnection(s);
+    _disp.addSource(sc, XmlRpcDispatch::ReadableEvent);
   }
 }
 
@@ -192,6 +249,13 @@ XmlRpcServer::createConnection(int s)
   return new XmlRpcServerConnection(s, this, true);
 }
 
+// Same for a binary protocol client.
+XmlRpcServerConnection*
+XmlRpcServer::createBinaryConnection(int s)
+{
+  return new XmlRpcBinaryConnection(s, this, true);
+}
+
 
 void 
 XmlRpcServer::removeConnection(XmlRpcServerConnection* sc)
@@ -291,13 +355,21 @@ XmlRpcServer::enableIntrospection(bool enabled)
 void
 XmlRpcServer::listMethods(XmlRpcValue& result)
 {
-  int i = 0;
-  result.setSize(_methods.size()+1);
+  std::vector<std::string> names;
+  names.reserve(_methods.size()+1);
   for (MethodMap::iterator it=_methods.begin(); it != _methods.end(); ++it)
-    result[i++] = it->first;
-
-  // Multicall support is built into XmlRpcServerConnection
-  result[i] = MULTICALL;
+    names.push_back(it->first);
+
+  // Multicall support is built into XmlRpcServerConnection, unless
+  // a method of that name replaces it
+  if (_methods.find(MULTICALL) == _methods.end())
+    names.push_back(MULTICALL);
+
+  // The hash table has no useful order
+  std::sort(names.begin(), names.end());
+  result.setSize(int(names.size()));
+  for (int i=0; i<int(names.size()); ++i)
+    result[i] = names[i];
 }
 
 
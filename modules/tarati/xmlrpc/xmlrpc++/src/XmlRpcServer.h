@@ -9,8 +9,8 @@
 #endif
 
 #ifndef MAKEDEPEND
-# include <map>
 # include <string>
+# include <tr1/unordered_map>
 #endif
 
 #include "XmlRpcDispatch.h"
@@ -25,6 +25,9 @@ namespace XmlRpc {
   // Class representing connections to specific clients
   class XmlRpcServerConnection;
 
+  // Listener for binary protocol clients
+  class XmlRpcBinaryListener;
+
   // Class representing argument and result values
   class XmlRpcValue;
 
@@ -33,7 +36,8 @@ namespace XmlRpc {
   class XmlRpcServer : public XmlRpcSource {
   public:
     //! Create a server object.
-    XmlRpcServer();
+    //!  @param backend How to wait for client events. \see XmlRpcDispatch::Backend
+    XmlRpcServer(XmlRpcDispatch::Backend backend = XmlRpcDispatch::SelectBackend);
     //! Destructor.
     virtual ~XmlRpcServer();
 
@@ -62,6 +66,13 @@ namespace XmlRpc {
     //! Get the port number this server is listening on.
     int getPort(void) const;
 
+    //! Also listen for clients of the binary protocol (see XmlRpcBinary)
+    //! on a second port.  Calls go to the same methods.
+    bool bindAndListenBinary(int port, int backlog = 5);
+
+    //! Get the port number of the binary protocol, or -1 if not listening.
+    int getBinaryPort(void) const;
+
     //! Process client requests for the specified time
     void work(double msTime);
 
@@ -82,14 +93,26 @@ namespace XmlRpc {
     //! Remove a connection from the dispatcher
     virtual void removeConnection(XmlRpcServerConnection*);
 
+    //! Accept a client connection request on the binary port
+    void acceptBinaryConnection();
+
   protected:
 
     //! Accept a client connection request
     virtual void acceptConnection();
 
+    //! Accept a connection on listenFd, creating a binary or XML-RPC connection
+    void acceptConnection(int listenFd, bool binary);
+
     //! Create a new connection object for processing requests from a specific client.
     virtual XmlRpcServerConnection* createConnection(int socket);
 
+    //! Same for a client of the binary protocol.
+    virtual XmlRpcServerConnection* createBinaryConnection(int socket);
+
+    //! Set up a listening socket on port for src.
+    bool listenOn(XmlRpcSource* src, int port, int backlog);
+
     // Whether the introspection API is supported by this server
     bool _introspectionEnabled;
 
@@ -99,8 +122,11 @@ namespace XmlRpc {
     // Event dispatcher
     XmlRpcDispatch _disp;
 
-    // Collection of methods. This could be a set keyed on method name if we wanted...
-    typedef std::map< std::string, XmlRpcServerMethod* > MethodMap;
+    // Listener on the binary protocol port, if any
+    XmlRpcBinaryListener* _binaryListener;
+
+    // Collection of methods, hashed on method name; every call looks one up
+    typedef std::tr1::unordered_map< std::string, XmlRpcServerMethod* > MethodMap;
     MethodMap _methods;
 
     // system methods
@@ -2,6 +2,7 @@
 #include "XmlRpcServerConnection.h"
 
 #include "XmlRpcSocket.h"
+#include "XmlRpcParser.h"
 #include "XmlRpc.h"
 #ifndef MAKEDEPEND
 # include <stdio.h>
@@ -10,6 +11,9 @@
 
 using namespace XmlRpc;
 
+// Largest buffer reserved on the strength of a Content-length header.
+static const int MAX_RESERVE = 64 * 1024;
+
 // Static data
 const char XmlRpcServerConnection::METHODNAME_TAG[] = "<methodName>";
 const char XmlRpcServerConnection::PARAMS_TAG[] = "<params>";
@@ -122,7 +126,10 @@ XmlRpcServerConnection::readHeader()
   XmlRpcUtil::log(3, "XmlRpcServerConnection::readHeader: specified content length is %d.", _contentLength);
 
   // Otherwise copy non-header data to request buffer and set state to read request.
-  _request = bp;
+  // Reserve room for the body up front, but no more than MAX_RESERVE: the
+  // length comes from the peer, so anything bigger grows as bytes arrive.
+  _request.reserve(_contentLength < MAX_RESERVE ? _contentLength : MAX_RESERVE);
+  _request.assign(bp, ep - bp);
 
   // Parse out any interesting bits from the header (HTTP version, connection)
   _keepAlive = true;
@@ -227,22 +234,24 @@ XmlRpcServerConnection::executeRequest()
 }
 
 // Parse the method name and the argument values from the request.
+// Values are decoded straight from the request buffer.
 std::string
 XmlRpcServerConnection::parseRequest(XmlRpcValue& params)
 {
-  int offset = 0;   // Number of chars parsed from the request
+  XmlRpcParser parser(_request);
 
-  std::string methodName = XmlRpcUtil::parseTag(METHODNAME_TAG, _request, &offset);
+  std::string methodName;
+  parser.parseTag(METHODNAME_TAG, methodName);
 
-  if (methodName.size() > 0 && XmlRpcUtil::findTag(PARAMS_TAG, _request, &offset))
+  if (methodName.size() > 0 && parser.findTag(PARAMS_TAG))
   {
     int nArgs = 0;
-    while (XmlRpcUtil::nextTagIs(PARAM_TAG, _request, &offset)) {
-      params[nArgs++] = XmlRpcValue(_request, &offset);
-      (void) XmlRpcUtil::nextTagIs(PARAM_ETAG, _request, &offset);
+    while (parser.nextTagIs(PARAM_TAG)) {
+      parser.parseValue(params[nArgs++]);
+      (void) parser.nextTagIs(PARAM_ETAG);
     }
 
-    (void) XmlRpcUtil::nextTagIs(PARAMS_ETAG, _request, &offset);
+    (void) parser.nextTagIs(PARAMS_ETAG);
   }
 
   return methodName;
@@ -297,7 +306,7 @@ XmlRpcServerConnection::executeMulticall(const std::string& methodName,
     resultValue.setSize(1);
     try {
       if ( ! executeMethod(methodName, methodParams, resultValue[0]) &&
-           ! executeMulticall(methodName, params, resultValue[0]))
+           ! executeMulticall(methodName, methodParams, resultValue[0]))
       {
         result[i][FAULTCODE] = -1;
         result[i][FAULTSTRING] = methodName + ": unknown method name";
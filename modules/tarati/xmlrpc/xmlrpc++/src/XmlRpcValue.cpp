@@ -1,6 +1,7 @@
 
 #include "XmlRpcValue.h"
 #include "XmlRpcException.h"
+#include "XmlRpcParser.h"
 #include "XmlRpcUtil.h"
 #include "base64.h"
 
@@ -21,7 +22,6 @@ namespace XmlRpc {
   static const char BOOLEAN_ETAG[]  = "</boolean>";
   static const char DOUBLE_TAG[]    = "<double>";
   static const char DOUBLE_ETAG[]   = "</double>";
-  static const char INT_TAG[]       = "<int>";
   static const char I4_TAG[]        = "<i4>";
   static const char I4_ETAG[]       = "</i4>";
   static const char STRING_TAG[]    = "<string>";
@@ -213,190 +213,89 @@ namespace XmlRpc {
   // should be the start of a <value> tag. Destroys any existing value.
   bool XmlRpcValue::fromXml(std::string const& valueXml, int* offset)
   {
-    int savedOffset = *offset;
-
-    invalidate();
-    if ( ! XmlRpcUtil::nextTagIs(VALUE_TAG, valueXml, offset))
+    XmlRpcParser parser(valueXml, *offset);
+    if ( ! parser.parseValue(*this))
       return false;       // Not a value, offset not updated
 
-	int afterValueOffset = *offset;
-    std::string typeTag = XmlRpcUtil::getNextTag(valueXml, offset);
-    bool result = false;
-    if (typeTag == BOOLEAN_TAG)
-      result = boolFromXml(valueXml, offset);
-    else if (typeTag == I4_TAG || typeTag == INT_TAG)
-      result = intFromXml(valueXml, offset);
-    else if (typeTag == DOUBLE_TAG)
-      result = doubleFromXml(valueXml, offset);
-    else if (typeTag.empty() || typeTag == STRING_TAG)
-      result = stringFromXml(valueXml, offset);
-    else if (typeTag == DATETIME_TAG)
-      result = timeFromXml(valueXml, offset);
-    else if (typeTag == BASE64_TAG)
-      result = binaryFromXml(valueXml, offset);
-    else if (typeTag == ARRAY_TAG)
-      result = arrayFromXml(valueXml, offset);
-    else if (typeTag == STRUCT_TAG)
-      result = structFromXml(valueXml, offset);
-    // Watch for empty/blank strings with no <string>tag
-    else if (typeTag == VALUE_ETAG)
-    {
-      *offset = afterValueOffset;   // back up & try again
-      result = stringFromXml(valueXml, offset);
-    }
-
-    if (result)  // Skip over the </value> tag
-      XmlRpcUtil::findTag(VALUE_ETAG, valueXml, offset);
-    else        // Unrecognized tag after <value>
-      *offset = savedOffset;
-
-    return result;
+    *offset = parser.getOffset();
+    return true;
   }
 
   // Encode the Value in xml
   std::string XmlRpcValue::toXml() const
+  {
+    std::string xml;
+    toXml(xml);
+    return xml;
+  }
+
+  // Append the Value in xml; nested values are encoded straight into
+  // the same string
+  void XmlRpcValue::toXml(std::string& xml) const
   {
     switch (_type) {
-      case TypeBoolean:  return boolToXml();
-      case TypeInt:      return intToXml();
-      case TypeDouble:   return doubleToXml();
-      case TypeString:   return stringToXml();
-      case TypeDateTime: return timeToXml();
-      case TypeBase64:   return binaryToXml();
-      case TypeArray:    return arrayToXml();
-      case TypeStruct:   return structToXml();
-      default: break;
+      case TypeBoolean:  boolToXml(xml); break;
+      case TypeInt:      intToXml(xml); break;
+      case TypeDouble:   doubleToXml(xml); break;
+      case TypeString:   stringToXml(xml); break;
+      case TypeDateTime: timeToXml(xml); break;
+      case TypeBase64:   binaryToXml(xml); break;
+      case TypeArray:    arrayToXml(xml); break;
+      case TypeStruct:   structToXml(xml); break;
+      default: break;     // Invalid value
     }
-    return std::string();   // Invalid value
   }
 
 
   // Boolean
-  bool XmlRpcValue::boolFromXml(std::string const& valueXml, int* offset)
+  void XmlRpcValue::boolToXml(std::string& xml) const
   {
-    const char* valueStart = valueXml.c_str() + *offset;
-    char* valueEnd;
-    long ivalue = strtol(valueStart, &valueEnd, 10);
-    if (valueEnd == valueStart || (ivalue != 0 && ivalue != 1))
-      return false;
-
-    _type = TypeBoolean;
-    _value.asBool = (ivalue == 1);
-    *offset += int(valueEnd - valueStart);
-    return true;
-  }
-
-  std::string XmlRpcValue::boolToXml() const
-  {
-    std::string xml = VALUE_TAG;
+    xml += VALUE_TAG;
     xml += BOOLEAN_TAG;
     xml += (_value.asBool ? "1" : "0");
     xml += BOOLEAN_ETAG;
     xml += VALUE_ETAG;
-    return xml;
   }
 
   // Int
-  bool XmlRpcValue::intFromXml(std::string const& valueXml, int* offset)
-  {
-    const char* valueStart = valueXml.c_str() + *offset;
-    char* valueEnd;
-    long ivalue = strtol(valueStart, &valueEnd, 10);
-    if (valueEnd == valueStart)
-      return false;
-
-    _type = TypeInt;
-    _value.asInt = int(ivalue);
-    *offset += int(valueEnd - valueStart);
-    return true;
-  }
-
-  std::string XmlRpcValue::intToXml() const
+  void XmlRpcValue::intToXml(std::string& xml) const
   {
     char buf[256];
     snprintf(buf, sizeof(buf)-1, "%d", _value.asInt);
     buf[sizeof(buf)-1] = 0;
-    std::string xml = VALUE_TAG;
+    xml += VALUE_TAG;
     xml += I4_TAG;
     xml += buf;
     xml += I4_ETAG;
     xml += VALUE_ETAG;
-    return xml;
   }
 
   // Double
-  bool XmlRpcValue::doubleFromXml(std::string const& valueXml, int* offset)
-  {
-    const char* valueStart = valueXml.c_str() + *offset;
-    char* valueEnd;
-    double dvalue = strtod(valueStart, &valueEnd);
-    if (valueEnd == valueStart)
-      return false;
-
-    _type = TypeDouble;
-    _value.asDouble = dvalue;
-    *offset += int(valueEnd - valueStart);
-    return true;
-  }
-
-  std::string XmlRpcValue::doubleToXml() const
+  void XmlRpcValue::doubleToXml(std::string& xml) const
   {
     char buf[256];
     snprintf(buf, sizeof(buf)-1, getDoubleFormat().c_str(), _value.asDouble);
     buf[sizeof(buf)-1] = 0;
 
-    std::string xml = VALUE_TAG;
+    xml += VALUE_TAG;
     xml += DOUBLE_TAG;
     xml += buf;
     xml += DOUBLE_ETAG;
     xml += VALUE_ETAG;
-    return xml;
   }
 
   // String
-  bool XmlRpcValue::stringFromXml(std::string const& valueXml, int* offset)
-  {
-    size_t valueEnd = valueXml.find('<', *offset);
-    if (valueEnd == std::string::npos)
-      return false;     // No end tag;
-
-    _type = TypeString;
-    _value.asString = new std::string(XmlRpcUtil::xmlDecode(valueXml.substr(*offset, valueEnd-*offset)));
-    *offset += int(_value.asString->length());
-    return true;
-  }
-
-  std::string XmlRpcValue::stringToXml() const
+  void XmlRpcValue::stringToXml(std::string& xml) const
   {
-    std::string xml = VALUE_TAG;
+    xml += VALUE_TAG;
     //xml += STRING_TAG; optional
     xml += XmlRpcUtil::xmlEncode(*_value.asString);
     //xml += STRING_ETAG;
     xml += VALUE_ETAG;
-    return xml;
   }
 
   // DateTime (stored as a struct tm)
-  bool XmlRpcValue::timeFromXml(std::string const& valueXml, int* offset)
-  {
-    size_t valueEnd = valueXml.find('<', *offset);
-    if (valueEnd == std::string::npos)
-      return false;     // No end tag;
-
-    std::string stime = valueXml.substr(*offset, valueEnd-*offset);
-
-    struct tm t;
-    if (sscanf(stime.c_str(),"%4d%2d%2dT%2d:%2d:%2d",&t.tm_year,&t.tm_mon,&t.tm_mday,&t.tm_hour,&t.tm_min,&t.tm_sec) != 6)
-      return false;
-
-    t.tm_isdst = -1;
-    _type = TypeDateTime;
-    _value.asTime = new struct tm(t);
-    *offset += int(stime.length());
-    return true;
-  }
-
-  std::string XmlRpcValue::timeToXml() const
+  void XmlRpcValue::timeToXml(std::string& xml) const
   {
     struct tm* t = _value.asTime;
     char buf[20];
@@ -404,39 +303,17 @@ namespace XmlRpc {
       t->tm_year,t->tm_mon,t->tm_mday,t->tm_hour,t->tm_min,t->tm_sec);
     buf[sizeof(buf)-1] = 0;
 
-    std::string xml = VALUE_TAG;
+    xml += VALUE_TAG;
     xml += DATETIME_TAG;
     xml += buf;
     xml += DATETIME_ETAG;
     xml += VALUE_ETAG;
-    return xml;
   }
 
 
   // Base64
-  bool XmlRpcValue::binaryFromXml(std::string const& valueXml, int* offset)
-  {
-    size_t valueEnd = valueXml.find('<', *offset);
-    if (valueEnd == std::string::npos)
-      return false;     // No end tag;
-
-    _type = TypeBase64;
-    std::string asString = valueXml.substr(*offset, valueEnd-*offset);
-    _value.asBinary = new BinaryData();
-    // check whether base64 encodings can contain chars xml encodes...
-
-    // convert from base64 to binary
-    int iostatus = 0;
-	  base64<char> decoder;
-    std::back_insert_iterator<BinaryData> ins = std::back_inserter(*(_value.asBinary));
-		decoder.get(asString.begin(), asString.end(), ins, iostatus);
-
-    *offset += int(asString.length());
-    return true;
-  }
 
-
-  std::string XmlRpcValue::binaryToXml() const
+  void XmlRpcValue::binaryToXml(std::string& xml) const
   {
     // convert to base64
     std::vector<char> base64data;
@@ -446,81 +323,41 @@ namespace XmlRpc {
 		encoder.put(_value.asBinary->begin(), _value.asBinary->end(), ins, iostatus, base64<>::crlf());
 
     // Wrap with xml
-    std::string xml = VALUE_TAG;
+    xml += VALUE_TAG;
     xml += BASE64_TAG;
     xml.append(base64data.begin(), base64data.end());
     xml += BASE64_ETAG;
     xml += VALUE_ETAG;
-    return xml;
   }
 
 
   // Array
-  bool XmlRpcValue::arrayFromXml(std::string const& valueXml, int* offset)
-  {
-    if ( ! XmlRpcUtil::nextTagIs(DATA_TAG, valueXml, offset))
-      return false;
-
-    _type = TypeArray;
-    _value.asArray = new ValueArray;
-    XmlRpcValue v;
-    while (v.fromXml(valueXml, offset))
-      _value.asArray->push_back(v);       // copy...
-
-    // Skip the trailing </data>
-    (void) XmlRpcUtil::nextTagIs(DATA_ETAG, valueXml, offset);
-    return true;
-  }
-
 
   // In general, its preferable to generate the xml of each element of the
   // array as it is needed rather than glomming up one big string.
-  std::string XmlRpcValue::arrayToXml() const
+  void XmlRpcValue::arrayToXml(std::string& xml) const
   {
-    std::string xml = VALUE_TAG;
+    xml += VALUE_TAG;
     xml += ARRAY_TAG;
     xml += DATA_TAG;
 
     int s = int(_value.asArray->size());
     for (int i=0; i<s; ++i)
-       xml += _value.asArray->at(i).toXml();
+       _value.asArray->at(i).toXml(xml);
 
     xml += DATA_ETAG;
     xml += ARRAY_ETAG;
     xml += VALUE_ETAG;
-    return xml;
   }
 
 
   // Struct
-  bool XmlRpcValue::structFromXml(std::string const& valueXml, int* offset)
-  {
-    _type = TypeStruct;
-    _value.asStruct = new ValueStruct;
-
-    while (XmlRpcUtil::nextTagIs(MEMBER_TAG, valueXml, offset)) {
-      // name
-      const std::string name = XmlRpcUtil::parseTag(NAME_TAG, valueXml, offset);
-      // value
-      XmlRpcValue val(valueXml, offset);
-      if ( ! val.valid()) {
-        invalidate();
-        return false;
-      }
-      const std::pair<const std::string, XmlRpcValue> p(name, val);
-      _value.asStruct->insert(p);
-
-      (void) XmlRpcUtil::nextTagIs(MEMBER_ETAG, valueXml, offset);
-    }
-    return true;
-  }
-
 
   // In general, its preferable to generate the xml of each element
   // as it is needed rather than glomming up one big string.
-  std::string XmlRpcValue::structToXml() const
+  void XmlRpcValue::structToXml(std::string& xml) const
   {
-    std::string xml = VALUE_TAG;
+    xml += VALUE_TAG;
     xml += STRUCT_TAG;
 
     ValueStruct::const_iterator it;
@@ -529,13 +366,12 @@ namespace XmlRpc {
       xml += NAME_TAG;
       xml += XmlRpcUtil::xmlEncode(it->first);
       xml += NAME_ETAG;
-      xml += it->second.toXml();
+      it->second.toXml(xml);
       xml += MEMBER_ETAG;
     }
 
     xml += STRUCT_ETAG;
     xml += VALUE_ETAG;
-    return xml;
   }
 
 
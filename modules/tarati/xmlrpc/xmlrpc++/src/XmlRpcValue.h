@@ -17,9 +17,14 @@
 
 namespace XmlRpc {
 
+  class XmlRpcParser;
+  class XmlRpcBinary;
+
   //! RPC method arguments and results are represented by Values
   //   should probably refcount them...
   class XmlRpcValue {
+    friend class XmlRpcParser;
+    friend class XmlRpcBinary;
   public:
 
 
@@ -75,6 +80,13 @@ namespace XmlRpc {
     //! Erase the current value
     void clear() { invalidate(); }
 
+    //! Exchange contents with another value (no copying)
+    void swap(XmlRpcValue& other)
+    {
+      Type t = _type; _type = other._type; other._type = t;
+      Value v = _value; _value = other._value; other._value = v;
+    }
+
     // Operators
     XmlRpcValue& operator=(XmlRpcValue const& rhs);
     XmlRpcValue& operator=(int const& rhs) { return operator=(XmlRpcValue(rhs)); }
@@ -119,6 +131,9 @@ namespace XmlRpc {
     //! Encode the Value in xml
     std::string toXml() const;
 
+    //! Append the xml encoding of the Value to xml
+    void toXml(std::string& xml) const;
+
     //! Write the value (no xml encoding)
     std::ostream& write(std::ostream& os) const;
 
@@ -140,25 +155,17 @@ namespace XmlRpc {
     void assertArray(int size);
     void assertStruct();
 
-    // XML decoding
-    bool boolFromXml(std::string const& valueXml, int* offset);
-    bool intFromXml(std::string const& valueXml, int* offset);
-    bool doubleFromXml(std::string const& valueXml, int* offset);
-    bool stringFromXml(std::string const& valueXml, int* offset);
-    bool timeFromXml(std::string const& valueXml, int* offset);
-    bool binaryFromXml(std::string const& valueXml, int* offset);
-    bool arrayFromXml(std::string const& valueXml, int* offset);
-    bool structFromXml(std::string const& valueXml, int* offset);
-
-    // XML encoding
-    std::string boolToXml() const;
-    std::string intToXml() const;
-    std::string doubleToXml() const;
-    std::string stringToXml() const;
-    std::string timeToXml() const;
-    std::string binaryToXml() const;
-    std::string arrayToXml() const;
-    std::string structToXml() const;
+    // XML decoding is done by XmlRpcParser
+
+    // XML encoding (appends to xml)
+    void boolToXml(std::string& xml) const;
+    void intToXml(std::string& xml) const;
+    void doubleToXml(std::string& xml) const;
+    void stringToXml(std::string& xml) const;
+    void timeToXml(std::string& xml) const;
+    void binaryToXml(std::string& xml) const;
+    void arrayToXml(std::string& xml) const;
+    void structToXml(std::string& xml) const;
 
     // Format strings
     static std::string _doubleFormat;
@@ -168,7 +175,7 @@ namespace XmlRpc {
 
     // At some point I will split off Arrays and Structs into
     // separate ref-counted objects for more efficient copying.
-    union {
+    union Value {
       bool          asBool;
       int           asInt;
       double        asDouble;
@@ -0,0 +1,213 @@
+/*
+ *Copyright (C) 2003-2006 Intel Corporation
+ *
+ *This program is free software; you can redistribute it and/or
+ *modify it under the terms of the GNU General Public License
+ *as published by the Free Software Foundation; either version 2
+ *of the License, or (at your option) any later version.
+ *
+ *This program is distributed in the hope that it will be useful,
+ *but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *GNU General Public License for more details.
+ *
+ *You should have received a copy of the GNU General Public License
+ *along with this program; if not, write to the Free Software
+ *Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+// LoadTest.cpp : Many monitoring clients polling one server.
+//
+// Usage: LoadTest [select|epoll|binary] [nClients] [nRounds] [nProcs]
+//
+// The server runs in a child process.  nProcs client processes each
+// keep nClients/nProcs connections open and, in every round, make one
+// call on each of them, so the server always watches nClients
+// connections with up to nProcs requests in flight.  Prints the call
+// rate; exits non-zero if any call failed.  binary makes the same calls
+// over the binary framing protocol (select dispatcher).
+//
+#include "XmlRpc.h"
+#include "XmlRpcSocket.h"
+
+#include <iostream>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+using namespace XmlRpc;
+
+
+// Returns a small struct, like a Tarati stats query would.
+class Stats : public XmlRpcServerMethod
+{
+public:
+  Stats(XmlRpcServer* s) : XmlRpcServerMethod("Stats", s), _calls(0) {}
+
+  void execute(XmlRpcValue& params, XmlRpcValue& result)
+  {
+    ++_calls;
+    result["cycle"] = _calls;
+    result["name"] = std::string(params[0]);
+    result["ipc"] = 1.25;
+  }
+
+private:
+  int _calls;
+};
+
+
+static double
+now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+
+// Same, over the binary protocol.
+static int
+runBinaryClients(int port, int nClients, int nRounds)
+{
+  std::string host("localhost");
+  std::vector<int> fds;
+  for (int i=0; i<nClients; ++i) {
+    int fd = XmlRpcSocket::socket();
+    if (fd < 0 || ! XmlRpcSocket::connect(fd, host, port))
+      return nClients * nRounds;
+    fds.push_back(fd);
+  }
+
+  XmlRpcValue args, result;
+  args[0] = "core0";
+  std::string call, reply;
+  XmlRpcBinary::encodeCall("Stats", args, call);
+
+  int failed = 0;
+  for (int r=0; r<nRounds; ++r)
+    for (int i=0; i<nClients; ++i) {
+      bool isFault;
+      if ( ! XmlRpcBinary::writeFrame(fds[i], call) ||
+           ! XmlRpcBinary::readFrame(fds[i], reply) ||
+           ! XmlRpcBinary::decodeResponse(reply.data(), reply.data() + reply.size(), result, isFault) ||
+           isFault ||
+           std::string(result["name"]) != "core0")
+        ++failed;
+    }
+
+  for (int i=0; i<nClients; ++i)
+    XmlRpcSocket::close(fds[i]);
+
+  return failed;
+}
+
+
+// Poll the server nRounds times over nClients persistent connections.
+// Returns the number of failed calls.
+static int
+runClients(int port, int nClients, int nRounds)
+{
+  std::vector<XmlRpcClient*> clients;
+  for (int i=0; i<nClients; ++i)
+    clients.push_back(new XmlRpcClient("localhost", port));
+
+  XmlRpcValue args, result;
+  args[0] = "core0";
+
+  int failed = 0;
+  for (int r=0; r<nRounds; ++r)
+    for (int i=0; i<nClients; ++i)
+      if ( ! clients[i]->execute("Stats", args, result) ||
+           clients[i]->isFault() ||
+           std::string(result["name"]) != "core0")
+        ++failed;
+
+  for (int i=0; i<nClients; ++i)
+    delete clients[i];
+
+  return failed;
+}
+
+
+int main(int argc, char* argv[])
+{
+  XmlRpcDispatch::Backend backend = XmlRpcDispatch::SelectBackend;
+  bool binary = false;
+  if (argc > 1 && strcmp(argv[1], "epoll") == 0)
+    backend = XmlRpcDispatch::EpollBackend;
+  else if (argc > 1 && strcmp(argv[1], "binary") == 0)
+    binary = true;
+  else if (argc > 1 && strcmp(argv[1], "select") != 0) {
+    std::cerr << "Usage: LoadTest [select|epoll|binary] [nClients] [nRounds] [nProcs]\n";
+    return -1;
+  }
+  int nClients = (argc > 2) ? atoi(argv[2]) : 400;
+  int nRounds  = (argc > 3) ? atoi(argv[3]) : 50;
+  int nProcs   = (argc > 4) ? atoi(argv[4]) : 4;
+  if (nProcs < 1) nProcs = 1;
+
+  // The server needs one descriptor per client
+  struct rlimit rl;
+  if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+  }
+
+  XmlRpcServer s(backend);
+  Stats stats(&s);
+  if ( ! s.bindAndListen(0, 128) ||
+       (binary && ! s.bindAndListenBinary(0, 128))) {
+    std::cerr << "LoadTest: could not create server socket\n";
+    return -1;
+  }
+  int port = binary ? s.getBinaryPort() : s.getPort();
+
+  pid_t server = fork();
+  if (server == 0) {
+    s.work(-1.0);
+    _exit(0);
+  }
+
+  double start = now();
+
+  std::vector<pid_t> workers;
+  for (int p=0; p<nProcs; ++p) {
+    int n = nClients / nProcs + (p < nClients % nProcs ? 1 : 0);
+    pid_t pid = fork();
+    if (pid == 0)
+      _exit((binary ? runBinaryClients(port, n, nRounds)
+                    : runClients(port, n, nRounds)) ? 1 : 0);
+    workers.push_back(pid);
+  }
+
+  int failedProcs = 0;
+  for (size_t p=0; p<workers.size(); ++p) {
+    int status;
+    waitpid(workers[p], &status, 0);
+    if ( ! WIFEXITED(status) || WEXITSTATUS(status) != 0)
+      ++failedProcs;
+  }
+
+  double elapsed = now() - start;
+
+  kill(server, SIGTERM);
+  waitpid(server, NULL, 0);
+
+  long calls = (long) nClients * nRounds;
+  std::cout << (binary ? "binary" :
+                backend == XmlRpcDispatch::EpollBackend ? "epoll" : "select")
+            << ": " << nClients << " clients, " << calls << " calls in "
+            << elapsed << "s, " << (calls / elapsed) << " calls/s\n";
+
+  if (failedProcs) {
+    std::cerr << "LoadTest: " << failedProcs << " client process(es) saw failed calls\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,136 @@
+/*
+ *Copyright (C) 2003-2006 Intel Corporation
+ *
+ *This program is free software; you can redistribute it and/or
+ *modify it under the terms of the GNU General Public License
+ *as published by the Free Software Foundation; either version 2
+ *of the License, or (at your option) any later version.
+ *
+ *This program is distributed in the hope that it will be useful,
+ *but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *GNU General Public License for more details.
+ *
+ *You should have received a copy of the GNU General Public License
+ *along with this program; if not, write to the Free Software
+ *Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+// ParseBench.cpp : Time XML decoding and encoding of XmlRpcValues.
+//
+// Usage: ParseBench [nStates]
+//
+// Uses the payloads of TestValues and TestXml, plus a bulk stats reply
+// (an array of nStates structs, default 20000) like the ones Tarati
+// returns.  Each payload is checked to survive an encode/decode round
+// trip before it is timed.
+//
+#include "XmlRpcValue.h"
+
+#include <iostream>
+#include <string>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+using namespace XmlRpc;
+
+
+static double
+now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+
+// Decode and encode xml until about a second has passed
+static void
+bench(const char* name, std::string const& xml)
+{
+  int offset = 0;
+  XmlRpcValue v(xml, &offset);
+  assert(v.valid());
+  offset = 0;
+  assert(XmlRpcValue(v.toXml(), &offset) == v);
+
+  int n = 0;
+  double start = now(), elapsed;
+  do {
+    for (int i=0; i<16; ++i) {
+      offset = 0;
+      XmlRpcValue parsed(xml, &offset);
+    }
+    n += 16;
+  } while ((elapsed = now() - start) < 1.0);
+  double decodeUs = 1000000.0 * elapsed / n;
+
+  n = 0;
+  start = now();
+  do {
+    for (int i=0; i<16; ++i)
+      std::string encoded = v.toXml();
+    n += 16;
+  } while ((elapsed = now() - start) < 1.0);
+  double encodeUs = 1000000.0 * elapsed / n;
+
+  printf("%-12s %9d bytes  decode %10.2f us %8.1f MB/s  encode %10.2f us\n",
+         name, int(xml.size()), decodeUs, xml.size() / decodeUs, encodeUs);
+}
+
+
+int main(int argc, char* argv[])
+{
+  int nStates = (argc > 1) ? atoi(argv[1]) : 20000;
+
+  // From TestValues
+  std::string array =
+    "<value><array>\n"
+    "  <data>\n"
+    "    <value><i4>1</i4></value> \n"
+    "    <value> <string>two</string></value>\n"
+    "    <value><double>43.7</double></value>\n"
+    "    <value>four</value>\n"
+    "  </data>\n"
+    "</array></value>";
+
+  std::string structure =
+    "<value><struct>\n"
+    "  <member>\n"
+    "    <name>i4</name> \n"
+    "    <value><i4>1</i4></value> \n"
+    "  </member>\n"
+    "  <member>\n"
+    "    <name>d</name> \n"
+    "    <value><double>43.7</double></value>\n"
+    "  </member>\n"
+    "  <member>\n"
+    "    <name>str</name> \n"
+    "    <value> <string>two</string></value>\n"
+    "  </member>\n"
+    "</struct></value>";
+
+  // From TestXml: text that has to be entity encoded
+  XmlRpcValue text(std::string("Now is the time <&'\" for all good men <>&'\""));
+
+  // A bulk stats query reply
+  XmlRpcValue stats;
+  stats.setSize(nStates);
+  for (int i=0; i<nStates; ++i) {
+    char name[40];
+    sprintf(name, "cpu0/core/pipe%d", i);
+    stats[i]["name"] = name;
+    stats[i]["type"] = "uint";
+    stats[i]["value"] = i * 7;
+    stats[i]["ipc"] = 0.5 + i;
+  }
+
+  bench("array", array);
+  bench("struct", structure);
+  bench("text", text.toXml());
+  bench("stats", stats.toXml());
+
+  return 0;
+}
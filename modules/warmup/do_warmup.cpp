@@ -21,14 +21,46 @@
  *Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
+// generic
+#include <stdio.h>
+#include <sstream>
+
+// ASIM core
+#include "asim/mesg.h"
+
 // ASIM public modules
 #include "asim/provides/warmup_manager.h"
 
+#include "warmup_trace.h"
+#include "warmup_producer.h"
+
 void
 WARMUP_MANAGER_CLASS::DoWarmUp(void)
 {
     T1("Warmup:  Enter"); 
 
+    UINT32 batchRounds = (WARMUP_BATCH > 0) ? WARMUP_BATCH : 1;
+    ParseWarmUpRanges();
+
+    //
+    // Warm-up from a cached trace of this region if there is one,
+    // otherwise record one while running the feeder.
+    //
+    WARMUP_TRACE_READER traceIn = NULL;
+    string traceKey;
+    string traceName = WarmUpTraceName(batchRounds, traceKey);
+    if (traceName != "")
+    {
+        traceIn = WARMUP_TRACE_READER_CLASS::Open(traceName, traceKey,
+                                                  hwcs.size());
+        if (traceIn == NULL)
+        {
+            traceOut = WARMUP_TRACE_WRITER_CLASS::Create(traceName, traceKey,
+                                                         hwcs.size(),
+                                                         MinIFetchLineBytes());
+        }
+    }
+
     //
     // Start by telling all HWCs what information has been requested.
     // An intelligent feeder can then limit the information returned
@@ -42,9 +74,9 @@ WARMUP_MANAGER_CLASS::DoWarmUp(void)
                                     nIFetchCallbacks != 0,
                                     nInstrCallbacks != 0);
 
-    if (! ENABLE_WARMUP)
+    if (! ENABLE_WARMUP || (traceIn != NULL))
     {
-        // Warm-up is disabled.
+        // Warm-up is disabled or comes from the trace.
         clientInfo = WARMUP_CLIENTS_CLASS(false, false, false);
     }
 
@@ -58,117 +90,596 @@ WARMUP_MANAGER_CLASS::DoWarmUp(void)
 
     CallPhaseCallbacks(WARMUP_CALLBACK_CLASS::WARMUP_START);
 
+    if (traceIn != NULL)
+    {
+        T1("Warmup:  Replay " << traceName);
+        ReplayWarmUp(traceIn);
+        delete traceIn;
+    }
+
     //
     // Keep fetching warm-up info from feeder until no more is available.
+    // Each round asks every HWC for one instruction.  Up to WARMUP_BATCH
+    // rounds are collected before the records are passed to the clients,
+    // so clients are called once per batch instead of once per record.
+    // Within a batch clients see all control records, then all fetches,
+    // then all data references, with the ticks after them; only the
+    // default of 1 keeps each instruction's records interleaved.
     //
-    bool warmUpMore = true;
-    while (warmUpMore)
+    // After a replay the feeder still has to be moved past the warm-up
+    // region, unless WARMUP_TRACE_SKIP_FEEDER says it need not be.
+    //
+    // With WARMUP_PARALLEL the feeders run ahead on worker threads,
+    // one per HWC, and the records are taken from them in the same order.
+    //
+    bool replayed = (traceIn != NULL);
+    bool warmUpMore = ! (replayed && WARMUP_TRACE_SKIP_FEEDER);
+
+    vector<WARMUP_PRODUCER> producers;
+    if (warmUpMore && WARMUP_PARALLEL && (hwcs.size() > 1))
     {
-        warmUpMore = false;
+        UINT32 queueSize = (batchRounds > 8) ? 2 * batchRounds : 16;
         for (WARMUP_HWC_LIST::iterator whwc = hwcs.begin();
              whwc != hwcs.end();
              whwc++)
         {
-            HW_CONTEXT hwc = (*whwc)->hwc;
-            WARMUP_INFO_CLASS wInfo;
+            producers.push_back(new WARMUP_PRODUCER_CLASS((*whwc)->hwc,
+                                                          queueSize));
+        }
+    }
 
-            if (hwc->WarmUp(&wInfo))
-            {
-                if (ENABLE_WARMUP)
-                {
-                    //
-                    // Got warm-up info from the feeder...
-                    //
-                    bool hadData = false;
+    // Reused for every call, so its reference storage is kept
+    WARMUP_INFO_CLASS localInfo;
 
-                    // Is it a control transfer instruction?
-                    if (wInfo.IsCtrlTransfer())
-                    {
-                        (*whwc)->nCtrlInits += 1;
-                        WARMUP_INSTR_CLASS wInstr(wInfo.GetAsimInst());
+    while (warmUpMore)
+    {
+        UINT32 nRounds = 0;
+        while (warmUpMore && (nRounds < batchRounds))
+        {
+            warmUpMore = false;
+            for (WARMUP_HWC_LIST::iterator whwc = hwcs.begin();
+                 whwc != hwcs.end();
+                 whwc++)
+            {
+                WARMUP_INFO wInfo = &localInfo;
+                bool got;
 
-                        CallInstrCallbacks(globalInstrCallbacks, hwc, &wInstr);
-                        CallInstrCallbacks((*whwc)->instrCallbacks, hwc, &wInstr);
+                if (producers.empty())
+                {
+                    got = (*whwc)->hwc->WarmUp(wInfo);
+                }
+                else
+                {
+                    got = producers[(*whwc)->index]->Next(wInfo);
+                }
 
-                        hadData = true;
-                    }
+                if (wInfo->IsAsimInstValid())
+                {
+                    (*whwc)->nInstAllocs += 1;
+                }
 
-                    if (wInfo.IsIFetch())
+                if (got)
+                {
+                    if (ENABLE_WARMUP && ! replayed)
                     {
-                        (*whwc)->nIFetchInits += 1;
-                        WARMUP_IFETCH_CLASS wIFetch(wInfo.GetIFetchVA(),
-                                                    wInfo.GetIFetchPA());
+                        BatchWarmUp(*whwc, *wInfo);
+                    }
 
-                        CallIFetchCallbacks(globalIFetchCallbacks, hwc, &wIFetch);
-                        CallIFetchCallbacks((*whwc)->ifetchCallbacks, hwc, &wIFetch);
+                    warmUpMore = true;
+                }
 
-                        hadData = true;
-                    }
+                if (producers.empty())
+                {
+                    localInfo.Reset();
+                }
+                else
+                {
+                    producers[(*whwc)->index]->Release();
+                    (*whwc)->idle = ! got;
+                }
+            }
 
-                    // Is it a data reference?
-                    for (UINT32 i = 0; i < wInfo.NLoads(); i++)
-                    {
-                        (*whwc)->nDataInits += 1;
-                        WARMUP_DATA_CLASS wData(true,
-                                                wInfo.GetLoadVA(i),
-                                                wInfo.GetLoadPA(i),
-                                                wInfo.GetLoadBytes(i));
-                        if (wInfo.IsAsimInstValid())
-                        {
-                            wData.SetAsimInst(wInfo.GetAsimInst());
-                        }
-                        if (wInfo.IsIFetch())
-                        {
-                            wData.SetInstrAddr(wInfo.GetIFetchVA(),
-                                               wInfo.GetIFetchPA());
-                        }
-
-                        CallDataCallbacks(globalDataCallbacks, hwc, &wData);
-                        CallDataCallbacks((*whwc)->dataCallbacks, hwc, &wData);
-
-                        hadData = true;
-                    }
+            //
+            // Workers of contexts that had nothing this round wait to
+            // learn whether there is another round.
+            //
+            for (WARMUP_HWC_LIST::iterator whwc = hwcs.begin();
+                 whwc != hwcs.end() && ! producers.empty();
+                 whwc++)
+            {
+                if ((*whwc)->idle)
+                {
+                    producers[(*whwc)->index]->Continue(warmUpMore);
+                }
+            }
 
-                    for (UINT32 i = 0; i < wInfo.NStores(); i++)
-                    {
-                        (*whwc)->nDataInits += 1;
-                        WARMUP_DATA_CLASS wData(false,
-                                                wInfo.GetStoreVA(i),
-                                                wInfo.GetStorePA(i),
-                                                wInfo.GetStoreBytes(i));
-                        if (wInfo.IsAsimInstValid())
-                        {
-                            wData.SetAsimInst(wInfo.GetAsimInst());
-                        }
-                        if (wInfo.IsIFetch())
-                        {
-                            wData.SetInstrAddr(wInfo.GetIFetchVA(),
-                                               wInfo.GetIFetchPA());
-                        }
-
-                        CallDataCallbacks(globalDataCallbacks, hwc, &wData);
-                        CallDataCallbacks((*whwc)->dataCallbacks, hwc, &wData);
-
-                        hadData = true;
-                    }
+            if (warmUpMore)
+            {
+                nRounds += 1;
+            }
+        }
 
-                    if (! hadData)
-                    {
-                        (*whwc)->nEmptyInits += 1;
-                    }
+        if (ENABLE_WARMUP && ! replayed)
+        {
+            //
+            // With WARMUP_LAST_INSTRS records are held back until the
+            // end, since only then is it known which are the last ones.
+            // Older ones are dropped once twice as many are held.
+            //
+            for (WARMUP_HWC_LIST::iterator whwc = hwcs.begin();
+                 whwc != hwcs.end();
+                 whwc++)
+            {
+                if (WARMUP_LAST_INSTRS == 0)
+                {
+                    FlushWarmUp(*whwc);
+                }
+                else if ((*whwc)->heldRecords.size() >= 2 * UINT64(WARMUP_LAST_INSTRS))
+                {
+                    TrimWarmUp(*whwc, WARMUP_LAST_INSTRS);
                 }
-                
-                warmUpMore = true;
+            }
+
+            // One tick per round, as if the batch had not been collected
+            for (UINT32 i = 0; i < nRounds; i++)
+            {
+                CallTickCallbacks();
+            }
+
+            if (traceOut && nRounds)
+            {
+                traceOut->Ticks(nRounds);
             }
         }
+    }
+
+    for (UINT32 i = 0; i < producers.size(); i++)
+    {
+        delete producers[i];
+    }
 
-        if (warmUpMore && ENABLE_WARMUP)
+    if (ENABLE_WARMUP && ! replayed && WARMUP_LAST_INSTRS)
+    {
+        for (WARMUP_HWC_LIST::iterator whwc = hwcs.begin();
+             whwc != hwcs.end();
+             whwc++)
         {
-            CallTickCallbacks();
+            TrimWarmUp(*whwc, WARMUP_LAST_INSTRS);
+            (*whwc)->heldRecords.clear();
+            FlushWarmUp(*whwc);
         }
     }
 
+    if (traceOut)
+    {
+        vector<UINT64> counters;
+        GetWarmUpCounters(counters);
+        traceOut->Finish(counters, N_WARMUP_COUNTERS);
+
+        delete traceOut;
+        traceOut = NULL;
+    }
+
     CallPhaseCallbacks(WARMUP_CALLBACK_CLASS::WARMUP_END);
 
     T1("Warmup:  Exit"); 
 }
+
+
+//
+// Attach the instruction behind a data reference, if the feeder gave it.
+//
+static inline void
+NoteDataSource(
+    WARMUP_DATA wData,
+    const WARMUP_INFO_CLASS& wInfo)
+{
+    if (wInfo.IsAsimInstValid())
+    {
+        wData->SetAsimInst(wInfo.GetAsimInst());
+    }
+    if (wInfo.IsIFetch())
+    {
+        wData->SetInstrAddr(wInfo.GetIFetchVA(),
+                            wInfo.GetIFetchPA());
+    }
+}
+
+
+void
+WARMUP_MANAGER_CLASS::BatchWarmUp(
+    WARMUP_HWC whwc,
+    const WARMUP_INFO_CLASS& wInfo)
+{
+    bool hadData = false;
+    UINT32 nInstr = whwc->instrBatch.size();
+    UINT32 nIFetch = whwc->ifetchBatch.size();
+    UINT32 nData = whwc->dataBatch.size();
+
+    bool inRange = ! wInfo.IsIFetch() || InWarmUpRange(wInfo.GetIFetchVA());
+
+    // Is it a control transfer instruction?
+    if (wInfo.IsCtrlTransfer())
+    {
+        whwc->nCtrlInits += 1;
+        if (inRange)
+        {
+            whwc->instrBatch.push_back(WARMUP_INSTR_CLASS(wInfo.GetAsimInst()));
+        }
+        else
+        {
+            whwc->nCtrlSkips += 1;
+        }
+        hadData = true;
+    }
+
+    if (wInfo.IsIFetch())
+    {
+        whwc->nIFetchInits += 1;
+        if (inRange)
+        {
+            whwc->ifetchBatch.push_back(WARMUP_IFETCH_CLASS(wInfo.GetIFetchVA(),
+                                                            wInfo.GetIFetchPA()));
+        }
+        else
+        {
+            whwc->nIFetchSkips += 1;
+        }
+        hadData = true;
+    }
+
+    // Is it a data reference?
+    for (UINT32 i = 0; i < wInfo.NLoads(); i++)
+    {
+        whwc->nDataInits += 1;
+        if (SampleWarmUpData(whwc, wInfo.GetLoadVA(i)))
+        {
+            whwc->dataBatch.push_back(WARMUP_DATA_CLASS(true,
+                                                        wInfo.GetLoadVA(i),
+                                                        wInfo.GetLoadPA(i),
+                                                        wInfo.GetLoadBytes(i)));
+            NoteDataSource(&whwc->dataBatch.back(), wInfo);
+        }
+        hadData = true;
+    }
+
+    for (UINT32 i = 0; i < wInfo.NStores(); i++)
+    {
+        whwc->nDataInits += 1;
+        if (SampleWarmUpData(whwc, wInfo.GetStoreVA(i)))
+        {
+            whwc->dataBatch.push_back(WARMUP_DATA_CLASS(false,
+                                                        wInfo.GetStoreVA(i),
+                                                        wInfo.GetStorePA(i),
+                                                        wInfo.GetStoreBytes(i)));
+            NoteDataSource(&whwc->dataBatch.back(), wInfo);
+        }
+        hadData = true;
+    }
+
+    if (! hadData)
+    {
+        whwc->nEmptyInits += 1;
+    }
+
+    if (WARMUP_LAST_INSTRS)
+    {
+        WARMUP_HWC_CLASS::HELD_RECORDS held;
+        held.nInstr = whwc->instrBatch.size() - nInstr;
+        held.nIFetch = whwc->ifetchBatch.size() - nIFetch;
+        held.nData = whwc->dataBatch.size() - nData;
+        whwc->heldRecords.push_back(held);
+    }
+}
+
+
+bool
+WARMUP_MANAGER_CLASS::SampleWarmUpData(
+    WARMUP_HWC whwc,
+    UINT64 va)
+{
+    if (! InWarmUpRange(va))
+    {
+        whwc->nDataSkips += 1;
+        return false;
+    }
+
+    if (WARMUP_DATA_SAMPLE <= 1)
+    {
+        return true;
+    }
+
+    //
+    // Keep one reference from each block of WARMUP_DATA_SAMPLE, chosen
+    // at random so the samples do not line up with loops in the code.
+    // The generator is seeded per context, so runs are repeatable.
+    //
+    if (whwc->samplePos == 0)
+    {
+        whwc->sampleRandom = whwc->sampleRandom * 6364136223846793005ULL +
+                             1442695040888963407ULL;
+        whwc->samplePick = (whwc->sampleRandom >> 33) % WARMUP_DATA_SAMPLE;
+    }
+
+    bool keep = (whwc->samplePos == whwc->samplePick);
+    whwc->samplePos = (whwc->samplePos + 1) % WARMUP_DATA_SAMPLE;
+
+    if (! keep)
+    {
+        whwc->nDataSkips += 1;
+    }
+    return keep;
+}
+
+
+void
+WARMUP_MANAGER_CLASS::TrimWarmUp(
+    WARMUP_HWC whwc,
+    UINT64 keep)
+{
+    if (whwc->heldRecords.size() <= keep)
+    {
+        return;
+    }
+
+    UINT32 nDrop = whwc->heldRecords.size() - keep;
+    UINT32 nInstr = 0;
+    UINT32 nIFetch = 0;
+    UINT32 nData = 0;
+    for (UINT32 i = 0; i < nDrop; i++)
+    {
+        nInstr += whwc->heldRecords[i].nInstr;
+        nIFetch += whwc->heldRecords[i].nIFetch;
+        nData += whwc->heldRecords[i].nData;
+    }
+    whwc->heldRecords.erase(whwc->heldRecords.begin(),
+                            whwc->heldRecords.begin() + nDrop);
+
+    whwc->instrBatch.erase(whwc->instrBatch.begin(),
+                           whwc->instrBatch.begin() + nInstr);
+    whwc->ifetchBatch.erase(whwc->ifetchBatch.begin(),
+                            whwc->ifetchBatch.begin() + nIFetch);
+    whwc->dataBatch.erase(whwc->dataBatch.begin(),
+                          whwc->dataBatch.begin() + nData);
+
+    whwc->nCtrlSkips += nInstr;
+    whwc->nIFetchSkips += nIFetch;
+    whwc->nDataSkips += nData;
+}
+
+
+void
+WARMUP_MANAGER_CLASS::ParseWarmUpRanges(void)
+{
+    if (! addrRanges.Parse(WARMUP_ADDR_RANGES))
+    {
+        ASIMERROR("Bad WARMUP_ADDR_RANGES \"" << WARMUP_ADDR_RANGES
+                  << "\", expected start-end[,start-end...]" << endl);
+    }
+}
+
+
+void
+WARMUP_MANAGER_CLASS::FlushWarmUp(WARMUP_HWC whwc)
+{
+    HW_CONTEXT hwc = whwc->hwc;
+
+    if (traceOut)
+    {
+        traceOut->Batch(whwc->index, whwc->ifetchBatch, whwc->dataBatch);
+    }
+
+    if (! whwc->instrBatch.empty())
+    {
+        WARMUP_INSTR wInstr = &whwc->instrBatch[0];
+        UINT32 n = whwc->instrBatch.size();
+
+        CallInstrCallbacks(globalInstrCallbacks, hwc, wInstr, n);
+        CallInstrCallbacks(whwc->instrCallbacks, hwc, wInstr, n);
+        whwc->instrBatch.clear();
+    }
+
+    if (! whwc->ifetchBatch.empty())
+    {
+        WARMUP_IFETCH wFetch = &whwc->ifetchBatch[0];
+        UINT32 n = whwc->ifetchBatch.size();
+
+        CallIFetchCallbacks(globalIFetchCallbacks, hwc, wFetch, n);
+        CallIFetchCallbacks(whwc->ifetchCallbacks, hwc, wFetch, n);
+        whwc->ifetchBatch.clear();
+    }
+
+    if (! whwc->dataBatch.empty())
+    {
+        WARMUP_DATA wData = &whwc->dataBatch[0];
+        UINT32 n = whwc->dataBatch.size();
+
+        CallDataCallbacks(globalDataCallbacks, hwc, wData, n);
+        CallDataCallbacks(whwc->dataCallbacks, hwc, wData, n);
+        whwc->dataBatch.clear();
+    }
+}
+
+
+string
+WARMUP_MANAGER_CLASS::WarmUpTraceName(
+    UINT32 batchRounds,
+    string& key)
+{
+    if (! ENABLE_WARMUP || (*WARMUP_TRACE_DIR == '\0'))
+    {
+        return "";
+    }
+
+    if (*WARMUP_TRACE_KEY == '\0')
+    {
+        ASIMWARNING("WARMUP_TRACE_DIR is set but WARMUP_TRACE_KEY is not, "
+                    "warm-up traces are not used" << endl);
+        return "";
+    }
+
+    if (nInstrCallbacks != 0)
+    {
+        ASIMWARNING("Warm-up traces can not hold control transfer "
+                    "instructions, warm-up traces are not used" << endl);
+        return "";
+    }
+
+    //
+    // Everything that changes the records passed to the clients is part
+    // of the key.  The file name is a hash of the key; the full key is
+    // stored in the file and checked when it is opened.
+    //
+    ostringstream os;
+    os << "region=" << WARMUP_TRACE_KEY
+       << " hwcs=" << hwcs.size()
+       << " batch=" << batchRounds
+       << " data=" << (nDataCallbacks != 0)
+       << " ifetch=" << MinIFetchLineBytes()
+       << " last=" << WARMUP_LAST_INSTRS
+       << " sample=" << WARMUP_DATA_SAMPLE
+       << " ranges=" << WARMUP_ADDR_RANGES;
+    key = os.str();
+
+    UINT64 hash = 14695981039346656037ULL;
+    for (UINT32 i = 0; i < key.size(); i++)
+    {
+        hash = (hash ^ UINT8(key[i])) * 1099511628211ULL;
+    }
+
+    char name[32];
+    sprintf(name, "/warmup-%016llx.wtr", (unsigned long long) hash);
+    return string(WARMUP_TRACE_DIR) + name;
+}
+
+
+UINT32
+WARMUP_MANAGER_CLASS::MinIFetchLineBytes(void)
+{
+    UINT32 lineBytes = 0;
+
+    for (IFETCH_CALLBACK_LIST::iterator i = globalIFetchCallbacks.begin();
+         i != globalIFetchCallbacks.end();
+         i++)
+    {
+        if ((lineBytes == 0) || ((*i)->LineBytes() < lineBytes))
+        {
+            lineBytes = (*i)->LineBytes();
+        }
+    }
+
+    for (WARMUP_HWC_LIST::iterator whwc = hwcs.begin();
+         whwc != hwcs.end();
+         whwc++)
+    {
+        for (IFETCH_CALLBACK_LIST::iterator i = (*whwc)->ifetchCallbacks.begin();
+             i != (*whwc)->ifetchCallbacks.end();
+             i++)
+        {
+            if ((lineBytes == 0) || ((*i)->LineBytes() < lineBytes))
+            {
+                lineBytes = (*i)->LineBytes();
+            }
+        }
+    }
+
+    return lineBytes;
+}
+
+
+void
+WARMUP_MANAGER_CLASS::ReplayWarmUp(WARMUP_TRACE_READER trace)
+{
+    vector<WARMUP_HWC> byIndex(hwcs.begin(), hwcs.end());
+    vector<UINT64> counters;
+    WARMUP_HWC whwc;
+
+    bool ok = true;
+    bool done = false;
+    while (ok && ! done)
+    {
+        UINT32 n;
+
+        switch (trace->Next())
+        {
+          case WARMUP_TRACE_CLASS::CHUNK_BATCH:
+            ok = trace->Batch(n);
+            if (ok)
+            {
+                whwc = byIndex[n];
+                ok = trace->Records(whwc->ifetchBatch, whwc->dataBatch);
+            }
+            if (ok)
+            {
+                FlushWarmUp(whwc);
+            }
+            break;
+
+          case WARMUP_TRACE_CLASS::CHUNK_TICKS:
+            ok = trace->Ticks(n);
+            for (UINT32 i = 0; ok && (i < n); i++)
+            {
+                CallTickCallbacks();
+            }
+            break;
+
+          case WARMUP_TRACE_CLASS::CHUNK_END:
+            ok = trace->Counters(counters) &&
+                 (counters.size() == N_WARMUP_COUNTERS * hwcs.size());
+            if (ok)
+            {
+                AddWarmUpCounters(counters);
+            }
+            done = true;
+            break;
+
+          default:
+            ok = false;
+            break;
+        }
+    }
+
+    if (! ok)
+    {
+        ASIMERROR("Corrupt warm-up trace for region " << WARMUP_TRACE_KEY
+                  << endl);
+    }
+}
+
+
+void
+WARMUP_MANAGER_CLASS::GetWarmUpCounters(vector<UINT64>& counters)
+{
+    counters.clear();
+    for (WARMUP_HWC_LIST::iterator whwc = hwcs.begin();
+         whwc != hwcs.end();
+         whwc++)
+    {
+        counters.push_back((*whwc)->nDataInits);
+        counters.push_back((*whwc)->nIFetchInits);
+        counters.push_back((*whwc)->nCtrlInits);
+        counters.push_back((*whwc)->nEmptyInits);
+        counters.push_back((*whwc)->nDataSkips);
+        counters.push_back((*whwc)->nIFetchSkips);
+        counters.push_back((*whwc)->nCtrlSkips);
+    }
+}
+
+
+void
+WARMUP_MANAGER_CLASS::AddWarmUpCounters(const vector<UINT64>& counters)
+{
+    vector<UINT64>::const_iterator c = counters.begin();
+    for (WARMUP_HWC_LIST::iterator whwc = hwcs.begin();
+         whwc != hwcs.end();
+         whwc++)
+    {
+        (*whwc)->nDataInits += *c++;
+        (*whwc)->nIFetchInits += *c++;
+        (*whwc)->nCtrlInits += *c++;
+        (*whwc)->nEmptyInits += *c++;
+        (*whwc)->nDataSkips += *c++;
+        (*whwc)->nIFetchSkips += *c++;
+        (*whwc)->nCtrlSkips += *c++;
+    }
+}
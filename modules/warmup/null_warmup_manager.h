@@ -99,7 +99,7 @@ class WARMUP_DATA_CLASS
     UINT64 GetInstrVA(void)     const { return 0;     }
     UINT64 GetInstrPA(void)     const { return 0;     }
 
-    bool IsLoad()                     { return false; }
+    bool IsLoad() const               { return false; }
 };
     
 
@@ -182,6 +182,30 @@ class WARMUP_CALLBACK_CLASS
     {
         ASIMERROR("No warm-up instrunction handler defined in derived class");
     };
+
+    virtual void WarmUpDataBatch(HW_CONTEXT hwc, WARMUP_DATA wData, UINT32 n)
+    {
+        for (UINT32 i = 0; i < n; i++)
+        {
+            WarmUpData(hwc, &wData[i]);
+        }
+    };
+
+    virtual void WarmUpIFetchBatch(HW_CONTEXT hwc, WARMUP_IFETCH wIfetch, UINT32 n)
+    {
+        for (UINT32 i = 0; i < n; i++)
+        {
+            WarmUpIFetch(hwc, &wIfetch[i]);
+        }
+    };
+
+    virtual void WarmUpInstrBatch(HW_CONTEXT hwc, WARMUP_INSTR wInstr, UINT32 n)
+    {
+        for (UINT32 i = 0; i < n; i++)
+        {
+            WarmUpInstr(hwc, &wInstr[i]);
+        }
+    };
 };
 
 
@@ -197,6 +221,8 @@ class WARMUP_INFO_CLASS
     WARMUP_INFO_CLASS(void)
     {};
 
+    void Reset(void) {}
+
     bool IsIFetch(void) const        { return false; }
     bool IsDataRef(void) const       { return false; }
     bool IsLoad(void) const          { return false; }
@@ -35,7 +35,8 @@ WARMUP_MANAGER_CLASS::WARMUP_MANAGER_CLASS(
     : ASIM_MODULE_CLASS(parent, name),
       nDataCallbacks(0),
       nIFetchCallbacks(0),
-      nInstrCallbacks(0)
+      nInstrCallbacks(0),
+      traceOut(NULL)
 {
 }
 
@@ -62,6 +63,8 @@ WARMUP_MANAGER_CLASS::RegisterHWC(HW_CONTEXT hwc)
     T1("Warmup:  Register HWC uid=" << hwc->GetUID()); 
 
     WARMUP_HWC whwc = new WARMUP_HWC_CLASS(hwc);
+    whwc->index = hwcs.size();
+    whwc->sampleRandom = whwc->index + 1;
     hwcs.push_back(whwc);
 
     RegisterState(&whwc->hwcUID, "warmupHwcUID",
@@ -74,6 +77,14 @@ WARMUP_MANAGER_CLASS::RegisterHWC(HW_CONTEXT hwc)
                   "Number of control transfer instructions parsed during warm-up");
     RegisterState(&whwc->nEmptyInits, "warmupEmptyRefs",
                   "Number of positive responses from feeder with no warm-up data");
+    RegisterState(&whwc->nDataSkips, "warmupDataSkips",
+                  "Number of data references not passed on by warm-up policies");
+    RegisterState(&whwc->nIFetchSkips, "warmupIFetchSkips",
+                  "Number of instruction fetches not passed on by warm-up policies");
+    RegisterState(&whwc->nCtrlSkips, "warmupCtrlSkips",
+                  "Number of control transfer instructions not passed on by warm-up policies");
+    RegisterState(&whwc->nInstAllocs, "warmupInstAllocs",
+                  "Number of ASIM_MACRO_INSTs allocated by the feeder during warm-up");
 }
 
 
@@ -153,10 +164,19 @@ WARMUP_MANAGER_CLASS::RegisterForInstrs(
 
 WARMUP_MANAGER_CLASS::WARMUP_HWC_CLASS::WARMUP_HWC_CLASS(HW_CONTEXT hwc)
     : hwc(hwc),
+      index(0),
+      idle(false),
+      samplePos(0),
+      samplePick(0),
+      sampleRandom(0),
       nDataInits(0),
       nIFetchInits(0),
       nCtrlInits(0),
-      nEmptyInits(0)
+      nEmptyInits(0),
+      nDataSkips(0),
+      nIFetchSkips(0),
+      nCtrlSkips(0),
+      nInstAllocs(0)
 {
     hwcUID = hwc->GetUID();
 };
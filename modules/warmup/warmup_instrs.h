@@ -25,11 +25,14 @@
 #define _WARMUP_INSTRS_
 
 #include <list>
+#include <vector>
+#include <deque>
 
 // ASIM core
 #include "asim/syntax.h"
 #include "asim/module.h"
 #include "asim/stateout.h"
+#include "asim/addr_ranges.h"
 
 // ASIM public modules
 #include "asim/provides/basesystem.h"
@@ -46,6 +49,8 @@ typedef class WARMUP_IFETCH_CLASS *WARMUP_IFETCH;
 typedef class WARMUP_INSTR_CLASS *WARMUP_INSTR;
 typedef class WARMUP_CALLBACK_CLASS *WARMUP_CALLBACK;
 typedef class WARMUP_MANAGER_CLASS *WARMUP_MANAGER;
+typedef class WARMUP_TRACE_WRITER_CLASS *WARMUP_TRACE_WRITER;
+typedef class WARMUP_TRACE_READER_CLASS *WARMUP_TRACE_READER;
 
 typedef class HW_CONTEXT_CLASS * HW_CONTEXT;
 
@@ -145,7 +150,7 @@ class WARMUP_DATA_CLASS
     UINT64 GetInstrVA(void) const { return instrVA; }
     UINT64 GetInstrPA(void) const { return instrPA; }
 
-    bool IsLoad() { return isLoad; }
+    bool IsLoad() const { return isLoad; }
 
   private:
     ASIM_MACRO_INST aInst;
@@ -153,11 +158,11 @@ class WARMUP_DATA_CLASS
     UINT64 instrVA;
     UINT64 instrPA;
 
-    const UINT64 va;
-    const UINT64 pa;
-    const UINT32 bytes;
+    UINT64 va;
+    UINT64 pa;
+    UINT32 bytes;
 
-    const bool isLoad;
+    bool isLoad;
     bool isIAddrValid;
 };
     
@@ -188,8 +193,8 @@ class WARMUP_IFETCH_CLASS
     UINT64 GetPA(void) const { return pa; };
 
   private:
-    const UINT64 va;
-    const UINT64 pa;
+    UINT64 va;
+    UINT64 pa;
 };
 
 
@@ -210,7 +215,7 @@ class WARMUP_INSTR_CLASS
     ASIM_MACRO_INST GetAsimInst(void) const { return aInst; };
 
   private:
-    const ASIM_MACRO_INST aInst;
+    ASIM_MACRO_INST aInst;
 };
     
 
@@ -255,6 +260,37 @@ class WARMUP_CALLBACK_CLASS
     {
         ASIMERROR("No warm-up instrunction handler defined in derived class");
     };
+
+    //
+    // The warm-up manager delivers records in batches: an array of all
+    // the records of one kind collected from a hardware context, oldest
+    // first.  The default handlers pass them one at a time to the single
+    // record handlers above, so a client only needs to override these
+    // when handling a whole batch at once is cheaper.
+    //
+    virtual void WarmUpDataBatch(HW_CONTEXT hwc, WARMUP_DATA wData, UINT32 n)
+    {
+        for (UINT32 i = 0; i < n; i++)
+        {
+            WarmUpData(hwc, &wData[i]);
+        }
+    };
+
+    virtual void WarmUpIFetchBatch(HW_CONTEXT hwc, WARMUP_IFETCH wIfetch, UINT32 n)
+    {
+        for (UINT32 i = 0; i < n; i++)
+        {
+            WarmUpIFetch(hwc, &wIfetch[i]);
+        }
+    };
+
+    virtual void WarmUpInstrBatch(HW_CONTEXT hwc, WARMUP_INSTR wInstr, UINT32 n)
+    {
+        for (UINT32 i = 0; i < n; i++)
+        {
+            WarmUpInstr(hwc, &wInstr[i]);
+        }
+    };
 };
 
 
@@ -278,6 +314,22 @@ class WARMUP_INFO_CLASS
 
     ~WARMUP_INFO_CLASS() {};
 
+    //
+    // Make the object look newly constructed so it can be passed to the
+    // feeder again.  Storage for long reference lists is kept.
+    //
+    void Reset(void)
+    {
+        aInst = NULL;
+        swContext = NULL;
+        nLoads = 0;
+        nStores = 0;
+        isIFetch = false;
+        isCtrlTransfer = false;
+        loadSpill.clear();
+        storeSpill.clear();
+    };
+
     bool IsIFetch(void) const { return isIFetch; };
     bool IsDataRef(void) const { return IsLoad() || IsStore(); };
     bool IsLoad(void) const { return (nLoads > 0); };
@@ -288,14 +340,14 @@ class WARMUP_INFO_CLASS
     UINT64 GetIFetchPA(void) const { ASSERTX(IsIFetch()); return instrPA; };
 
     UINT32 NLoads(void) const { return nLoads; };
-    UINT64 GetLoadVA(UINT32 n) const { ASSERTX(nLoads > n); return loads[n].va; };
-    UINT64 GetLoadPA(UINT32 n) const { ASSERTX(nLoads > n); return loads[n].pa; };
-    UINT32 GetLoadBytes(UINT32 n) const { ASSERTX(nLoads > n); return loads[n].nBytes; };
+    UINT64 GetLoadVA(UINT32 n) const { return Load(n).va; };
+    UINT64 GetLoadPA(UINT32 n) const { return Load(n).pa; };
+    UINT32 GetLoadBytes(UINT32 n) const { return Load(n).nBytes; };
 
     UINT32 NStores(void) const { return nStores; };
-    UINT64 GetStoreVA(UINT32 n) const { ASSERTX(nStores > n); return stores[n].va; };
-    UINT64 GetStorePA(UINT32 n) const { ASSERTX(nStores > n); return stores[n].pa; };
-    UINT32 GetStoreBytes(UINT32 n) const { ASSERTX(nStores > n); return stores[n].nBytes; };
+    UINT64 GetStoreVA(UINT32 n) const { return Store(n).va; };
+    UINT64 GetStorePA(UINT32 n) const { return Store(n).pa; };
+    UINT32 GetStoreBytes(UINT32 n) const { return Store(n).nBytes; };
 
     //
     // Call to indicate instruction fetch
@@ -317,15 +369,17 @@ class WARMUP_INFO_CLASS
         UINT64 pa,
         UINT32 bytes)
     {
-        // If an instruction refers to too many address drop them on the floor
+        MEM_REF ref = { va, pa, bytes };
 
-        if (nLoads < MAX_MEM_REFS)
+        if (nLoads < N_INLINE_REFS)
+        {
+            loads[nLoads] = ref;
+        }
+        else
         {
-            loads[nLoads].va = va;
-            loads[nLoads].pa = pa;
-            loads[nLoads].nBytes = bytes;
-            nLoads += 1;
+            loadSpill.push_back(ref);
         }
+        nLoads += 1;
     };
 
     void NoteStore(
@@ -333,15 +387,17 @@ class WARMUP_INFO_CLASS
         UINT64 pa,
         UINT32 bytes)
     {
-        // If an instruction refers to too many address drop them on the floor
+        MEM_REF ref = { va, pa, bytes };
 
-        if (nStores < MAX_MEM_REFS)
+        if (nStores < N_INLINE_REFS)
         {
-            stores[nStores].va = va;
-            stores[nStores].pa = pa;
-            stores[nStores].nBytes = bytes;
-            nStores += 1;
+            stores[nStores] = ref;
         }
+        else
+        {
+            storeSpill.push_back(ref);
+        }
+        nStores += 1;
     };
 
     //
@@ -383,15 +439,34 @@ class WARMUP_INFO_CLASS
         UINT32 nBytes;
     };
 
+    //
+    // The first few references of each kind are stored in the object.
+    // Any more, e.g. from gather/scatter or string instructions, go to
+    // the spill vectors, which keep their storage across Reset().
+    //
     enum
     {
-        MAX_MEM_REFS = 20
+        N_INLINE_REFS = 4
     };
 
-    MEM_REF loads[MAX_MEM_REFS];
-    MEM_REF stores[MAX_MEM_REFS];
+    MEM_REF loads[N_INLINE_REFS];
+    MEM_REF stores[N_INLINE_REFS];
     UINT32 nLoads;
     UINT32 nStores;
+    vector<MEM_REF> loadSpill;
+    vector<MEM_REF> storeSpill;
+
+    const MEM_REF& Load(UINT32 n) const
+    {
+        ASSERTX(nLoads > n);
+        return (n < N_INLINE_REFS) ? loads[n] : loadSpill[n - N_INLINE_REFS];
+    };
+
+    const MEM_REF& Store(UINT32 n) const
+    {
+        ASSERTX(nStores > n);
+        return (n < N_INLINE_REFS) ? stores[n] : storeSpill[n - N_INLINE_REFS];
+    };
 
     bool isIFetch;
     bool isCtrlTransfer;
@@ -466,13 +541,27 @@ class WARMUP_MANAGER_CLASS : public ASIM_MODULE_CLASS
 
         ~IFETCH_CALLBACK_CLASS() {};
 
-        void CallIfNewLine(HW_CONTEXT hwc, WARMUP_IFETCH wFetch)
+        UINT32 LineBytes(void) const { return UINT32(~lineMask + 1); };
+
+        //
+        // Pass on the fetches in a batch that start a new line.
+        //
+        void CallIfNewLine(HW_CONTEXT hwc, WARMUP_IFETCH wFetch, UINT32 n)
         {
-            UINT64 nextVA = wFetch->GetVA() & lineMask;
-            if (nextVA != lastVA)
+            newLines.clear();
+            for (UINT32 i = 0; i < n; i++)
             {
-                lastVA = nextVA;
-                cbk->WarmUpIFetch(hwc, wFetch);
+                UINT64 nextVA = wFetch[i].GetVA() & lineMask;
+                if (nextVA != lastVA)
+                {
+                    lastVA = nextVA;
+                    newLines.push_back(wFetch[i]);
+                }
+            }
+
+            if (! newLines.empty())
+            {
+                cbk->WarmUpIFetchBatch(hwc, &newLines[0], newLines.size());
             }
         };
 
@@ -480,6 +569,8 @@ class WARMUP_MANAGER_CLASS : public ASIM_MODULE_CLASS
         WARMUP_CALLBACK cbk;
         UINT64 lineMask;
         UINT64 lastVA;
+
+        vector<WARMUP_IFETCH_CLASS> newLines;
     };
     typedef IFETCH_CALLBACK_CLASS *IFETCH_CALLBACK;
         
@@ -490,6 +581,10 @@ class WARMUP_MANAGER_CLASS : public ASIM_MODULE_CLASS
     typedef list<IFETCH_CALLBACK> IFETCH_CALLBACK_LIST;
     typedef list<WARMUP_CALLBACK> INSTR_CALLBACK_LIST;
 
+    typedef vector<WARMUP_DATA_CLASS> DATA_BATCH;
+    typedef vector<WARMUP_IFETCH_CLASS> IFETCH_BATCH;
+    typedef vector<WARMUP_INSTR_CLASS> INSTR_BATCH;
+
     class WARMUP_HWC_CLASS
     {
       public:
@@ -497,16 +592,45 @@ class WARMUP_MANAGER_CLASS : public ASIM_MODULE_CLASS
         ~WARMUP_HWC_CLASS();
 
         HW_CONTEXT hwc;
+        UINT32 index;           // position in hwcs
+        bool idle;              // no warm-up info in the last round
 
         DATA_CALLBACK_LIST   dataCallbacks;
         IFETCH_CALLBACK_LIST ifetchCallbacks;
         INSTR_CALLBACK_LIST  instrCallbacks;
 
+        // Records collected from the feeder, not yet passed to clients.
+        // The vectors are reused from batch to batch.
+        DATA_BATCH   dataBatch;
+        IFETCH_BATCH ifetchBatch;
+        INSTR_BATCH  instrBatch;
+
+        // With WARMUP_LAST_INSTRS the batch holds the records of the
+        // latest instructions; heldRecords has the number of records
+        // of each kind that each of them added.
+        struct HELD_RECORDS
+        {
+            UINT8 nInstr;
+            UINT8 nIFetch;
+            UINT32 nData;
+        };
+        deque<HELD_RECORDS> heldRecords;
+
+        // WARMUP_DATA_SAMPLE: position in the current block of data
+        // references and the one picked from it
+        UINT32 samplePos;
+        UINT32 samplePick;
+        UINT64 sampleRandom;
+
         UINT64 hwcUID;
         UINT64 nDataInits;
         UINT64 nIFetchInits;
         UINT64 nCtrlInits;
         UINT64 nEmptyInits;
+        UINT64 nDataSkips;
+        UINT64 nIFetchSkips;
+        UINT64 nCtrlSkips;
+        UINT64 nInstAllocs;
     };
 
     typedef WARMUP_HWC_CLASS * WARMUP_HWC;
@@ -524,6 +648,44 @@ class WARMUP_MANAGER_CLASS : public ASIM_MODULE_CLASS
     UINT32 nIFetchCallbacks;
     UINT32 nInstrCallbacks;
 
+    // Cached warm-up trace being written, if any
+    WARMUP_TRACE_WRITER traceOut;
+
+    // WARMUP_ADDR_RANGES
+    ADDR_RANGES_CLASS addrRanges;
+    void ParseWarmUpRanges(void);
+    bool InWarmUpRange(UINT64 va) const
+    {
+        return addrRanges.Empty() || addrRanges.Contains(va);
+    };
+
+    // Apply WARMUP_ADDR_RANGES and WARMUP_DATA_SAMPLE to a data reference
+    bool SampleWarmUpData(WARMUP_HWC whwc, UINT64 va);
+
+    // Drop the records of all but the latest keep instructions of whwc
+    void TrimWarmUp(WARMUP_HWC whwc, UINT64 keep);
+
+    // Add the warm-up info returned by a feeder to the batch of whwc
+    void BatchWarmUp(WARMUP_HWC whwc, const WARMUP_INFO_CLASS& wInfo);
+
+    // Pass the batch of whwc to the clients and empty it
+    void FlushWarmUp(WARMUP_HWC whwc);
+
+    // Name and key of the cached warm-up trace for this region, or
+    // an empty name if warm-up traces are not used.
+    string WarmUpTraceName(UINT32 batchRounds, string& key);
+
+    // Smallest line size of the fetch clients, 0 if there are none
+    UINT32 MinIFetchLineBytes(void);
+
+    // Pass the records of a cached trace to the clients
+    void ReplayWarmUp(WARMUP_TRACE_READER trace);
+
+    // Copy the warm-up counters of all contexts to or from counters
+    enum { N_WARMUP_COUNTERS = 7 };
+    void GetWarmUpCounters(vector<UINT64>& counters);
+    void AddWarmUpCounters(const vector<UINT64>& counters);
+
     WARMUP_HWC FindHWC(HW_CONTEXT hwc)
     {
         for (WARMUP_HWC_LIST::iterator whwc = hwcs.begin();
@@ -560,38 +722,41 @@ class WARMUP_MANAGER_CLASS : public ASIM_MODULE_CLASS
         }
     };
     
-    void CallDataCallbacks(const DATA_CALLBACK_LIST cbkList,
+    void CallDataCallbacks(const DATA_CALLBACK_LIST& cbkList,
                            HW_CONTEXT hwc,
-                           WARMUP_DATA wData)
+                           WARMUP_DATA wData,
+                           UINT32 n)
     {
         DATA_CALLBACK_LIST::const_iterator cbk = cbkList.begin();
         while (cbk != cbkList.end())
         {
-            (*cbk)->WarmUpData(hwc, wData);
+            (*cbk)->WarmUpDataBatch(hwc, wData, n);
             cbk++;
         }
     };
     
-    void CallIFetchCallbacks(const IFETCH_CALLBACK_LIST cbkList,
+    void CallIFetchCallbacks(const IFETCH_CALLBACK_LIST& cbkList,
                              HW_CONTEXT hwc,
-                             WARMUP_IFETCH wFetch)
+                             WARMUP_IFETCH wFetch,
+                             UINT32 n)
     {
         IFETCH_CALLBACK_LIST::const_iterator cbk = cbkList.begin();
         while (cbk != cbkList.end())
         {
-            (*cbk)->CallIfNewLine(hwc, wFetch);
+            (*cbk)->CallIfNewLine(hwc, wFetch, n);
             cbk++;
         }
     };
     
-    void CallInstrCallbacks(const INSTR_CALLBACK_LIST cbkList,
+    void CallInstrCallbacks(const INSTR_CALLBACK_LIST& cbkList,
                             HW_CONTEXT hwc,
-                            WARMUP_INSTR wInstr)
+                            WARMUP_INSTR wInstr,
+                            UINT32 n)
     {
         INSTR_CALLBACK_LIST::const_iterator cbk = cbkList.begin();
         while (cbk != cbkList.end())
         {
-            (*cbk)->WarmUpInstr(hwc, wInstr);
+            (*cbk)->WarmUpInstrBatch(hwc, wInstr, n);
             cbk++;
         }
     };
@@ -0,0 +1,157 @@
+/*
+ *Copyright (C) 2006 Intel Corporation
+ *
+ *This program is free software; you can redistribute it and/or
+ *modify it under the terms of the GNU General Public License
+ *as published by the Free Software Foundation; either version 2
+ *of the License, or (at your option) any later version.
+ *
+ *This program is distributed in the hope that it will be useful,
+ *but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *GNU General Public License for more details.
+ *
+ *You should have received a copy of the GNU General Public License
+ *along with this program; if not, write to the Free Software
+ *Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * @file
+ * @brief Warm-up feeder calls on a worker thread
+ */
+
+// generic
+#include <errno.h>
+#include <string.h>
+
+// ASIM core
+#include "asim/syntax.h"
+#include "asim/mesg.h"
+
+// ASIM public modules
+#include "asim/provides/hardware_context.h"
+
+#include "warmup_producer.h"
+
+WARMUP_PRODUCER_CLASS::WARMUP_PRODUCER_CLASS(
+    HW_CONTEXT hwc,
+    UINT32 queueSize)
+    : hwc(hwc),
+      slots(queueSize),
+      head(0),
+      tail(0),
+      count(0),
+      grant(GRANT_NONE)
+{
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&notEmpty, NULL);
+    pthread_cond_init(&notFull, NULL);
+    pthread_cond_init(&granted, NULL);
+
+    int err = pthread_create(&thread, NULL, WorkerMain, this);
+    if (err != 0)
+    {
+        ASIMERROR("Can't create warm-up thread: " << strerror(err) << endl);
+    }
+}
+
+
+WARMUP_PRODUCER_CLASS::~WARMUP_PRODUCER_CLASS()
+{
+    // The worker ends after Continue(false)
+    pthread_join(thread, NULL);
+
+    pthread_cond_destroy(&granted);
+    pthread_cond_destroy(&notFull);
+    pthread_cond_destroy(&notEmpty);
+    pthread_mutex_destroy(&lock);
+}
+
+
+void *
+WARMUP_PRODUCER_CLASS::WorkerMain(void *arg)
+{
+    static_cast<WARMUP_PRODUCER>(arg)->Worker();
+    return NULL;
+}
+
+
+void
+WARMUP_PRODUCER_CLASS::Worker(void)
+{
+    while (true)
+    {
+        pthread_mutex_lock(&lock);
+        while (count == slots.size())
+        {
+            pthread_cond_wait(&notFull, &lock);
+        }
+        SLOT& slot = slots[tail];
+        pthread_mutex_unlock(&lock);
+
+        slot.got = hwc->WarmUp(&slot.wInfo);
+
+        pthread_mutex_lock(&lock);
+        tail = (tail + 1) % slots.size();
+        count += 1;
+        pthread_cond_signal(&notEmpty);
+
+        if (! slot.got)
+        {
+            while (grant == GRANT_NONE)
+            {
+                pthread_cond_wait(&granted, &lock);
+            }
+
+            bool stop = (grant == GRANT_STOP);
+            grant = GRANT_NONE;
+            if (stop)
+            {
+                pthread_mutex_unlock(&lock);
+                return;
+            }
+        }
+        pthread_mutex_unlock(&lock);
+    }
+}
+
+
+bool
+WARMUP_PRODUCER_CLASS::Next(WARMUP_INFO& wInfo)
+{
+    pthread_mutex_lock(&lock);
+    while (count == 0)
+    {
+        pthread_cond_wait(&notEmpty, &lock);
+    }
+    SLOT& slot = slots[head];
+    pthread_mutex_unlock(&lock);
+
+    wInfo = &slot.wInfo;
+    return slot.got;
+}
+
+
+void
+WARMUP_PRODUCER_CLASS::Release(void)
+{
+    // Drop the slot's references here, not on the worker
+    slots[head].wInfo.Reset();
+
+    pthread_mutex_lock(&lock);
+    head = (head + 1) % slots.size();
+    count -= 1;
+    pthread_cond_signal(&notFull);
+    pthread_mutex_unlock(&lock);
+}
+
+
+void
+WARMUP_PRODUCER_CLASS::Continue(bool more)
+{
+    pthread_mutex_lock(&lock);
+    grant = more ? GRANT_MORE : GRANT_STOP;
+    pthread_cond_signal(&granted);
+    pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,103 @@
+/*
+ *Copyright (C) 2006 Intel Corporation
+ *
+ *This program is free software; you can redistribute it and/or
+ *modify it under the terms of the GNU General Public License
+ *as published by the Free Software Foundation; either version 2
+ *of the License, or (at your option) any later version.
+ *
+ *This program is distributed in the hope that it will be useful,
+ *but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *GNU General Public License for more details.
+ *
+ *You should have received a copy of the GNU General Public License
+ *along with this program; if not, write to the Free Software
+ *Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * @file
+ * @brief Warm-up feeder calls on a worker thread
+ */
+
+#ifndef _WARMUP_PRODUCER_
+#define _WARMUP_PRODUCER_
+
+// generic
+#include <pthread.h>
+#include <vector>
+
+// ASIM core
+#include "asim/syntax.h"
+
+// ASIM public modules
+#include "asim/provides/warmup_manager.h"
+
+using namespace std;
+
+/*
+ * Calls WarmUp() of one hardware context on a worker thread, ahead of
+ * the warm-up manager, and queues the results in a bounded ring.  The
+ * manager takes them in order with Next()/Release(), so it sees the
+ * same sequence as calling WarmUp() itself.
+ *
+ * The worker makes exactly the calls the manager would have made.
+ * After WarmUp() returns false the worker waits for Continue(): the
+ * manager calls the context again only if another context still had
+ * data in the same round.
+ *
+ * The feeder of the context, and the allocation of ASIM_MACRO_INSTs in
+ * WARMUP_INFO_CLASS::InitAsimInst(), must be safe to run concurrently
+ * with the other contexts and with the manager's thread.  A WARMUP_INFO
+ * is reset on the manager's thread before its slot is reused, so the
+ * references it holds are only ever dropped there.
+ */
+typedef class WARMUP_PRODUCER_CLASS *WARMUP_PRODUCER;
+class WARMUP_PRODUCER_CLASS
+{
+  private:
+    struct SLOT
+    {
+        WARMUP_INFO_CLASS wInfo;
+        bool got;           // WarmUp() return value
+    };
+
+    enum GRANT
+    {
+        GRANT_NONE,
+        GRANT_MORE,
+        GRANT_STOP
+    };
+
+    HW_CONTEXT hwc;
+    vector<SLOT> slots;
+    UINT32 head;            // next slot for the manager
+    UINT32 tail;            // next slot for the worker
+    UINT32 count;           // filled slots
+    GRANT grant;            // answer to a false WarmUp()
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+    pthread_cond_t granted;
+
+    static void *WorkerMain(void *arg);
+    void Worker(void);
+
+  public:
+    WARMUP_PRODUCER_CLASS(HW_CONTEXT hwc, UINT32 queueSize);
+    ~WARMUP_PRODUCER_CLASS();
+
+    // Result of the next WarmUp() call; wInfo is valid until Release()
+    bool Next(WARMUP_INFO& wInfo);
+    void Release(void);
+
+    // After Next() returned false, tell the worker whether the context
+    // is called again (more) or warm-up is over.  The producer may only
+    // be deleted after Continue(false).
+    void Continue(bool more);
+};
+
+#endif /* _WARMUP_PRODUCER_ */
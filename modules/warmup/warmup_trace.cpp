@@ -0,0 +1,491 @@
+/*
+ *Copyright (C) 2006 Intel Corporation
+ *
+ *This program is free software; you can redistribute it and/or
+ *modify it under the terms of the GNU General Public License
+ *as published by the Free Software Foundation; either version 2
+ *of the License, or (at your option) any later version.
+ *
+ *This program is distributed in the hope that it will be useful,
+ *but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *GNU General Public License for more details.
+ *
+ *You should have received a copy of the GNU General Public License
+ *along with this program; if not, write to the Free Software
+ *Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * @file
+ * @brief Cached warm-up traces
+ */
+
+// generic
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sstream>
+
+// ASIM core
+#include "asim/syntax.h"
+#include "asim/mesg.h"
+
+#include "warmup_trace.h"
+
+const char WARMUP_TRACE_CLASS::magic[8] = { 'A', 'S', 'I', 'M', 'W', 'U', 'P', '\n' };
+
+
+WARMUP_TRACE_CLASS::~WARMUP_TRACE_CLASS()
+{
+    if (file)
+    {
+        fclose(file);
+    }
+}
+
+
+void
+WARMUP_TRACE_CLASS::PutVarint(
+    string& buf,
+    UINT64 value)
+{
+    while (value >= 0x80)
+    {
+        buf += char((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    buf += char(value);
+}
+
+
+void
+WARMUP_TRACE_CLASS::PutDelta(
+    string& buf,
+    UINT64 value,
+    UINT64& prev)
+{
+    UINT64 delta = value - prev;
+    PutVarint(buf, (delta << 1) ^ UINT64(INT64(delta) >> 63));
+    prev = value;
+}
+
+
+bool
+WARMUP_TRACE_CLASS::GetVarint(
+    const char **cp,
+    const char *end,
+    UINT64& value)
+{
+    value = 0;
+    for (UINT32 shift = 0; shift < 64; shift += 7)
+    {
+        if (*cp == end)
+        {
+            return false;
+        }
+
+        UINT8 c = **cp;
+        *cp += 1;
+        value |= UINT64(c & 0x7f) << shift;
+        if (! (c & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool
+WARMUP_TRACE_CLASS::GetDelta(
+    const char **cp,
+    const char *end,
+    UINT64& value,
+    UINT64& prev)
+{
+    UINT64 zz;
+    if (! GetVarint(cp, end, zz))
+    {
+        return false;
+    }
+
+    value = prev + ((zz >> 1) ^ (0 - (zz & 1)));
+    prev = value;
+    return true;
+}
+
+
+// ---------------------------------------------------------------------
+// WARMUP_TRACE_WRITER_CLASS --
+// ---------------------------------------------------------------------
+
+WARMUP_TRACE_WRITER_CLASS::WARMUP_TRACE_WRITER_CLASS(
+    FILE *file,
+    UINT32 nHWCs,
+    const string& fileName,
+    const string& tmpName,
+    UINT32 lineBytes)
+    : WARMUP_TRACE_CLASS(file, nHWCs),
+      fileName(fileName),
+      tmpName(tmpName),
+      lineMask(~UINT64(lineBytes - 1)),
+      fetches(lineBytes != 0)
+{
+}
+
+
+WARMUP_TRACE_WRITER
+WARMUP_TRACE_WRITER_CLASS::Create(
+    const string& fileName,
+    const string& key,
+    UINT32 nHWCs,
+    UINT32 lineBytes)
+{
+    //
+    // Write to a private name and rename at the end, so other runs
+    // never see a partial trace.
+    //
+    ostringstream tmpName;
+    tmpName << fileName << "." << getpid();
+
+    FILE *file = fopen(tmpName.str().c_str(), "wb");
+    if (! file)
+    {
+        ASIMWARNING("Unable to create warm-up trace \"" << tmpName.str()
+                    << "\", " << strerror(errno) << endl);
+        return NULL;
+    }
+
+    string header(magic, sizeof(magic));
+    PutVarint(header, VERSION);
+    PutVarint(header, nHWCs);
+    PutVarint(header, key.size());
+    header += key;
+    fwrite(header.data(), 1, header.size(), file);
+
+    return new WARMUP_TRACE_WRITER_CLASS(file, nHWCs, fileName,
+                                         tmpName.str(), lineBytes);
+}
+
+
+WARMUP_TRACE_WRITER_CLASS::~WARMUP_TRACE_WRITER_CLASS()
+{
+    // Never finished: drop the partial trace
+    if (file)
+    {
+        fclose(file);
+        file = NULL;
+        unlink(tmpName.c_str());
+    }
+}
+
+
+void
+WARMUP_TRACE_WRITER_CLASS::Batch(
+    UINT32 hwc,
+    const vector<WARMUP_IFETCH_CLASS>& ifetchBatch,
+    const vector<WARMUP_DATA_CLASS>& dataBatch)
+{
+    LAST& prev = last[hwc];
+
+    record.clear();
+    PutVarint(record, hwc);
+
+    //
+    // Drop fetches from the line of the previous one.  This is done only
+    // within the batch, since the manager delivers the batch as a whole
+    // while clients may see other contexts' batches in between.
+    //
+    string fetchRecords;
+    UINT32 nFetches = 0;
+    bool first = true;
+    UINT64 lastLine = 0;
+    for (UINT32 i = 0; fetches && (i < ifetchBatch.size()); i++)
+    {
+        UINT64 line = ifetchBatch[i].GetVA() & lineMask;
+        if (first || (line != lastLine))
+        {
+            first = false;
+            lastLine = line;
+            PutDelta(fetchRecords, ifetchBatch[i].GetVA(), prev.fetchVA);
+            PutDelta(fetchRecords, ifetchBatch[i].GetPA(), prev.fetchPA);
+            nFetches += 1;
+        }
+    }
+    PutVarint(record, nFetches);
+    record += fetchRecords;
+
+    PutVarint(record, dataBatch.size());
+    for (UINT32 i = 0; i < dataBatch.size(); i++)
+    {
+        const WARMUP_DATA_CLASS& wData = dataBatch[i];
+        UINT32 flags = (wData.IsLoad() ? DATA_LOAD : 0) |
+                       (wData.IsInstrAddrValid() ? DATA_IADDR : 0);
+
+        PutVarint(record, flags);
+        PutDelta(record, wData.GetVA(), prev.dataVA);
+        PutDelta(record, wData.GetPA(), prev.dataPA);
+        PutVarint(record, wData.GetBytes());
+        if (flags & DATA_IADDR)
+        {
+            PutDelta(record, wData.GetInstrVA(), prev.instrVA);
+            PutDelta(record, wData.GetInstrPA(), prev.instrPA);
+        }
+    }
+
+    string header(1, char(CHUNK_BATCH));
+    PutVarint(header, record.size());
+    fwrite(header.data(), 1, header.size(), file);
+    fwrite(record.data(), 1, record.size(), file);
+}
+
+
+void
+WARMUP_TRACE_WRITER_CLASS::Ticks(UINT32 n)
+{
+    record.clear();
+    PutVarint(record, n);
+
+    string header(1, char(CHUNK_TICKS));
+    PutVarint(header, record.size());
+    fwrite(header.data(), 1, header.size(), file);
+    fwrite(record.data(), 1, record.size(), file);
+}
+
+
+void
+WARMUP_TRACE_WRITER_CLASS::Finish(
+    const vector<UINT64>& counters,
+    UINT32 nCounters)
+{
+    record.clear();
+    PutVarint(record, nCounters);
+    for (UINT32 i = 0; i < counters.size(); i++)
+    {
+        PutVarint(record, counters[i]);
+    }
+
+    string header(1, char(CHUNK_END));
+    PutVarint(header, record.size());
+    fwrite(header.data(), 1, header.size(), file);
+    fwrite(record.data(), 1, record.size(), file);
+
+    bool ok = ! ferror(file);
+    ok = (fclose(file) == 0) && ok;
+    file = NULL;
+
+    if (! ok || (rename(tmpName.c_str(), fileName.c_str()) != 0))
+    {
+        ASIMWARNING("Unable to write warm-up trace \"" << fileName
+                    << "\", " << strerror(errno) << endl);
+        unlink(tmpName.c_str());
+    }
+}
+
+
+// ---------------------------------------------------------------------
+// WARMUP_TRACE_READER_CLASS --
+// ---------------------------------------------------------------------
+
+WARMUP_TRACE_READER_CLASS::WARMUP_TRACE_READER_CLASS(
+    FILE *file,
+    UINT32 nHWCs)
+    : WARMUP_TRACE_CLASS(file, nHWCs),
+      cp(NULL),
+      end(NULL),
+      batchHWC(0)
+{
+}
+
+
+WARMUP_TRACE_READER
+WARMUP_TRACE_READER_CLASS::Open(
+    const string& fileName,
+    const string& key,
+    UINT32 nHWCs)
+{
+    FILE *file = fopen(fileName.c_str(), "rb");
+    if (! file)
+    {
+        return NULL;
+    }
+
+    //
+    // The header is short; read enough for it and check every field.
+    //
+    string header(sizeof(magic) + 30 + key.size(), '\0');
+    header.resize(fread(&header[0], 1, header.size(), file));
+
+    const char *hp = header.data();
+    const char *hend = hp + header.size();
+    UINT64 version, nFileHWCs, keyLen;
+
+    bool match =
+        (header.size() > sizeof(magic)) &&
+        (memcmp(hp, magic, sizeof(magic)) == 0);
+    hp += sizeof(magic);
+
+    match = match &&
+            GetVarint(&hp, hend, version) && (version == VERSION) &&
+            GetVarint(&hp, hend, nFileHWCs) && (nFileHWCs == nHWCs) &&
+            GetVarint(&hp, hend, keyLen) && (keyLen == key.size()) &&
+            (UINT64(hend - hp) >= keyLen) &&
+            (key.compare(0, keyLen, hp, keyLen) == 0);
+
+    if (! match)
+    {
+        fclose(file);
+        return NULL;
+    }
+
+    hp += keyLen;
+    fseek(file, hp - header.data(), SEEK_SET);
+
+    return new WARMUP_TRACE_READER_CLASS(file, nHWCs);
+}
+
+
+WARMUP_TRACE_CLASS::CHUNK
+WARMUP_TRACE_READER_CLASS::Next(void)
+{
+    int tag = getc(file);
+
+    UINT64 len = 0;
+    for (UINT32 shift = 0; shift < 64; shift += 7)
+    {
+        int c = getc(file);
+        if (c == EOF)
+        {
+            return CHUNK_BAD;
+        }
+        len |= UINT64(c & 0x7f) << shift;
+        if (! (c & 0x80))
+        {
+            break;
+        }
+    }
+
+    record.resize(len);
+    if ((len != 0) && (fread(&record[0], 1, len, file) != len))
+    {
+        return CHUNK_BAD;
+    }
+
+    cp = record.data();
+    end = cp + record.size();
+
+    switch (tag)
+    {
+      case CHUNK_BATCH:
+      case CHUNK_TICKS:
+      case CHUNK_END:
+        return CHUNK(tag);
+      default:
+        return CHUNK_BAD;
+    }
+}
+
+
+bool
+WARMUP_TRACE_READER_CLASS::Batch(UINT32& hwc)
+{
+    UINT64 n;
+    if (! GetVarint(&cp, end, n) || (n >= last.size()))
+    {
+        return false;
+    }
+    batchHWC = hwc = n;
+    return true;
+}
+
+
+bool
+WARMUP_TRACE_READER_CLASS::Records(
+    vector<WARMUP_IFETCH_CLASS>& ifetchBatch,
+    vector<WARMUP_DATA_CLASS>& dataBatch)
+{
+    LAST& prev = last[batchHWC];
+    UINT64 n;
+
+    ifetchBatch.clear();
+    if (! GetVarint(&cp, end, n))
+    {
+        return false;
+    }
+    for (UINT64 i = 0; i < n; i++)
+    {
+        UINT64 va, pa;
+        if (! GetDelta(&cp, end, va, prev.fetchVA) ||
+            ! GetDelta(&cp, end, pa, prev.fetchPA))
+        {
+            return false;
+        }
+        ifetchBatch.push_back(WARMUP_IFETCH_CLASS(va, pa));
+    }
+
+    dataBatch.clear();
+    if (! GetVarint(&cp, end, n))
+    {
+        return false;
+    }
+    for (UINT64 i = 0; i < n; i++)
+    {
+        UINT64 flags, va, pa, bytes;
+        if (! GetVarint(&cp, end, flags) ||
+            ! GetDelta(&cp, end, va, prev.dataVA) ||
+            ! GetDelta(&cp, end, pa, prev.dataPA) ||
+            ! GetVarint(&cp, end, bytes))
+        {
+            return false;
+        }
+        dataBatch.push_back(WARMUP_DATA_CLASS(flags & DATA_LOAD, va, pa, bytes));
+
+        if (flags & DATA_IADDR)
+        {
+            UINT64 iVA, iPA;
+            if (! GetDelta(&cp, end, iVA, prev.instrVA) ||
+                ! GetDelta(&cp, end, iPA, prev.instrPA))
+            {
+                return false;
+            }
+            dataBatch.back().SetInstrAddr(iVA, iPA);
+        }
+    }
+
+    return cp == end;
+}
+
+
+bool
+WARMUP_TRACE_READER_CLASS::Ticks(UINT32& n)
+{
+    UINT64 value;
+    if (! GetVarint(&cp, end, value))
+    {
+        return false;
+    }
+    n = value;
+    return cp == end;
+}
+
+
+bool
+WARMUP_TRACE_READER_CLASS::Counters(vector<UINT64>& counters)
+{
+    UINT64 nCounters;
+    if (! GetVarint(&cp, end, nCounters))
+    {
+        return false;
+    }
+
+    counters.resize(nCounters * last.size());
+    for (UINT32 i = 0; i < counters.size(); i++)
+    {
+        if (! GetVarint(&cp, end, counters[i]))
+        {
+            return false;
+        }
+    }
+    return cp == end;
+}
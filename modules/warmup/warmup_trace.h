@@ -0,0 +1,177 @@
+/*
+ *Copyright (C) 2006 Intel Corporation
+ *
+ *This program is free software; you can redistribute it and/or
+ *modify it under the terms of the GNU General Public License
+ *as published by the Free Software Foundation; either version 2
+ *of the License, or (at your option) any later version.
+ *
+ *This program is distributed in the hope that it will be useful,
+ *but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *GNU General Public License for more details.
+ *
+ *You should have received a copy of the GNU General Public License
+ *along with this program; if not, write to the Free Software
+ *Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * @file
+ * @brief Cached warm-up traces
+ */
+
+#ifndef _WARMUP_TRACE_
+#define _WARMUP_TRACE_
+
+// generic
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// ASIM core
+#include "asim/syntax.h"
+
+// ASIM public modules
+#include "asim/provides/warmup_manager.h"
+
+using namespace std;
+
+/*
+ * A warm-up trace holds the records the warm-up manager passed to its
+ * clients for one region, so later runs of the same region can replay
+ * them instead of running the feeder through warm-up again.
+ *
+ * Instruction fetches are stored only when they start a new line of
+ * the smallest line size any fetch client registered, so replay gives
+ * every client the same calls.  ASIM_MACRO_INSTs are not stored:
+ * control transfer records can not be traced and replayed data records
+ * have no instruction attached.
+ *
+ * File layout: a header (magic, version, key) followed by chunks of
+ * a tag byte, a varint payload length and the payload.  Addresses are
+ * stored as zigzag varint deltas from the previous one of the same
+ * kind in the same hardware context.
+ */
+typedef class WARMUP_TRACE_CLASS *WARMUP_TRACE;
+class WARMUP_TRACE_CLASS
+{
+  public:
+    enum CHUNK
+    {
+        CHUNK_BATCH = 1,    // records of one hardware context
+        CHUNK_TICKS = 2,    // tick callbacks
+        CHUNK_END = 3,      // per context counters, last chunk
+        CHUNK_BAD = 0       // truncated or corrupt file
+    };
+
+  protected:
+    enum { VERSION = 2 };
+
+    enum
+    {
+        DATA_LOAD = 1,
+        DATA_IADDR = 2
+    };
+
+    // Previous addresses of a hardware context
+    struct LAST
+    {
+        LAST() : fetchVA(0), fetchPA(0), dataVA(0), dataPA(0),
+                 instrVA(0), instrPA(0) {};
+
+        UINT64 fetchVA, fetchPA;
+        UINT64 dataVA, dataPA;
+        UINT64 instrVA, instrPA;
+    };
+
+    FILE *file;
+    vector<LAST> last;
+    string record;      // scratch buffer for one chunk
+
+    WARMUP_TRACE_CLASS(FILE *file, UINT32 nHWCs)
+        : file(file),
+          last(nHWCs)
+    {};
+
+    static const char magic[8];
+
+    static void PutVarint(string& buf, UINT64 value);
+    static void PutDelta(string& buf, UINT64 value, UINT64& prev);
+    static bool GetVarint(const char **cp, const char *end, UINT64& value);
+    static bool GetDelta(const char **cp, const char *end, UINT64& value, UINT64& prev);
+
+  public:
+    virtual ~WARMUP_TRACE_CLASS();
+};
+
+
+typedef class WARMUP_TRACE_WRITER_CLASS *WARMUP_TRACE_WRITER;
+class WARMUP_TRACE_WRITER_CLASS : public WARMUP_TRACE_CLASS
+{
+  private:
+    string fileName;    // published by Finish()
+    string tmpName;     // written until then
+    UINT64 lineMask;    // fetches are kept when they start a new line
+    bool fetches;       // any fetch clients?
+
+    WARMUP_TRACE_WRITER_CLASS(FILE *file, UINT32 nHWCs,
+                              const string& fileName, const string& tmpName,
+                              UINT32 lineBytes);
+
+  public:
+    // Start a trace for key.  lineBytes is the smallest line size of
+    // the fetch clients, or 0 if there are none.  Returns NULL if the
+    // file can not be created.
+    static WARMUP_TRACE_WRITER Create(const string& fileName,
+                                      const string& key,
+                                      UINT32 nHWCs,
+                                      UINT32 lineBytes);
+
+    ~WARMUP_TRACE_WRITER_CLASS();
+
+    void Batch(UINT32 hwc,
+               const vector<WARMUP_IFETCH_CLASS>& ifetchBatch,
+               const vector<WARMUP_DATA_CLASS>& dataBatch);
+    void Ticks(UINT32 n);
+
+    // Write the counters (nCounters per context) and make the trace
+    // visible under its final name.
+    void Finish(const vector<UINT64>& counters, UINT32 nCounters);
+};
+
+
+typedef class WARMUP_TRACE_READER_CLASS *WARMUP_TRACE_READER;
+class WARMUP_TRACE_READER_CLASS : public WARMUP_TRACE_CLASS
+{
+  private:
+    const char *cp;     // unread part of the current chunk
+    const char *end;
+    UINT32 batchHWC;    // context of the current CHUNK_BATCH
+
+    WARMUP_TRACE_READER_CLASS(FILE *file, UINT32 nHWCs);
+
+  public:
+    // Open the trace for key.  Returns NULL if there is none, or if the
+    // file was written for a different key.
+    static WARMUP_TRACE_READER Open(const string& fileName,
+                                    const string& key,
+                                    UINT32 nHWCs);
+
+    // Read the next chunk and return its type
+    CHUNK Next(void);
+
+    // Contents of a CHUNK_BATCH: the context, then its records.  The
+    // batches passed in are replaced.
+    bool Batch(UINT32& hwc);
+    bool Records(vector<WARMUP_IFETCH_CLASS>& ifetchBatch,
+                 vector<WARMUP_DATA_CLASS>& dataBatch);
+
+    // Contents of a CHUNK_TICKS
+    bool Ticks(UINT32& n);
+
+    // Contents of a CHUNK_END
+    bool Counters(vector<UINT64>& counters);
+};
+
+#endif /* _WARMUP_TRACE_ */